@@ -4,6 +4,31 @@
 #include <cstring>
 #include <iostream>
 #include <cmath>
+#include <climits>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <map>
+#include <algorithm>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 using namespace std;
 
 bool Equals(const char* a, const char* b)
@@ -45,6 +70,9 @@ void AllocateAndCopy(char** a, const char* b)
 struct InFile
 {
     FILE* file;
+    const char* text;      // the source in memory, read instead of the file if set
+    long long text_size, text_pos;
+    long long line_offset; // of line_buf in the source in memory
     int cur_line_num;
 
     char line_buf[MAX_LINE_LENGTH];
@@ -55,6 +83,20 @@ struct InFile
         file = 0;
         if(str)
             file = fopen(str, "r");
+        text = 0;
+        text_size = text_pos = line_offset = 0;
+        cur_line_size = 0;
+        cur_ind = 0;
+        cur_line_num = 0;
+    }
+
+    // reads the size bytes at _text, which must outlive the InFile
+    InFile(const char* _text, long long size)
+    {
+        file = 0;
+        text = _text;
+        text_size = size;
+        text_pos = line_offset = 0;
         cur_line_size = 0;
         cur_ind = 0;
         cur_line_num = 0;
@@ -94,11 +136,36 @@ struct InFile
         return false;
     }
 
+    // continues a source in memory at offset, on line lineNum, which starts at lineStart
+    void Seek(long long lineStart, int lineNum, long long offset)
+    {
+        text_pos = lineStart;
+        cur_line_num = lineNum-1;
+        cur_line_size = 0;
+        GetNewLine();
+        cur_ind = (int)(offset-lineStart);
+    }
+
     bool GetNewLine()
     {
         cur_ind = 0;
+        cur_line_size = 0; // nothing is left of the last line at the end of the file
         line_buf[0] = 0;
-        if(!fgets(line_buf, MAX_LINE_LENGTH, file))
+        if(text)
+        {
+            // the same line as fgets would read
+            line_offset = text_pos;
+            if(text_pos == text_size)
+                return false;
+            long long n = min(text_size-text_pos, (long long)MAX_LINE_LENGTH-1);
+            const char* newLine = (const char*)memchr(&text[text_pos], '\n', n);
+            if(newLine)
+                n = newLine-&text[text_pos]+1;
+            memcpy(line_buf, &text[text_pos], n);
+            line_buf[n] = 0;
+            text_pos += n;
+        }
+        else if(!fgets(line_buf, MAX_LINE_LENGTH, file))
             return false;
 
         cur_line_size = strlen(line_buf);
@@ -139,6 +206,92 @@ struct OutFile
     }
 };
 
+// output collected in one large buffer and written with a single fwrite whenever it fills up,
+// used for the dumps of the tree and the symbol table
+struct OutBuffer
+{
+    FILE* file;
+    char* buf;
+    int size, capacity;
+
+    OutBuffer(FILE* _file, int _capacity = 1<<20)
+    {
+        file = _file;
+        capacity = _capacity;
+        buf = new char[capacity];
+        size = 0;
+    }
+    ~OutBuffer(){Flush(); delete[] buf;}
+
+    void Flush()
+    {
+        if(size > 0)
+            fwrite(buf, 1, size, file);
+        size = 0;
+    }
+
+    void Write(const void* data, int n)
+    {
+        if(size+n > capacity)
+        {
+            Flush();
+            if(n > capacity)
+            {
+                fwrite(data, 1, n, file);
+                return;
+            }
+        }
+        memcpy(&buf[size], data, n);
+        size += n;
+    }
+
+    void Str(const char* s) {Write(s, strlen(s));}
+
+    void Char(char ch)
+    {
+        if(size == capacity)
+            Flush();
+        buf[size++] = ch;
+    }
+
+    void Repeat(char ch, int n)
+    {
+        while(n-- > 0)
+            Char(ch);
+    }
+
+    void Int(long long v)
+    {
+        char digits[24];
+        int n = 0;
+        unsigned long long u = v < 0 ? 0-(unsigned long long)v : (unsigned long long)v;
+        do
+        {
+            digits[n++] = (char)('0' + u%10);
+            u /= 10;
+        }
+        while(u);
+        if(v < 0)
+            Char('-');
+        while(n > 0)
+            Char(digits[--n]);
+    }
+
+    // little endian binary integers for the binary dumps
+    void U8(int v) {Char((char)v);}
+    void I32(int v)
+    {
+        unsigned int u = (unsigned int)v;
+        char b[4] = {(char)u, (char)(u >> 8), (char)(u >> 16), (char)(u >> 24)};
+        Write(b, 4);
+    }
+    void I64(long long v)
+    {
+        I32((int)v);
+        I32((int)(v >> 32));
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////////
 // Compiler Parameters /////////////////////////////////////////////////////////////
 
@@ -149,19 +302,143 @@ struct CompilerInfo
                 : in_file(in_str)
     {
     }
+    CompilerInfo(const char* text, long long size)
+                : in_file(text, size)
+    {
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Statistics //////////////////////////////////////////////////////////////////////
+
+// Phase timers and counters for the --stats report. They are only compiled in with -DTINY_STATS,
+// without it every STATS_* macro below expands to nothing and they cost nothing.
+// The clock is read when a whole phase starts and ends, never per token or per node: the parse
+// includes the scanner it calls (and with --fused the symbol table and the type check), the
+// symbol table includes the type check, and the scanner is timed by one more pass that only scans.
+
+enum StatsPhase {PHASE_NONE, PHASE_SCAN, PHASE_PARSE, PHASE_SYMBOL_TABLE, PHASE_EXECUTE, NUM_PHASES};
+
+const char* StatsPhaseStr[]=
+            {
+                "none", "scan", "parse", "symbol_table", "execute"
+            };
+
+#ifdef TINY_STATS
+
+struct Stats
+{
+    double phase_ms[NUM_PHASES]; // exclusive time, nested phases are not counted in the outer one
+    long long tokens;
+    long long nodes;       // made by the parser, not the copies of the unroller, inliner and layout
+    long long allocations;
+    long long allocated_bytes;
+    long long find_calls;
+    long long find_probes; // variables compared in the hash chains by Find
+    long long max_find_chain;
+    long long node_evals;
+
+    StatsPhase cur_phase;
+    chrono::steady_clock::time_point mark; // when the time of cur_phase was last charged
+
+    Stats()
+    {
+        memset(phase_ms, 0, sizeof(phase_ms));
+        tokens = nodes = allocations = allocated_bytes = 0;
+        find_calls = find_probes = max_find_chain = node_evals = 0;
+        cur_phase = PHASE_NONE;
+        mark = chrono::steady_clock::now();
+    }
+
+    // charges the time since the last mark to the current phase and switches to phase
+    void Switch(StatsPhase phase)
+    {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        phase_ms[cur_phase] += chrono::duration<double, milli>(now - mark).count();
+        mark = now;
+        cur_phase = phase;
+    }
+
+    void Print(FILE* file)
+    {
+        int i;
+        Switch(cur_phase);
+        fprintf(file, "{\n  \"phases_ms\": {");
+        for(i = PHASE_SCAN; i < NUM_PHASES; i++)
+            fprintf(file, "%s\"%s\": %.3f", i == PHASE_SCAN ? "" : ", ", StatsPhaseStr[i], phase_ms[i]);
+        fprintf(file, "},\n");
+        fprintf(file, "  \"tokens\": %lld,\n  \"nodes\": %lld,\n", tokens, nodes);
+        fprintf(file, "  \"heap\": {\"allocations\": %lld, \"bytes\": %lld},\n", allocations, allocated_bytes);
+        fprintf(file, "  \"symbol_find\": {\"calls\": %lld, \"probes\": %lld, \"avg_chain\": %.3f, \"max_chain\": %lld},\n",
+                find_calls, find_probes, find_calls ? (double)find_probes/find_calls : 0.0, max_find_chain);
+        fprintf(file, "  \"node_evals\": %lld\n}\n", node_evals);
+    }
+};
+
+Stats stats;
+
+// times a phase until the end of the enclosing scope, re-entering the current phase is free
+struct StatsTimer
+{
+    StatsPhase prev_phase;
+
+    StatsTimer(StatsPhase phase)
+    {
+        prev_phase = stats.cur_phase;
+        if(phase != prev_phase)
+            stats.Switch(phase);
+    }
+    ~StatsTimer()
+    {
+        if(stats.cur_phase != prev_phase)
+            stats.Switch(prev_phase);
+    }
 };
 
+void* statsAllocate(size_t size)
+{
+    stats.allocations++;
+    stats.allocated_bytes += size;
+    void* p = malloc(size ? size : 1);
+    if(!p)
+        throw bad_alloc();
+    return p;
+}
+void* operator new(size_t size) {return statsAllocate(size);}
+void* operator new[](size_t size) {return statsAllocate(size);}
+void operator delete(void* p) noexcept {free(p);}
+void operator delete[](void* p) noexcept {free(p);}
+void operator delete(void* p, size_t) noexcept {free(p);}
+void operator delete[](void* p, size_t) noexcept {free(p);}
+
+#define STATS_INC(counter) (stats.counter++)
+#define STATS_ADD(counter, n) (stats.counter += (n))
+#define STATS_MAX(counter, n) (stats.counter = max(stats.counter, (long long)(n)))
+#define STATS_TIMER(phase) StatsTimer statsTimer(phase)
+
+#else
+
+#define STATS_INC(counter)
+#define STATS_ADD(counter, n)
+#define STATS_MAX(counter, n)
+#define STATS_TIMER(phase)
+
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////
 // Scanner /////////////////////////////////////////////////////////////////////////
 
 #define MAX_TOKEN_LEN 40
+#define MAX_ARRAY_SIZE (1<<24)
+#define MAX_ARRAY_SIZE_STR "16777216"
 
 enum TokenType{
-                IF, THEN, ELSE, END, REPEAT, UNTIL, READ, WRITE,
+                IF, THEN, ELSE, END, REPEAT, UNTIL, READ, WRITE, ARRAY, PROC, CALL,
                 ASSIGN, EQUAL, LESS_THAN,
                 PLUS, MINUS, TIMES, DIVIDE, POWER,
-                SEMI_COLON,
+                SEMI_COLON, COMMA,
                 LEFT_PAREN, RIGHT_PAREN,
+                LEFT_BRACKET, RIGHT_BRACKET,
                 LEFT_BRACE, RIGHT_BRACE,
                 ID, NUM,
                 ENDFILE, ERROR
@@ -169,11 +446,12 @@ enum TokenType{
 
 const char* TokenTypeStr[]=
             {
-                "If", "Then", "Else", "End", "Repeat", "Until", "Read", "Write",
+                "If", "Then", "Else", "End", "Repeat", "Until", "Read", "Write", "Array", "Proc", "Call",
                 "Assign", "Equal", "LessThan",
                 "Plus", "Minus", "Times", "Divide", "Power",
-                "SemiColon",
+                "SemiColon", "Comma",
                 "LeftParen", "RightParen",
+                "LeftBracket", "RightBracket",
                 "LeftBrace", "RightBrace",
                 "ID", "Num",
                 "EndFile", "Error"
@@ -183,9 +461,11 @@ struct Token
 {
     TokenType type;
     char str[MAX_TOKEN_LEN+1];
+    int line_num, col; // where the token starts, set by the scanner
+    long long offset;  // of its first character, in a source in memory
 
-    Token(){str[0]=0; type=ERROR;}
-    Token(TokenType _type, const char* _str) {type=_type; Copy(str, _str);}
+    Token(){str[0]=0; type=ERROR; line_num=col=0; offset=0;}
+    Token(TokenType _type, const char* _str) {type=_type; Copy(str, _str); line_num=col=0; offset=0;}
 };
 
 const Token reserved_words[]=
@@ -197,7 +477,10 @@ const Token reserved_words[]=
     Token(REPEAT, "repeat"),
     Token(UNTIL, "until"),
     Token(READ, "read"),
-    Token(WRITE, "write")
+    Token(WRITE, "write"),
+    Token(ARRAY, "array"),
+    Token(PROC, "proc"),
+    Token(CALL, "call")
 };
 
 const int num_reserved_words = sizeof(reserved_words)/sizeof(reserved_words[0]);
@@ -215,8 +498,11 @@ const Token symbolic_tokens[]=
     Token(DIVIDE, "/"),
     Token(POWER, "^"),
     Token(SEMI_COLON, ";"),
+    Token(COMMA, ","),
     Token(LEFT_PAREN, "("),
     Token(RIGHT_PAREN, ")"),
+    Token(LEFT_BRACKET, "["),
+    Token(RIGHT_BRACKET, "]"),
     Token(LEFT_BRACE, "{"),
     Token(RIGHT_BRACE, "}")
 };
@@ -233,14 +519,21 @@ void GetNextToken(CompilerInfo* compInfo, Token* ptoken)
     ptoken->type = ERROR;
     ptoken->str[0] = 0;
 
-    int i;
+    int i, len = 0;
     char* s = compInfo->in_file.GetNextTokenStr();
     if(!s)
     {
         ptoken->type = ENDFILE;
         ptoken->str[0] = 0;
+        ptoken->line_num = max(compInfo->in_file.cur_line_num, 1); // an empty file has one empty line
+        ptoken->col = compInfo->in_file.cur_ind+1;
+        ptoken->offset = compInfo->in_file.line_offset+compInfo->in_file.cur_ind;
+        STATS_INC(tokens);
         return;
     }
+    ptoken->line_num = compInfo->in_file.cur_line_num;
+    ptoken->col = (int)(s - compInfo->in_file.line_buf)+1;
+    ptoken->offset = compInfo->in_file.line_offset+ptoken->col-1;
 
     for(i = 0; i < num_symbolic_tokens; i++)
     {
@@ -255,12 +548,17 @@ void GetNextToken(CompilerInfo* compInfo, Token* ptoken)
         {
             compInfo->in_file.Advance(strlen(symbolic_tokens[i].str));
             if(!compInfo->in_file.SkipUpto(symbolic_tokens[i+1].str))
+            {
+                Copy(ptoken->str, symbolic_tokens[i].str); //unterminated comment
+                STATS_INC(tokens);
                 return;
+            }
 
             return GetNextToken(compInfo, ptoken);
         }
         ptoken->type = symbolic_tokens[i].type;
         Copy(ptoken->str, symbolic_tokens[i].str);
+        len = strlen(ptoken->str);
     }
     else if(IsDigit(s[0]))
     {
@@ -269,7 +567,8 @@ void GetNextToken(CompilerInfo* compInfo, Token* ptoken)
             j++;
 
         ptoken->type = NUM;
-        Copy(ptoken->str, s, j);
+        len = j;
+        Copy(ptoken->str, s, min(j, MAX_TOKEN_LEN));
     }
     else if(IsLetterOrUnderscore(s[0]))
     {
@@ -278,7 +577,8 @@ void GetNextToken(CompilerInfo* compInfo, Token* ptoken)
             j++;
 
         ptoken->type = ID;
-        Copy(ptoken->str, s, j);
+        len = j;
+        Copy(ptoken->str, s, min(j, MAX_TOKEN_LEN));
 
         for(i = 0; i < num_reserved_words; i++)
         {
@@ -290,9 +590,17 @@ void GetNextToken(CompilerInfo* compInfo, Token* ptoken)
         }
     }
 
-    int len = strlen(ptoken->str);
-    if(len > 0)
-        compInfo->in_file.Advance(len);
+    else
+    {
+        //an invalid character is returned alone as an ERROR token
+        len = 1;
+        Copy(ptoken->str, s, 1);
+    }
+
+    if(len > MAX_TOKEN_LEN)
+        ptoken->type = ERROR; //too long, str holds its first MAX_TOKEN_LEN characters
+    compInfo->in_file.Advance(len);
+    STATS_INC(tokens);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -300,28 +608,32 @@ void GetNextToken(CompilerInfo* compInfo, Token* ptoken)
 
 // program -> stmtseq
 // stmtseq -> stmt { ; stmt }
-// stmt -> ifstmt | repeatstmt | assignstmt | readstmt | writestmt
+// stmt -> ifstmt | repeatstmt | assignstmt | readstmt | writestmt | arraystmt | procstmt | callstmt
 // ifstmt -> if exp then stmtseq [ else stmtseq ] end
 // repeatstmt -> repeat stmtseq until expr
-// assignstmt -> identifier := expr
-// readstmt -> read identifier
+// assignstmt -> identifier [ index ] := expr
+// readstmt -> read identifier [ index ]
 // writestmt -> write expr
+// arraystmt -> array identifier [ number ]          declares an array of number integers
+// procstmt -> proc identifier [ ( [ identifier { , identifier } ] ) ] stmtseq end     top level only
+// callstmt -> call identifier [ ( [ mathexpr { , mathexpr } ] ) ]
+// index -> [ mathexpr ]
 // expr -> mathexpr [ (<|=) mathexpr ]
 // mathexpr -> term { (+|-) term }    left associative
 // term -> factor { (*|/) factor }    left associative
 // factor -> newexpr { ^ newexpr }    right associative
-// newexpr -> ( mathexpr ) | number | identifier
+// newexpr -> ( mathexpr ) | number | identifier [ index ]
 
 enum NodeKind{
                 IF_NODE, REPEAT_NODE, ASSIGN_NODE, READ_NODE, WRITE_NODE,
-                OPER_NODE, NUM_NODE, ID_NODE
+                OPER_NODE, NUM_NODE, ID_NODE, ARRAY_NODE, PROC_NODE, CALL_NODE
              };
 
 // Used for debugging only /////////////////////////////////////////////////////////
 const char* NodeKindStr[]=
             {
                 "If", "Repeat", "Assign", "Read", "Write",
-                "Oper", "Num", "ID"
+                "Oper", "Num", "ID", "Array", "Proc", "Call"
             };
 enum ExprDataType {VOID, INTEGER, BOOLEAN};
 
@@ -332,6 +644,8 @@ const char* ExprDataTypeStr[]=
 
 #define MAX_CHILDREN 3
 
+struct LazyBodies;
+
 struct TreeNode
 {
     TreeNode* child[MAX_CHILDREN];
@@ -339,9 +653,12 @@ struct TreeNode
 
     NodeKind node_kind;
 
-    union{TokenType oper; int num; char* id;}; // defined for expression/int/identifier only
+    // oper/num/id for expression/int/identifier, trip_cost for repeat (0 until a budget computes it),
+    // lazy for if (0 unless --lazy left a body of it to be parsed by the run)
+    union{TokenType oper; long long num; char* id; long long trip_cost; LazyBodies* lazy;};
     ExprDataType expr_data_type;
     int line_num;
+    int index; // pre-order number given by numberNodes, indexes per-node run data
 
     TreeNode()
     {
@@ -351,12 +668,127 @@ struct TreeNode
 
         sibling = 0;
         expr_data_type = VOID;
+        index = 0;
+    }
+};
+
+// the nodes that name a variable in TreeNode::id
+bool namesVariable(TreeNode* node)
+{
+    return node->node_kind == ID_NODE || node->node_kind == READ_NODE || node->node_kind == ASSIGN_NODE ||
+           node->node_kind == ARRAY_NODE;
+}
+
+// the nodes that have a name in TreeNode::id, variables or procedures
+bool hasIdName(TreeNode* node)
+{
+    return namesVariable(node) || node->node_kind == PROC_NODE || node->node_kind == CALL_NODE;
+}
+
+// the index of an array element, child[0] of an ID or READ node and child[1] of an ASSIGN node,
+// 0 for scalars
+TreeNode* indexOf(TreeNode* node)
+{
+    if(node->node_kind == ID_NODE || node->node_kind == READ_NODE)
+        return node->child[0];
+    if(node->node_kind == ASSIGN_NODE)
+        return node->child[1];
+    return 0;
+}
+
+struct SymbolTable;
+
+// a syntax error found by the parser, the parser collects them all in one pass
+struct Diagnostic
+{
+    int line_num, col;
+    char* message;
+    Diagnostic* next;
+};
+
+struct Diagnostics
+{
+    int count;
+    Diagnostic* head;
+    Diagnostic* tail;
+
+    Diagnostics(){count = 0; head = tail = 0;}
+    ~Diagnostics(){Destroy();}
+
+    void Add(int line_num, int col, const char* message)
+    {
+        Diagnostic* d = new Diagnostic;
+        d->line_num = line_num;
+        d->col = col;
+        AllocateAndCopy(&d->message, message);
+        d->next = 0;
+
+        if(tail)
+            tail->next = d;
+        else
+            head = d;
+        tail = d;
+        count++;
+    }
+
+    void Print(const char* path)
+    {
+        Diagnostic* d;
+        for(d = head; d; d = d->next)
+            printf("%s:%d:%d: error: %s\n", path, d->line_num, d->col, d->message);
     }
+
+    void Destroy()
+    {
+        while(head)
+        {
+            Diagnostic* d = head;
+            head = head->next;
+            delete[] d->message;
+            delete d;
+        }
+        tail = 0;
+        count = 0;
+    }
+};
+
+// --lazy: the source in memory, which the if bodies that the parser skips are parsed from
+// when the run first reaches them
+struct LazySource
+{
+    const char* text;
+    long long size;
+    int skipped, parsed; // if bodies
+};
+
+// where the bodies of an if start in a LazySource, by child index: child[1] the body, child[2]
+// the else part body. offset[i] is -1 once child[i] is parsed, or if there is none
+struct LazyBodies
+{
+    long long line_start[MAX_CHILDREN], offset[MAX_CHILDREN];
+    int line_num[MAX_CHILDREN];
+    TreeNode* proc; // the procedure the if is in, or 0
 };
 
 struct ParseInfo
 {
     Token next_token;
+    SymbolTable* symbol_table; // set for the fused front end: symbols are inserted and checked while parsing
+    Diagnostics* diagnostics;
+    bool panic; // an error was reported and the parser has not resynchronized yet
+    TreeNode* proc; // the procedure whose body is parsed, its parameters are named proc.param
+    int nesting;    // if, repeat and proc bodies being parsed, procedures are declared at the top level only
+    LazySource* lazy; // --lazy: if bodies are skipped and left to the run, see skipBody
+
+    ParseInfo(Diagnostics* _diagnostics)
+    {
+        symbol_table = 0;
+        diagnostics = _diagnostics;
+        panic = false;
+        proc = 0;
+        nesting = 0;
+        lazy = 0;
+    }
 };
 
 
@@ -370,22 +802,198 @@ TreeNode* repeatStmt(CompilerInfo*, ParseInfo*);
 TreeNode* assignStmt(CompilerInfo*, ParseInfo*);
 TreeNode* readStmt(CompilerInfo*, ParseInfo*);
 TreeNode* writeStmt(CompilerInfo*, ParseInfo*);
+TreeNode* arrayStmt(CompilerInfo*, ParseInfo*);
+TreeNode* procStmt(CompilerInfo*, ParseInfo*);
+TreeNode* callStmt(CompilerInfo*, ParseInfo*);
+TreeNode* indexExpr(CompilerInfo*, ParseInfo*);
+void copyVariableName(ParseInfo*, TreeNode*, const char*);
 TreeNode* expr(CompilerInfo*, ParseInfo*);
 TreeNode* mathExpr(CompilerInfo*, ParseInfo*);
 TreeNode* term(CompilerInfo*, ParseInfo*);
 TreeNode* factor(CompilerInfo*, ParseInfo*);
 TreeNode* newExpr(CompilerInfo*, ParseInfo*);
+void insertSymbol(ParseInfo*, TreeNode*);
+void insertSymbols(ParseInfo*, TreeNode*);
+void checkNode(ParseInfo*, TreeNode*);
+void DestroyTree(TreeNode*);
 ///-------------------------------------------------------///
 
+// Error recovery (panic mode): the first error reports a diagnostic and sets parseInfo->panic,
+// further errors are not reported until the parser resynchronizes at a ; or at the end of a block,
+// statements that cannot be parsed are skipped up to the next ; end until or else.
+
+void syntaxError(ParseInfo* parseInfo, const char* expected)
+{
+    if(parseInfo->panic)
+        return;
+    parseInfo->panic = true;
+
+    Token* token = &parseInfo->next_token;
+    char message[MAX_TOKEN_LEN+100];
+    if(token->type == ENDFILE)
+        sprintf(message, "expected %s but found the end of the file", expected);
+    else if(token->type == ERROR && token->str[0] == '{') // the scanner found no closing }
+        sprintf(message, "comment not closed");
+    else if(token->type == ERROR)
+        sprintf(message, "expected %s but found the invalid token '%s'", expected, token->str);
+    else
+        sprintf(message, "expected %s but found '%s'", expected, token->str);
+    parseInfo->diagnostics->Add(token->line_num, token->col, message);
+}
+
+
+// the tokens a statement sequence continues or ends at
+bool isSyncToken(TokenType type)
+{
+    return type == SEMI_COLON || type == END || type == UNTIL || type == ELSE || type == ENDFILE;
+}
+
+
+void synchronize(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    while(!isSyncToken(parseInfo->next_token.type))
+        GetNextToken(compInfo, &parseInfo->next_token);
+}
+
+
+// skips the expected token, which resynchronizes the parser,
+// or reports it missing and leaves the current token in place
+void match(CompilerInfo* compInfo, ParseInfo* parseInfo, TokenType type, const char* expected)
+{
+    if(parseInfo->next_token.type == type)
+    {
+        parseInfo->panic = false;
+        GetNextToken(compInfo, &parseInfo->next_token);
+    }
+    else
+        syntaxError(parseInfo, expected);
+}
+
+
+// skips what is left after a statement sequence at the top level, a stray end until or else
+// and the ; after it
+void skipStrayToken(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    syntaxError(parseInfo, "a statement");
+    parseInfo->panic = false;
+    GetNextToken(compInfo, &parseInfo->next_token);
+    if(parseInfo->next_token.type == SEMI_COLON)
+        GetNextToken(compInfo, &parseInfo->next_token);
+}
+
+
 // program -> stmtseq
-TreeNode* syntaxAnalysis(const char* inputPath)
+TreeNode* program(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    GetNextToken(compInfo, &parseInfo->next_token);
+
+    TreeNode* finalTree = stmtSeq(compInfo, parseInfo);
+    while(parseInfo->next_token.type != ENDFILE)
+    {
+        skipStrayToken(compInfo, parseInfo);
+
+        TreeNode** link = &finalTree;
+        while(*link)
+            link = &(*link)->sibling;
+        *link = stmtSeq(compInfo, parseInfo);
+    }
+    return finalTree;
+}
+
+
+// if symbolTable is given, the symbol table is built and the tree is type checked during the parse.
+// Syntax errors are added to diagnostics, the tree returned then is incomplete and must not be run.
+TreeNode* syntaxAnalysis(const char* inputPath, Diagnostics* diagnostics, SymbolTable* symbolTable = 0)
+{
+    STATS_TIMER(PHASE_PARSE);
+    ParseInfo parseInfo(diagnostics);
+    parseInfo.symbol_table = symbolTable;
+    CompilerInfo compInfo(inputPath);
+    return program(&compInfo, &parseInfo);
+}
+
+
+#ifdef TINY_STATS
+// --stats: the scanner only runs inside the parse, its time is taken by a pass that only scans,
+// whose tokens are not counted again
+void statsScan(const char* inputPath)
+{
+    STATS_TIMER(PHASE_SCAN);
+    long long tokens = stats.tokens;
+    CompilerInfo compInfo(inputPath);
+    Token token;
+    do
+        GetNextToken(&compInfo, &token);
+    while(token.type != ENDFILE);
+    stats.tokens = tokens;
+}
+#endif
+
+
+// --lazy: the tree of a source in memory, without the if bodies that skipBody skips
+TreeNode* lazySyntaxAnalysis(LazySource* source, Diagnostics* diagnostics)
 {
-    ParseInfo parseInfo;
+    STATS_TIMER(PHASE_PARSE);
+    ParseInfo parseInfo(diagnostics);
+    parseInfo.lazy = source;
+    CompilerInfo compInfo(source->text, source->size);
+    return program(&compInfo, &parseInfo);
+}
+
+
+typedef void (*StatementHandler)(TreeNode* node, SymbolTable* symbolTable, void* data);
+
+// program -> stmtseq, handled with the fused front end without keeping the tree:
+// every top-level statement is parsed, checked, passed to the handler (if any) and released
+// before the next one is parsed, except procedures, which are kept until the end for their calls.
+// After the first syntax error the handler is not called anymore.
+void streamStatements(const char* inputPath, Diagnostics* diagnostics, SymbolTable* symbolTable,
+                      StatementHandler handler = 0, void* data = 0)
+{
+    STATS_TIMER(PHASE_PARSE);
+    ParseInfo parseInfo(diagnostics);
+    parseInfo.symbol_table = symbolTable;
     CompilerInfo compInfo(inputPath);
     GetNextToken(&compInfo, &parseInfo.next_token);
 
-    TreeNode* finalTree = stmtSeq(&compInfo, &parseInfo);
-    return finalTree;
+    TreeNode* procs = 0;
+    while(true)
+    {
+        TreeNode* node = stmt(&compInfo, &parseInfo);
+        if(node && handler && diagnostics->count == 0)
+        {
+            STATS_TIMER(PHASE_EXECUTE);
+            handler(node, symbolTable, data);
+        }
+        if(node && node->node_kind == PROC_NODE)
+        {
+            node->sibling = procs;
+            procs = node;
+        }
+        else
+            DestroyTree(node);
+
+        TokenType type = parseInfo.next_token.type;
+        if(type == ENDFILE)
+        {
+            DestroyTree(procs);
+            return;
+        }
+
+        if(type == ELSE || type == UNTIL || type == END)
+        {
+            skipStrayToken(&compInfo, &parseInfo);
+            continue;
+        }
+        if(type != SEMI_COLON)
+        {
+            syntaxError(&parseInfo, "';'");
+            synchronize(&compInfo, &parseInfo);
+            continue;
+        }
+        parseInfo.panic = false;
+        GetNextToken(&compInfo, &parseInfo.next_token);
+    }
 }
 
 
@@ -393,6 +1001,7 @@ TreeNode* syntaxAnalysis(const char* inputPath)
 TreeNode* stmtSeq(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     //following the left-child-right sibling representation
+    //statements that could not be parsed are 0 and left out
     TreeNode* leftSubTree = stmt(compInfo, parseInfo);
     TreeNode* rightMostSubTree = leftSubTree;
 
@@ -411,17 +1020,32 @@ TreeNode* stmtSeq(CompilerInfo* compInfo, ParseInfo* parseInfo)
         if(parseInfo->next_token.type == ENDFILE)
             return leftSubTree;
 
+        if(parseInfo->next_token.type != SEMI_COLON)
+        {
+            //the statement is followed by something else than ; or the end of the block
+            syntaxError(parseInfo, "';'");
+            synchronize(compInfo, parseInfo);
+            continue;
+        }
+
+        parseInfo->panic = false;
         GetNextToken(compInfo, &parseInfo->next_token);     //advance to the next word
         //first statement (read x) | second statement (if .. end)
         TreeNode* nextSubTree = stmt(compInfo, parseInfo);   //gets the next statement / block (sub tree)
-        rightMostSubTree->sibling = nextSubTree;
+        if(!nextSubTree)
+            continue;
+
+        if(rightMostSubTree)
+            rightMostSubTree->sibling = nextSubTree;
+        else
+            leftSubTree = nextSubTree;
         rightMostSubTree = nextSubTree;
     }
     return leftSubTree;
 }
 
 
-// stmt -> ifstmt | repeatstmt | assignstmt | readstmt | writestmt
+// stmt -> ifstmt | repeatstmt | assignstmt | readstmt | writestmt | arraystmt | procstmt | callstmt
 TreeNode* stmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     if(parseInfo->next_token.type == IF)
@@ -449,41 +1073,175 @@ TreeNode* stmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
         TreeNode* subTree = writeStmt(compInfo, parseInfo);
         return subTree;
     }
+    else if(parseInfo->next_token.type == ARRAY)
+    {
+        TreeNode* subTree = arrayStmt(compInfo, parseInfo);
+        return subTree;
+    }
+    else if(parseInfo->next_token.type == PROC)
+    {
+        TreeNode* subTree = procStmt(compInfo, parseInfo);
+        return subTree;
+    }
+    else if(parseInfo->next_token.type == CALL)
+    {
+        TreeNode* subTree = callStmt(compInfo, parseInfo);
+        return subTree;
+    }
     else
     {
-        throw 0;
+        syntaxError(parseInfo, "a statement");
+        synchronize(compInfo, parseInfo);
         return 0;
     }
 }
 
 
+// --lazy: the keywords that open and close blocks, ID for any other identifier
+TokenType blockKeyword(const char* s, int len)
+{
+    if(len == 2 && strncmp(s, "if", 2) == 0) return IF;
+    if(len == 3 && strncmp(s, "end", 3) == 0) return END;
+    if(len == 4 && strncmp(s, "proc", 4) == 0) return PROC;
+    if(len == 4 && strncmp(s, "else", 4) == 0) return ELSE;
+    if(len == 5 && strncmp(s, "until", 5) == 0) return UNTIL;
+    if(len == 6 && strncmp(s, "repeat", 6) == 0) return REPEAT;
+    return ID;
+}
+
+
+// --lazy: skips an if body whose tokens are balanced, every if and proc in it closed by an end and
+// every repeat by an until, up to the else or end of the if, and returns true. The body is read
+// straight from the source in memory, only the keywords above are told apart from the other
+// tokens. A body that is short or not balanced, or that has an invalid or too long token, a comment
+// that is not closed or a line that the scanner would split, is left to the parser, so the errors
+// that show in the tokens are reported as without --lazy
+#define LAZY_MIN_TOKENS 16
+#define MAX_LAZY_DEPTH 256
+
+bool skipBody(CompilerInfo* compInfo, ParseInfo* parseInfo, TreeNode* node, int i)
+{
+    Token* token = &parseInfo->next_token;
+    const char* text = parseInfo->lazy->text;
+    long long size = parseInfo->lazy->size;
+    long long bodyLineStart = compInfo->in_file.line_offset, lineStart = bodyLineStart, pos = token->offset;
+    int bodyLineNum = token->line_num, lineNum = bodyLineNum;
+
+    TokenType closers[MAX_LAZY_DEPTH];
+    int depth = 0, tokens = 0;
+    bool balanced = true, inComment = false;
+    while(balanced)
+    {
+        if(pos == size || pos-lineStart >= MAX_LINE_LENGTH-1)
+        {
+            balanced = false;
+            break;
+        }
+        char ch = text[pos];
+        if(ch == '\n')
+        {
+            pos++;
+            lineStart = pos;
+            lineNum++;
+            continue;
+        }
+        if(inComment || ch == ' ' || ch == '\t' || ch == '\r' || ch == '{')
+        {
+            inComment = (inComment || ch == '{') && ch != '}';
+            pos++;
+            continue;
+        }
+
+        long long start = pos;
+        if(IsLetterOrUnderscore(ch) || IsDigit(ch))
+        {
+            bool letters = !IsDigit(ch);
+            while(pos < size && (letters ? IsLetterOrUnderscore(text[pos]) : IsDigit(text[pos])))
+                pos++;
+            if(pos-start > MAX_TOKEN_LEN)
+                balanced = false;
+        }
+        else if(ch == ':' && pos+1 < size && text[pos+1] == '=')
+            pos += 2;
+        else if(ch != 0 && strchr("=<+-*/^;,()[]}", ch))
+            pos++;
+        else
+            balanced = false;
+        if(!balanced)
+            break;
+
+        TokenType type = IsLetterOrUnderscore(ch) ? blockKeyword(&text[start], (int)(pos-start)) : ID;
+        if(depth == 0 && (type == ELSE || type == END))
+        {
+            pos = start;
+            break;
+        }
+        if(depth == MAX_LAZY_DEPTH)
+            balanced = false;
+        else if(type == IF || type == PROC)
+            closers[depth++] = END;
+        else if(type == REPEAT)
+            closers[depth++] = UNTIL;
+        else if(type == END || type == UNTIL)
+            balanced = depth > 0 && closers[--depth] == type;
+        else if(type == ELSE)
+            balanced = closers[depth-1] == END;
+        tokens++;
+    }
+
+    if(!balanced || tokens < LAZY_MIN_TOKENS)
+        return false;
+
+    if(!node->lazy)
+    {
+        node->lazy = new LazyBodies;
+        node->lazy->offset[1] = node->lazy->offset[2] = -1;
+        node->lazy->proc = parseInfo->proc;
+    }
+    node->lazy->line_start[i] = bodyLineStart;
+    node->lazy->offset[i] = token->offset;
+    node->lazy->line_num[i] = bodyLineNum;
+    parseInfo->lazy->skipped++;
+
+    //the parser goes on at the else or end
+    compInfo->in_file.Seek(lineStart, lineNum, pos);
+    GetNextToken(compInfo, token);
+    return true;
+}
+
+
 // ifstmt -> if exp then stmtseq [ else stmtseq ] end
 TreeNode* ifStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     TreeNode* subTree = new TreeNode;
+    STATS_INC(nodes);
     subTree->node_kind = IF_NODE;
     subTree->line_num = compInfo->in_file.cur_line_num;
+    subTree->lazy = 0;
 
     //gets the subtree of the condition of the IF  (0<x)
     GetNextToken(compInfo, &parseInfo->next_token);
     subTree->child[0] = expr(compInfo, parseInfo);
 
-    //gets the subtree of the body of the IF
-    GetNextToken(compInfo, &parseInfo->next_token);
-    subTree->child[1] = stmtSeq(compInfo, parseInfo);
+    //gets the subtree of the body of the IF, after a syntax error every body is parsed for the diagnostics
+    match(compInfo, parseInfo, THEN, "'then'");
+    parseInfo->nesting++;
+    bool lazy = parseInfo->lazy && parseInfo->diagnostics->count == 0;
+    if(!lazy || !skipBody(compInfo, parseInfo, subTree, 1))
+        subTree->child[1] = stmtSeq(compInfo, parseInfo);
 
     //if the IF statement has an ELSE statement, we consider the else child as one of the children of the IF
     if(parseInfo->next_token.type == ELSE)
     {
-        GetNextToken(compInfo, &parseInfo->next_token);
-        subTree->child[2] = stmtSeq(compInfo, parseInfo);
+        match(compInfo, parseInfo, ELSE, "'else'");
+        if(!lazy || !skipBody(compInfo, parseInfo, subTree, 2))
+            subTree->child[2] = stmtSeq(compInfo, parseInfo);
     }
+    parseInfo->nesting--;
 
-    if(parseInfo->next_token.type == END)
-    {
-        GetNextToken(compInfo, &parseInfo->next_token);  //to skip the END
-    }
+    match(compInfo, parseInfo, END, "'end'");  //to skip the END
 
+    checkNode(parseInfo, subTree);
     return subTree;
 }
 
@@ -492,81 +1250,285 @@ TreeNode* ifStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 TreeNode* repeatStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     TreeNode* subTree = new TreeNode;
+    STATS_INC(nodes);
     subTree->node_kind = REPEAT_NODE;
     subTree->line_num = compInfo->in_file.cur_line_num;
+    subTree->trip_cost = 0;
 
     //gets the subtree of the body of the REPEAT
     GetNextToken(compInfo, &parseInfo->next_token);
+    parseInfo->nesting++;
     subTree->child[0] = stmtSeq(compInfo, parseInfo);
+    parseInfo->nesting--;
 
     //gets the subtree of the condition of the REPEAT  (x=0)
-    GetNextToken(compInfo, &parseInfo->next_token);
+    match(compInfo, parseInfo, UNTIL, "'until'");
     subTree->child[1] = expr(compInfo, parseInfo);
 
+    checkNode(parseInfo, subTree);
     return subTree;
 }
 
 
-// assignstmt -> identifier := expr
+// assignstmt -> identifier [ index ] := expr
 TreeNode* assignStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     TreeNode* subTree = new TreeNode;
+    STATS_INC(nodes);
     subTree->node_kind = ASSIGN_NODE;
     subTree->line_num = compInfo->in_file.cur_line_num;
 
+    //stmt only calls assignStmt for an identifier
+    copyVariableName(parseInfo, subTree, parseInfo->next_token.str);
+    insertSymbol(parseInfo, subTree);
+    GetNextToken(compInfo, &parseInfo->next_token);    //gets the id
+
+    //buildSymbolTable visits the value (child[0]) before the index (child[1]), so the variables of
+    //the index are inserted after the value is parsed and get the same memory locations
+    SymbolTable* symbolTable = parseInfo->symbol_table;
+    parseInfo->symbol_table = 0;
+    subTree->child[1] = indexExpr(compInfo, parseInfo); //a[i] := ...
+    parseInfo->symbol_table = symbolTable;
+    match(compInfo, parseInfo, ASSIGN, "':='");       //to skip the :=
+    subTree->child[0] = expr(compInfo, parseInfo);
+    insertSymbols(parseInfo, subTree->child[1]);
+    checkNode(parseInfo, subTree);
+    return subTree;
+}
+
+
+// readstmt -> read identifier [ index ]
+TreeNode* readStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    GetNextToken(compInfo, &parseInfo->next_token);  //gets the READ token
     if(parseInfo->next_token.type == ID)
     {
-        AllocateAndCopy(&subTree->id, parseInfo->next_token.str);
-        GetNextToken(compInfo, &parseInfo->next_token);    //gets the id
-        GetNextToken(compInfo, &parseInfo->next_token);   //to skip the :=
-        subTree->child[0] = expr(compInfo, parseInfo);
+        TreeNode* subTree = new TreeNode;
+        STATS_INC(nodes);
+        subTree->node_kind = READ_NODE;
+        //subTree->expr_data_type = INTEGER;
+        subTree->line_num = compInfo->in_file.cur_line_num;
+
+        copyVariableName(parseInfo, subTree, parseInfo->next_token.str);
+        insertSymbol(parseInfo, subTree);
+        GetNextToken(compInfo, &parseInfo->next_token);
+        subTree->child[0] = indexExpr(compInfo, parseInfo);
+        checkNode(parseInfo, subTree);
         return subTree;
     }
     else
     {
-        throw 0;
+        syntaxError(parseInfo, "an identifier");
+        synchronize(compInfo, parseInfo);
         return 0;
     }
 }
 
 
-// readstmt -> read identifier
-TreeNode* readStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
+// writestmt -> write expr
+TreeNode* writeStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     TreeNode* subTree = new TreeNode;
-    subTree->node_kind = READ_NODE;
-    //subTree->expr_data_type = INTEGER;
+    STATS_INC(nodes);
+    subTree->node_kind = WRITE_NODE;
     subTree->line_num = compInfo->in_file.cur_line_num;
 
-    GetNextToken(compInfo, &parseInfo->next_token);  //gets the READ token
-    if(parseInfo->next_token.type == ID)
+    GetNextToken(compInfo, &parseInfo->next_token);
+    subTree->child[0] = expr(compInfo, parseInfo);
+
+    checkNode(parseInfo, subTree);
+    return subTree;
+}
+
+
+// arraystmt -> array identifier [ number ]   ex: array a[100]
+TreeNode* arrayStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    GetNextToken(compInfo, &parseInfo->next_token);  //gets the ARRAY token
+    if(parseInfo->next_token.type != ID)
+    {
+        syntaxError(parseInfo, "an identifier");
+        synchronize(compInfo, parseInfo);
+        return 0;
+    }
+
+    TreeNode* subTree = new TreeNode;
+    STATS_INC(nodes);
+    subTree->node_kind = ARRAY_NODE;
+    subTree->line_num = compInfo->in_file.cur_line_num;
+    copyVariableName(parseInfo, subTree, parseInfo->next_token.str);
+    GetNextToken(compInfo, &parseInfo->next_token);
+    match(compInfo, parseInfo, LEFT_BRACKET, "'['");
+
+    //child[0] = the size, a NUM node
+    TreeNode* size = new TreeNode;
+    STATS_INC(nodes);
+    size->node_kind = NUM_NODE;
+    size->expr_data_type = INTEGER;
+    size->num = 1;
+    size->line_num = subTree->line_num;
+    subTree->child[0] = size;
+    long long value = strtoll(parseInfo->next_token.str, 0, 10);
+    if(parseInfo->next_token.type == NUM && value > 0 && value <= MAX_ARRAY_SIZE)
     {
-        AllocateAndCopy(&subTree->id, parseInfo->next_token.str);
+        size->num = (int)value;
         GetNextToken(compInfo, &parseInfo->next_token);
-        return subTree;
     }
     else
+        syntaxError(parseInfo, "an array size from 1 to " MAX_ARRAY_SIZE_STR);
+    match(compInfo, parseInfo, RIGHT_BRACKET, "']'");
+
+    insertSymbol(parseInfo, subTree);
+    return subTree;
+}
+
+
+// index -> [ mathexpr ]   ex: a[i+1], 0 if the identifier is not followed by [
+TreeNode* indexExpr(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    if(parseInfo->next_token.type != LEFT_BRACKET)
+        return 0;
+
+    GetNextToken(compInfo, &parseInfo->next_token);
+    TreeNode* subTree = mathExpr(compInfo, parseInfo);
+    match(compInfo, parseInfo, RIGHT_BRACKET, "']'");
+    return subTree;
+}
+
+
+// procstmt -> proc identifier [ ( [ identifier { , identifier } ] ) ] stmtseq end   ex: proc add(a, b) s := a + b end
+// child[0] = the parameters, ID nodes named proc.param, child[1] = the body
+TreeNode* procStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    //a procedure inside a block is reported but parsed like any other, so the parser stays in step
+    if(parseInfo->nesting && !parseInfo->panic)
+        parseInfo->diagnostics->Add(parseInfo->next_token.line_num, parseInfo->next_token.col,
+                                    "procedures are declared at the top level only");
+
+    GetNextToken(compInfo, &parseInfo->next_token);  //gets the PROC token
+    if(parseInfo->next_token.type != ID)
     {
-        throw 0;
+        syntaxError(parseInfo, "an identifier");
+        synchronize(compInfo, parseInfo);
         return 0;
     }
+
+    TreeNode* subTree = new TreeNode;
+    STATS_INC(nodes);
+    subTree->node_kind = PROC_NODE;
+    subTree->line_num = compInfo->in_file.cur_line_num;
+    AllocateAndCopy(&subTree->id, parseInfo->next_token.str);
+    GetNextToken(compInfo, &parseInfo->next_token);
+
+    if(parseInfo->next_token.type == LEFT_PAREN)
+    {
+        GetNextToken(compInfo, &parseInfo->next_token);
+        TreeNode** link = &subTree->child[0];
+        while(parseInfo->next_token.type == ID)
+        {
+            TreeNode* param;
+            for(param = subTree->child[0]; param; param = param->sibling)
+                if(Equals(strchr(param->id, '.')+1, parseInfo->next_token.str))
+                    break;
+            if(param)
+            {
+                syntaxError(parseInfo, "a parameter name that is not used yet");
+                break;
+            }
+
+            param = new TreeNode;
+            STATS_INC(nodes);
+            param->node_kind = ID_NODE;
+            param->expr_data_type = INTEGER;
+            param->line_num = compInfo->in_file.cur_line_num;
+            param->id = new char[strlen(subTree->id) + strlen(parseInfo->next_token.str) + 2];
+            sprintf(param->id, "%s.%s", subTree->id, parseInfo->next_token.str);
+            insertSymbol(parseInfo, param);
+            *link = param;
+            link = &param->sibling;
+
+            GetNextToken(compInfo, &parseInfo->next_token);
+            if(parseInfo->next_token.type != COMMA)
+                break;
+            GetNextToken(compInfo, &parseInfo->next_token);
+        }
+        match(compInfo, parseInfo, RIGHT_PAREN, "')'");
+    }
+
+    //declared before the body is parsed, so the body can call the procedure
+    insertSymbol(parseInfo, subTree);
+    parseInfo->proc = subTree;
+    parseInfo->nesting++;
+    subTree->child[1] = stmtSeq(compInfo, parseInfo);
+    parseInfo->nesting--;
+    parseInfo->proc = 0;
+    match(compInfo, parseInfo, END, "'end'");
+    return subTree;
 }
 
 
-// writestmt -> write expr
-TreeNode* writeStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
+// callstmt -> call identifier [ ( [ mathexpr { , mathexpr } ] ) ]   ex: call add(x, 2*y)
+// child[0] = the arguments, linked by sibling
+TreeNode* callStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
+    GetNextToken(compInfo, &parseInfo->next_token);  //gets the CALL token
+    if(parseInfo->next_token.type != ID)
+    {
+        syntaxError(parseInfo, "an identifier");
+        synchronize(compInfo, parseInfo);
+        return 0;
+    }
+
     TreeNode* subTree = new TreeNode;
-    subTree->node_kind = WRITE_NODE;
+    STATS_INC(nodes);
+    subTree->node_kind = CALL_NODE;
     subTree->line_num = compInfo->in_file.cur_line_num;
-
+    AllocateAndCopy(&subTree->id, parseInfo->next_token.str);
     GetNextToken(compInfo, &parseInfo->next_token);
-    subTree->child[0] = expr(compInfo, parseInfo);
 
+    if(parseInfo->next_token.type == LEFT_PAREN)
+    {
+        GetNextToken(compInfo, &parseInfo->next_token);
+        TreeNode** link = &subTree->child[0];
+        if(parseInfo->next_token.type != RIGHT_PAREN)
+        {
+            while(true)
+            {
+                *link = mathExpr(compInfo, parseInfo);
+                link = &(*link)->sibling;
+                if(parseInfo->next_token.type != COMMA)
+                    break;
+                GetNextToken(compInfo, &parseInfo->next_token);
+            }
+        }
+        match(compInfo, parseInfo, RIGHT_PAREN, "')'");
+    }
+
+    checkNode(parseInfo, subTree);
     return subTree;
 }
 
 
+// the name of the variable an identifier stands for: inside a procedure its parameters are
+// the variables proc.param, every other name is a global variable
+void copyVariableName(ParseInfo* parseInfo, TreeNode* node, const char* name)
+{
+    TreeNode* param;
+    if(parseInfo->proc)
+    {
+        for(param = parseInfo->proc->child[0]; param; param = param->sibling)
+        {
+            if(Equals(strchr(param->id, '.')+1, name))
+            {
+                AllocateAndCopy(&node->id, param->id);
+                return;
+            }
+        }
+    }
+    AllocateAndCopy(&node->id, name);
+}
+
+
 // expr -> mathexpr [ (<|=) mathexpr ]
 TreeNode* expr(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
@@ -576,6 +1538,7 @@ TreeNode* expr(CompilerInfo* compInfo, ParseInfo* parseInfo)
     if(parseInfo->next_token.type == LESS_THAN || parseInfo->next_token.type == EQUAL)
     {
         TreeNode* newSubTree = new TreeNode;
+        STATS_INC(nodes);
         newSubTree->node_kind = OPER_NODE;
         newSubTree->expr_data_type = BOOLEAN;
         newSubTree->oper = parseInfo->next_token.type;
@@ -585,6 +1548,7 @@ TreeNode* expr(CompilerInfo* compInfo, ParseInfo* parseInfo)
         GetNextToken(compInfo, &parseInfo->next_token);
         newSubTree->child[1] = mathExpr(compInfo, parseInfo); //the RHS of the operator
 
+        checkNode(parseInfo, newSubTree);
         return newSubTree;
     }
     else
@@ -603,6 +1567,7 @@ TreeNode* mathExpr(CompilerInfo* compInfo, ParseInfo* parseInfo)
     while(parseInfo->next_token.type == PLUS || parseInfo->next_token.type == MINUS)
     {
         TreeNode* newSubTree = new TreeNode;
+        STATS_INC(nodes);
         newSubTree->node_kind = OPER_NODE;
         newSubTree->expr_data_type = INTEGER;
         newSubTree->oper = parseInfo->next_token.type;
@@ -611,6 +1576,7 @@ TreeNode* mathExpr(CompilerInfo* compInfo, ParseInfo* parseInfo)
         newSubTree->child[0] = subTree;  //left operand
         GetNextToken(compInfo, &parseInfo->next_token);
         newSubTree->child[1] = term(compInfo, parseInfo);  //right operand
+        checkNode(parseInfo, newSubTree);
 
         subTree = newSubTree;
     }
@@ -627,6 +1593,7 @@ TreeNode* term(CompilerInfo* compInfo, ParseInfo* parseInfo)
     while(parseInfo->next_token.type == TIMES || parseInfo->next_token.type == DIVIDE)
     {
         TreeNode* newSubTree = new TreeNode;
+        STATS_INC(nodes);
         newSubTree->node_kind = OPER_NODE;
         newSubTree->expr_data_type = INTEGER;
         newSubTree->oper = parseInfo->next_token.type;
@@ -635,6 +1602,7 @@ TreeNode* term(CompilerInfo* compInfo, ParseInfo* parseInfo)
         newSubTree->child[0] = subTree; //left operand
         GetNextToken(compInfo, &parseInfo->next_token);
         newSubTree->child[1] = factor(compInfo, parseInfo); //right operand
+        checkNode(parseInfo, newSubTree);
 
         subTree = newSubTree;
     }
@@ -650,6 +1618,7 @@ TreeNode* factor(CompilerInfo* compInfo, ParseInfo* parseInfo)
     if(parseInfo->next_token.type == POWER)
     {
         TreeNode* newSubTree = new TreeNode;
+        STATS_INC(nodes);
         newSubTree->node_kind = OPER_NODE;
         newSubTree->expr_data_type = INTEGER;
         newSubTree->oper = parseInfo->next_token.type;  //^
@@ -659,6 +1628,7 @@ TreeNode* factor(CompilerInfo* compInfo, ParseInfo* parseInfo)
         GetNextToken(compInfo, &parseInfo->next_token);
         //we use recursion to benefit from backtracking to calculate the power from right to left
         newSubTree->child[1] = factor(compInfo, parseInfo);  //right operand 3^1^5
+        checkNode(parseInfo, newSubTree);
         return newSubTree;
     }
     else
@@ -668,7 +1638,7 @@ TreeNode* factor(CompilerInfo* compInfo, ParseInfo* parseInfo)
 }
 
 
-// newexpr -> ( mathexpr ) | number | identifier   ex: (5+3) | 5 | x
+// newexpr -> ( mathexpr ) | number | identifier [ index ]   ex: (5+3) | 5 | x | a[x]
 TreeNode* newExpr(CompilerInfo* compInfo, ParseInfo* parseInfo)
 {
     if(parseInfo->next_token.type == LEFT_PAREN)
@@ -676,18 +1646,25 @@ TreeNode* newExpr(CompilerInfo* compInfo, ParseInfo* parseInfo)
         GetNextToken(compInfo, &parseInfo->next_token); //(
         TreeNode* subTree = mathExpr(compInfo, parseInfo);
 
-        GetNextToken(compInfo, &parseInfo->next_token); //skipping the )
+        match(compInfo, parseInfo, RIGHT_PAREN, "')'"); //skipping the )
         return subTree;
     }
     else if(parseInfo->next_token.type == NUM)
     {
         TreeNode* subTree = new TreeNode;
+        STATS_INC(nodes);
         subTree->node_kind = NUM_NODE;
         subTree->expr_data_type = INTEGER;
         //converting the char* to integer and store it in subTree->num
         char* numStr = parseInfo->next_token.str; //123
-        string tempString = numStr;
-        subTree->num = stoi(tempString);
+        errno = 0;
+        long long value = strtoll(numStr, 0, 10);
+        if(errno == ERANGE)
+        {
+            syntaxError(parseInfo, "a number that fits in 64 bits");
+            value = 0;
+        }
+        subTree->num = value;
         subTree->line_num = compInfo->in_file.cur_line_num;
         GetNextToken(compInfo, &parseInfo->next_token);
         return subTree;
@@ -695,76 +1672,258 @@ TreeNode* newExpr(CompilerInfo* compInfo, ParseInfo* parseInfo)
     else if(parseInfo->next_token.type == ID)
     {
         TreeNode* subTree = new TreeNode;
+        STATS_INC(nodes);
         subTree->node_kind = ID_NODE;
         subTree->expr_data_type = INTEGER;
         //store the value of the identifier (next_token.str ex:(xyz)) in the subtree->id
-        AllocateAndCopy(&subTree->id, parseInfo->next_token.str);
+        copyVariableName(parseInfo, subTree, parseInfo->next_token.str);
         subTree->line_num = compInfo->in_file.cur_line_num;
+        insertSymbol(parseInfo, subTree);
         GetNextToken(compInfo, &parseInfo->next_token);
+        subTree->child[0] = indexExpr(compInfo, parseInfo);
+        checkNode(parseInfo, subTree);
         return subTree;
     }
     else
     {
-        throw 0;
-        return 0;
+        //the missing operand is replaced by 0 so the tree stays well formed, the caller resynchronizes
+        syntaxError(parseInfo, "an expression");
+        TreeNode* subTree = new TreeNode;
+        STATS_INC(nodes);
+        subTree->node_kind = NUM_NODE;
+        subTree->expr_data_type = INTEGER;
+        subTree->num = 0;
+        subTree->line_num = compInfo->in_file.cur_line_num;
+        return subTree;
     }
 }
 
 
-void printTree(TreeNode* node, int sh = 0)
+// formats of the --dump output of the tree and the symbol table
+enum DumpFormat {DUMP_NONE, DUMP_TEXT, DUMP_JSONL, DUMP_BINARY};
+
+// an entry of the explicit stack the dumps walk the tree with
+struct DumpItem
 {
-    int i, NSH = 3;
-    for(i = 0; i < sh; i++)
-    {
-        printf(" ");
-    }
+    TreeNode* node;
+    int depth;
+    int parent;     // pre-order number of the parent node, -1 for top-level statements
+    int child_slot; // which child of the parent the node (or its first sibling) is
+};
 
-    printf("[%s]", NodeKindStr[node->node_kind]);
+// walks the tree in pre-order without recursion: the sibling of a node is pushed before its
+// children, so a whole subtree is visited before the statement that follows it
+struct TreeWalker
+{
+    DumpItem* stack;
+    int top, capacity, next_num;
 
-    if(node->node_kind == OPER_NODE)
+    TreeWalker(TreeNode* root)
     {
-        printf("[%s]", TokenTypeStr[node->oper]);
+        capacity = 64;
+        stack = new DumpItem[capacity];
+        top = 0;
+        next_num = 0;
+        if(root)
+            Push(root, 0, -1, -1);
     }
-    else if(node->node_kind == NUM_NODE)
+    ~TreeWalker(){delete[] stack;}
+
+    void Push(TreeNode* node, int depth, int parent, int child_slot)
     {
-        printf("[%d]", node->num);
+        if(top == capacity)
+        {
+            DumpItem* grown = new DumpItem[2*capacity];
+            memcpy(grown, stack, capacity*sizeof(DumpItem));
+            delete[] stack;
+            stack = grown;
+            capacity *= 2;
+        }
+        stack[top].node = node;
+        stack[top].depth = depth;
+        stack[top].parent = parent;
+        stack[top].child_slot = child_slot;
+        top++;
     }
-    else if(node->node_kind == ID_NODE || node->node_kind == READ_NODE || node->node_kind == ASSIGN_NODE)
+
+    // returns false when the walk is done, *num is the pre-order number of the node
+    bool Next(DumpItem* item, int* num)
     {
-        printf("[%s]", node->id);
+        if(top == 0)
+            return false;
+        *item = stack[--top];
+        *num = next_num++;
+
+        TreeNode* node = item->node;
+        int i;
+        if(node->sibling)
+            Push(node->sibling, item->depth, item->parent, item->child_slot);
+        for(i = MAX_CHILDREN-1; i >= 0; i--)
+            if(node->child[i])
+                Push(node->child[i], item->depth+1, *num, i);
+        return true;
     }
-    if(node->expr_data_type != VOID)
+};
+
+
+// the human-readable dump, indented by 3 spaces per level
+void printTree(TreeNode* root, OutBuffer* out)
+{
+    TreeWalker walker(root);
+    DumpItem item;
+    int num;
+    while(walker.Next(&item, &num))
     {
-        printf("[%s]", ExprDataTypeStr[node->expr_data_type]);
+        TreeNode* node = item.node;
+        out->Repeat(' ', 3*item.depth);
+
+        out->Char('[');
+        out->Str(NodeKindStr[node->node_kind]);
+        out->Char(']');
+
+        if(node->node_kind == OPER_NODE)
+        {
+            out->Char('[');
+            out->Str(TokenTypeStr[node->oper]);
+            out->Char(']');
+        }
+        else if(node->node_kind == NUM_NODE)
+        {
+            out->Char('[');
+            out->Int(node->num);
+            out->Char(']');
+        }
+        else if(hasIdName(node))
+        {
+            out->Char('[');
+            out->Str(node->id);
+            out->Char(']');
+        }
+        if(node->expr_data_type != VOID)
+        {
+            out->Char('[');
+            out->Str(ExprDataTypeStr[node->expr_data_type]);
+            out->Char(']');
+        }
+        out->Char('\n');
     }
+}
 
-    printf("\n");
 
-    for(i = 0; i < MAX_CHILDREN; i++)
+// one JSON object per node in pre-order:
+// {"n":3,"parent":1,"child":0,"kind":"Oper","line":7,"oper":"LessThan","type":"Boolean"}
+// statements of the same sequence share parent and child, top-level statements have parent -1
+void dumpTreeJsonl(TreeNode* root, OutBuffer* out)
+{
+    TreeWalker walker(root);
+    DumpItem item;
+    int num;
+    while(walker.Next(&item, &num))
     {
-        if(node->child[i])
+        TreeNode* node = item.node;
+        out->Str("{\"n\":");
+        out->Int(num);
+        out->Str(",\"parent\":");
+        out->Int(item.parent);
+        out->Str(",\"child\":");
+        out->Int(item.child_slot);
+        out->Str(",\"kind\":\"");
+        out->Str(NodeKindStr[node->node_kind]);
+        out->Str("\",\"line\":");
+        out->Int(node->line_num);
+
+        if(node->node_kind == OPER_NODE)
+        {
+            out->Str(",\"oper\":\"");
+            out->Str(TokenTypeStr[node->oper]);
+            out->Char('"');
+        }
+        else if(node->node_kind == NUM_NODE)
+        {
+            out->Str(",\"num\":");
+            out->Int(node->num);
+        }
+        else if(hasIdName(node))
+        {
+            out->Str(",\"id\":\"");
+            out->Str(node->id); // identifiers are letters and _ only, nothing to escape
+            out->Char('"');
+        }
+        if(node->expr_data_type != VOID)
         {
-            printTree(node->child[i], sh+NSH);
+            out->Str(",\"type\":\"");
+            out->Str(ExprDataTypeStr[node->expr_data_type]);
+            out->Char('"');
         }
+        out->Str("}\n");
     }
-    if(node->sibling)
+}
+
+
+// "TINYAST2", then every node in pre-order:
+//   u8 kind, u8 links (bit i: child[i] follows, bit 3: a sibling follows the subtree),
+//   u8 expr_data_type, i32 line, then u8 oper | i64 num | i32 length + name bytes
+// all integers little endian, the links are enough to rebuild the tree
+void dumpTreeBinary(TreeNode* root, OutBuffer* out)
+{
+    out->Write("TINYAST2", 8);
+    TreeWalker walker(root);
+    DumpItem item;
+    int i, num;
+    while(walker.Next(&item, &num))
     {
-        printTree(node->sibling, sh);
+        TreeNode* node = item.node;
+        int links = node->sibling ? 8 : 0;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                links |= 1 << i;
+
+        out->U8(node->node_kind);
+        out->U8(links);
+        out->U8(node->expr_data_type);
+        out->I32(node->line_num);
+        if(node->node_kind == OPER_NODE)
+            out->U8(node->oper);
+        else if(node->node_kind == NUM_NODE)
+            out->I64(node->num);
+        else if(hasIdName(node))
+        {
+            int len = strlen(node->id);
+            out->I32(len);
+            out->Write(node->id, len);
+        }
     }
 }
 
 
+void dumpTree(TreeNode* root, DumpFormat format, OutBuffer* out)
+{
+    if(format == DUMP_TEXT)
+        printTree(root, out);
+    else if(format == DUMP_JSONL)
+        dumpTreeJsonl(root, out);
+    else if(format == DUMP_BINARY)
+        dumpTreeBinary(root, out);
+}
+
+
 void DestroyTree(TreeNode* node)
 {
     int i;
 
-    if(node->node_kind==ID_NODE || node->node_kind==READ_NODE || node->node_kind==ASSIGN_NODE)
-        if(node->id) delete[] node->id;
+    while(node) //siblings are destroyed iteratively so long programs do not deepen the recursion
+    {
+        if(hasIdName(node))
+            if(node->id) delete[] node->id;
+        if(node->node_kind == IF_NODE)
+            delete node->lazy;
 
-    for(i=0;i<MAX_CHILDREN;i++) if(node->child[i]) DestroyTree(node->child[i]);
-    if(node->sibling) DestroyTree(node->sibling);
+        for(i=0;i<MAX_CHILDREN;i++) if(node->child[i]) DestroyTree(node->child[i]);
 
-    delete node;
+        TreeNode* sibling = node->sibling;
+        delete node;
+        node = sibling;
+    }
 }
 
 
@@ -783,23 +1942,56 @@ struct VariableInfo
 {
     char* name;
     int memloc;
+    int size;      // memory locations from memloc on, 1 for scalars
+    bool is_array; // declared by an array statement
     LineLocation* head_line; // the head of linked list of source line locations
     LineLocation* tail_line; // the tail of linked list of source line locations
     VariableInfo* next_var; // the next variable in the linked list in the same hash bucket of the symbol table
 };
 
+struct LowerMemloc
+{
+    bool operator()(VariableInfo* a, VariableInfo* b) const
+    {
+        return a->memloc < b->memloc;
+    }
+};
+
+
+const int PROC_HASH_SIZE = 1009;
+
+struct ProcInfo
+{
+    char* name;
+    TreeNode* node;  // the proc statement, 0 once every call of it is inlined and it is removed
+    int num_params;
+    int num_calls;   // call statements of it found by the front end
+    int num_nodes;   // of the body once the inliner is done with it, -1 before
+    bool leaf;       // the body has no calls left after inlining
+    int calls_left;  // calls that are not inlined
+    long long call_cost; // nodes of the body charged to the budgets per call, 0 until a budget computes it
+    ProcInfo* next_proc;
+};
+
 
 struct SymbolTable
 {
     int num_vars;
+    int num_procs;
+    bool record_lines; // if false only the first line location of each variable is kept
     VariableInfo* var_info[SYMBOL_HASH_SIZE];
+    ProcInfo* proc_info[PROC_HASH_SIZE]; // procedures have names of their own, apart from the variables
 
     SymbolTable()
     {
         num_vars = 0;
+        num_procs = 0;
+        record_lines = true;
         int i;
         for(i = 0; i < SYMBOL_HASH_SIZE; i++)
             var_info[i] = 0;
+        for(i = 0; i < PROC_HASH_SIZE; i++)
+            proc_info[i] = 0;
     }
 
     int Hash(const char* name)
@@ -813,23 +2005,25 @@ struct SymbolTable
 
     VariableInfo* Find(const char* name)
     {
-        int h = Hash(name);
-        VariableInfo* cur = var_info[h];
-        while(cur)
+        STATS_INC(find_calls);
+        int chain = 0; // only counted with TINY_STATS, otherwise optimized out
+        VariableInfo* cur;
+        for(cur = var_info[Hash(name)]; cur; cur = cur->next_var)
         {
+            chain++;
             if(Equals(name, cur->name))
-                return cur;
-            cur = cur->next_var;
+                break;
         }
-        return 0;
+        STATS_ADD(find_probes, chain);
+        STATS_MAX(max_find_chain, chain);
+        (void)chain;
+        return cur;
     }
 
-    void Insert(const char* name, int line_num)
+    // size > 0 declares an array of size elements at consecutive memory locations,
+    // returns false if the variable was already there
+    bool Insert(const char* name, int line_num, int size = 0)
     {
-        LineLocation* lineloc = new LineLocation;
-        lineloc->line_num = line_num;
-        lineloc->next = 0;
-
         int h = Hash(name);
         VariableInfo* prev = 0;
         VariableInfo* cur = var_info[h];
@@ -838,43 +2032,202 @@ struct SymbolTable
         {
             if(Equals(name, cur->name))
             {
+                if(!record_lines)
+                    return false;
+
                 // just add this line location to the list of line locations of the existing var
+                LineLocation* lineloc = new LineLocation;
+                lineloc->line_num = line_num;
+                lineloc->next = 0;
                 cur->tail_line->next = lineloc;
                 cur->tail_line = lineloc;
-                return;
+                return false;
             }
             prev = cur;
             cur = cur->next_var;
         }
 
+        LineLocation* lineloc = new LineLocation;
+        lineloc->line_num = line_num;
+        lineloc->next = 0;
+
         VariableInfo* vi = new VariableInfo;
         vi->head_line = vi->tail_line = lineloc;
         vi->next_var = 0;
-        vi->memloc = num_vars++;
+        vi->memloc = num_vars;
+        vi->size = size > 0 ? size : 1;
+        vi->is_array = size > 0;
+        num_vars += vi->size;
         AllocateAndCopy(&vi->name, name);
 
         if(!prev)
             var_info[h] = vi;
         else
             prev->next_var = vi;
+        return true;
+    }
+
+    // Insert for all the line locations of a variable at once, headLine to tailLine in order,
+    // hash is Hash(name). The variable is created if it is new, which created tells
+    VariableInfo* Merge(const char* name, int hash, int size, LineLocation* headLine, LineLocation* tailLine,
+                        bool* created)
+    {
+        VariableInfo* prev = 0;
+        VariableInfo* cur = var_info[hash];
+        for(; cur; prev = cur, cur = cur->next_var)
+        {
+            if(!Equals(name, cur->name))
+                continue;
+            *created = false;
+            if(record_lines)
+            {
+                cur->tail_line->next = headLine;
+                cur->tail_line = tailLine;
+                return cur;
+            }
+            while(headLine)
+            {
+                LineLocation* next = headLine->next;
+                delete headLine;
+                headLine = next;
+            }
+            return cur;
+        }
+
+        VariableInfo* vi = new VariableInfo;
+        vi->head_line = headLine;
+        vi->tail_line = tailLine;
+        vi->next_var = 0;
+        vi->memloc = num_vars;
+        vi->size = size > 0 ? size : 1;
+        vi->is_array = size > 0;
+        num_vars += vi->size;
+        AllocateAndCopy(&vi->name, name);
+
+        if(!prev)
+            var_info[hash] = vi;
+        else
+            prev->next_var = vi;
+        *created = true;
+        return vi;
+    }
+
+    ProcInfo* FindProc(const char* name)
+    {
+        ProcInfo* cur;
+        for(cur = proc_info[Hash(name) % PROC_HASH_SIZE]; cur; cur = cur->next_proc)
+            if(Equals(name, cur->name))
+                return cur;
+        return 0;
+    }
+
+    // returns false if there is a procedure of that name already
+    bool InsertProc(TreeNode* node)
+    {
+        if(FindProc(node->id))
+            return false;
+
+        ProcInfo* pi = new ProcInfo;
+        AllocateAndCopy(&pi->name, node->id);
+        pi->node = node;
+        pi->num_params = 0;
+        TreeNode* param;
+        for(param = node->child[0]; param; param = param->sibling)
+            pi->num_params++;
+        pi->num_calls = 0;
+        pi->num_nodes = -1;
+        pi->leaf = false;
+        pi->calls_left = 0;
+        pi->call_cost = 0;
+
+        int h = Hash(node->id) % PROC_HASH_SIZE;
+        pi->next_proc = proc_info[h];
+        proc_info[h] = pi;
+        num_procs++;
+        return true;
     }
 
-    void Print()
+    // text:   [Var=x][Mem=0][Line=6][Line=7] per variable, arrays add [Size=n] after Mem
+    // jsonl:  {"var":"x","mem":0,"lines":[6,7]} per variable, arrays add "size":n after mem
+    // binary: "TINYSYM2", i32 number of variables, then per variable
+    //         i32 length + name bytes, i32 memloc, i32 size (0 for scalars),
+    //         i32 number of lines + i32 lines
+    void Print(DumpFormat format, OutBuffer* out)
     {
         int i;
+        if(format == DUMP_NONE)
+            return;
+        if(format == DUMP_BINARY)
+        {
+            int count = 0;
+            VariableInfo* curv;
+            for(i = 0; i < SYMBOL_HASH_SIZE; i++)
+                for(curv = var_info[i]; curv; curv = curv->next_var)
+                    count++;
+            out->Write("TINYSYM2", 8);
+            out->I32(count);
+        }
+
         for(i = 0; i < SYMBOL_HASH_SIZE; i++)
         {
             VariableInfo* curv = var_info[i];
             while(curv)
             {
-                printf("[Var=%s][Mem=%d]", curv->name, curv->memloc);
-                LineLocation* curl = curv->head_line;
-                while(curl)
+                LineLocation* curl;
+                if(format == DUMP_TEXT)
                 {
-                    printf("[Line=%d]", curl->line_num);
-                    curl = curl->next;
+                    out->Str("[Var=");
+                    out->Str(curv->name);
+                    out->Str("][Mem=");
+                    out->Int(curv->memloc);
+                    out->Char(']');
+                    if(curv->is_array)
+                    {
+                        out->Str("[Size=");
+                        out->Int(curv->size);
+                        out->Char(']');
+                    }
+                    for(curl = curv->head_line; curl; curl = curl->next)
+                    {
+                        out->Str("[Line=");
+                        out->Int(curl->line_num);
+                        out->Char(']');
+                    }
+                    out->Char('\n');
+                }
+                else if(format == DUMP_JSONL)
+                {
+                    out->Str("{\"var\":\"");
+                    out->Str(curv->name);
+                    out->Str("\",\"mem\":");
+                    out->Int(curv->memloc);
+                    if(curv->is_array)
+                    {
+                        out->Str(",\"size\":");
+                        out->Int(curv->size);
+                    }
+                    out->Str(",\"lines\":[");
+                    for(curl = curv->head_line; curl; curl = curl->next)
+                    {
+                        out->Int(curl->line_num);
+                        if(curl->next)
+                            out->Char(',');
+                    }
+                    out->Str("]}\n");
+                }
+                else
+                {
+                    int len = strlen(curv->name), num_lines = 0;
+                    out->I32(len);
+                    out->Write(curv->name, len);
+                    out->I32(curv->memloc);
+                    out->I32(curv->is_array ? curv->size : 0);
+                    for(curl = curv->head_line; curl; curl = curl->next)
+                        num_lines++;
+                    out->I32(num_lines);
+                    for(curl = curv->head_line; curl; curl = curl->next)
+                        out->I32(curl->line_num);
                 }
-                printf("\n");
                 curv = curv->next_var;
             }
         }
@@ -897,278 +2250,7536 @@ struct SymbolTable
                 }
                 VariableInfo* p = curv;
                 curv = curv->next_var;
+                delete[] p->name;
                 delete p;
             }
             var_info[i] = 0;
         }
+        for(i = 0; i < PROC_HASH_SIZE; i++)
+        {
+            while(proc_info[i])
+            {
+                ProcInfo* p = proc_info[i];
+                proc_info[i] = p->next_proc;
+                delete[] p->name;
+                delete p;
+            }
+        }
+        num_vars = 0;
+        num_procs = 0;
     }
 };
 
 /// ////////////////////////////////////////////////
 /// new ///////////////////////////////////////////
 
-void typeChecking(TreeNode* node)
+// returns true if the node has a type error, which is printed if report
+bool typeChecking(TreeNode* node, bool report = true)
 {
+    bool error = false;
     if(node->node_kind == IF_NODE && node->child[0]->expr_data_type != BOOLEAN)
     {
-        printf("============================================================================= \n");
-        printf("Error!! invalid type for if-condition, condition has to be of type boolean \n");
-        printf("============================================================================= \n");
+        error = true;
+        if(report)
+        {
+            printf("============================================================================= \n");
+            printf("Error!! invalid type for if-condition, condition has to be of type boolean \n");
+            printf("============================================================================= \n");
+        }
     }
 
     if(node->node_kind == REPEAT_NODE && node->child[1]->expr_data_type != BOOLEAN)
     {
-        printf("================================================================================= \n");
-        printf("Error!! invalid type for repeat-condition, condition has to be of type boolean \n");
-        printf("================================================================================= \n");
+        error = true;
+        if(report)
+        {
+            printf("================================================================================= \n");
+            printf("Error!! invalid type for repeat-condition, condition has to be of type boolean \n");
+            printf("================================================================================= \n");
+        }
     }
 
     if(node->node_kind == ASSIGN_NODE && node->child[0]->expr_data_type != INTEGER)
     {
-        printf("=========================================================================================== \n");
-        printf("Error!! invalid type for the variable of the assign statement, integers only are allowed \n");
-        printf("=========================================================================================== \n");
+        error = true;
+        if(report)
+        {
+            printf("=========================================================================================== \n");
+            printf("Error!! invalid type for the variable of the assign statement, integers only are allowed \n");
+            printf("=========================================================================================== \n");
+        }
     }
 
     if(node->node_kind == WRITE_NODE && node->child[0]->expr_data_type != INTEGER)
     {
-        printf("========================================================================================== \n");
-        printf("Error!! invalid type for the variable of the write statement, integers only are allowed \n");
-        printf("========================================================================================== \n");
+        error = true;
+        if(report)
+        {
+            printf("========================================================================================== \n");
+            printf("Error!! invalid type for the variable of the write statement, integers only are allowed \n");
+            printf("========================================================================================== \n");
+        }
     }
 
     if(node->node_kind == OPER_NODE  && (node->child[0]->expr_data_type != INTEGER || node->child[1]->expr_data_type != INTEGER))
     {
-        printf("============================================================= \n");
-        printf("Error!! invalid type for operand, integers only are allowed\n");
-        printf("============================================================= \n");
+        error = true;
+        if(report)
+        {
+            printf("============================================================= \n");
+            printf("Error!! invalid type for operand, integers only are allowed\n");
+            printf("============================================================= \n");
+        }
     }
+    return error;
 }
 
 
-void buildSymbolTable(TreeNode* node, SymbolTable* symbol_table)
+// inserts the variable named by node, an array statement declares the array with its size
+void insertVariable(SymbolTable* symbolTable, TreeNode* node)
 {
-    int i;
-    if(node->node_kind == ID_NODE || node->node_kind == READ_NODE || node->node_kind == ASSIGN_NODE)
+    if(node->node_kind != ARRAY_NODE)
     {
-        symbol_table->Insert(node->id, node->line_num);
+        symbolTable->Insert(node->id, node->line_num);
+        return;
     }
-
-    for(i = 0; i < MAX_CHILDREN; i++)
+    if(!symbolTable->Insert(node->id, node->line_num, node->child[0]->num))
     {
-        if(node->child[i])
-        {
-             buildSymbolTable(node->child[i], symbol_table);
-        }
+        printf("==================================================================================== \n");
+        printf("Error!! the array %s is declared after it is used or declared, at line %d \n", node->id, node->line_num);
+        printf("==================================================================================== \n");
     }
+}
 
-    typeChecking(node);
 
-    if(node->sibling)
+// arrays are only used with an index and scalars never are
+void checkArrayUse(SymbolTable* symbolTable, TreeNode* node)
+{
+    if(!namesVariable(node) || node->node_kind == ARRAY_NODE)
+        return;
+    VariableInfo* varInfo = symbolTable->Find(node->id);
+    if(varInfo->is_array && !indexOf(node))
+    {
+        printf("======================================================================= \n");
+        printf("Error!! the array %s is used without an index, at line %d \n", node->id, node->line_num);
+        printf("======================================================================= \n");
+    }
+    if(!varInfo->is_array && indexOf(node))
     {
-         buildSymbolTable(node->sibling, symbol_table);
+        printf("======================================================================= \n");
+        printf("Error!! %s is indexed but is not an array, at line %d \n", node->id, node->line_num);
+        printf("======================================================================= \n");
     }
 }
 
 
-//runs the operations / evaluates the conditions / returns the variables
-int run(TreeNode* node, SymbolTable* symbol_table, int* variables)
+// a procedure is declared once, before its body so that it can call itself
+void declareProcedure(SymbolTable* symbolTable, TreeNode* node)
 {
-    if(node->node_kind == NUM_NODE)
+    if(!symbolTable->InsertProc(node))
     {
-        int num = node->num;
-        return num;
+        printf("======================================================================= \n");
+        printf("Error!! the procedure %s is declared twice, at line %d \n", node->id, node->line_num);
+        printf("======================================================================= \n");
     }
+}
 
-    //assign / write / read
-    if(node->node_kind == ID_NODE)
+
+// a procedure is called after it is declared, with one argument per parameter
+void checkCall(SymbolTable* symbolTable, TreeNode* node)
+{
+    if(node->node_kind != CALL_NODE)
+        return;
+    ProcInfo* procInfo = symbolTable->FindProc(node->id);
+    if(!procInfo)
     {
-        VariableInfo* varInfo = symbol_table->Find(node->id);
-        int var = variables[varInfo->memloc];
-        return var;
+        printf("=============================================================================== \n");
+        printf("Error!! the procedure %s is called before it is declared, at line %d \n", node->id, node->line_num);
+        printf("=============================================================================== \n");
+        return;
     }
 
-    int leftChild, rightChild;
-    leftChild = run(node->child[0], symbol_table, variables);
-    rightChild = run(node->child[1], symbol_table, variables);
+    procInfo->num_calls++;
+    int numArgs = 0;
+    TreeNode* arg;
+    for(arg = node->child[0]; arg; arg = arg->sibling)
+        numArgs++;
+    if(numArgs != procInfo->num_params)
+    {
+        printf("=============================================================================== \n");
+        printf("Error!! the procedure %s takes %d arguments but is called with %d, at line %d \n",
+               node->id, procInfo->num_params, numArgs, node->line_num);
+        printf("=============================================================================== \n");
+    }
+}
 
-    if(node->oper == EQUAL)
+
+// fused front end hooks, both do nothing when the symbol table is built by buildSymbolTable
+void insertSymbol(ParseInfo* parseInfo, TreeNode* node)
+{
+    if(parseInfo->symbol_table)
     {
-        int condition;
-        if(leftChild == rightChild)
+        if(node->node_kind == PROC_NODE)
+            declareProcedure(parseInfo->symbol_table, node);
+        else
+            insertVariable(parseInfo->symbol_table, node);
+    }
+}
+
+
+// inserts and checks the variables of an expression parsed without the symbol table, in the order of buildSymbolTable
+void insertSymbols(ParseInfo* parseInfo, TreeNode* node)
+{
+    int i;
+    if(!parseInfo->symbol_table)
+        return;
+    for(; node; node = node->sibling)
+    {
+        if(namesVariable(node))
+            insertSymbol(parseInfo, node);
+        for(i = 0; i < MAX_CHILDREN; i++)
+            insertSymbols(parseInfo, node->child[i]);
+        checkNode(parseInfo, node);
+    }
+}
+
+
+// a tree with syntax errors is not type checked, the nodes put in for missing parts would be reported
+void checkNode(ParseInfo* parseInfo, TreeNode* node)
+{
+    if(parseInfo->symbol_table && parseInfo->diagnostics->count == 0)
+    {
+        typeChecking(node);
+        checkArrayUse(parseInfo->symbol_table, node);
+        checkCall(parseInfo->symbol_table, node);
+    }
+}
+
+
+void buildSymbolTable(TreeNode* node, SymbolTable* symbol_table)
+{
+    STATS_TIMER(PHASE_SYMBOL_TABLE);
+    int i;
+    for(; node; node = node->sibling) //siblings are visited iteratively so long programs do not deepen the recursion
+    {
+        if(node->node_kind == PROC_NODE)
         {
-            condition = 1;
+            declareProcedure(symbol_table, node);
         }
-        else
+        else if(namesVariable(node))
         {
-            condition = 0;
+            insertVariable(symbol_table, node);
         }
 
-        return condition;
+        for(i = 0; i < MAX_CHILDREN; i++)
+        {
+            if(node->child[i])
+            {
+                 buildSymbolTable(node->child[i], symbol_table);
+            }
+        }
+
+        typeChecking(node);
+        checkArrayUse(symbol_table, node);
+        checkCall(symbol_table, node);
     }
+}
 
-    else if(node->oper == LESS_THAN)
+////////////////////////////////////////////////////////////////////////////////////
+// Parallel Semantic Analysis //////////////////////////////////////////////////////
+
+// buildSymbolTable split over chunks of consecutive top-level statements. The chunks are shared
+// out to the workers in contiguous ranges; a worker takes the chunks of its own range from the
+// front and, once they are done, steals from the back of the others. A chunk is checked on its
+// own into a buffer of its variables in the order they first occur, with their line locations.
+// The buffers are then merged into the symbol table in chunk order, which numbers the memory
+// locations and orders the line locations exactly as the serial pass does. The procedures and
+// calls of the chunks are checked at the merge in the same order. Whether an array is used right
+// only depends on the first occurrence of its name, so it is checked at the merge as well.
+// A program with a semantic error is checked again by buildSymbolTable, which prints the errors
+// in the same order as always.
+
+#define CHUNKS_PER_WORKER 8
+
+// a variable named in a chunk
+struct LocalVar
+{
+    const char* name;   // the id of a node of the tree, which outlives the chunk
+    int hash;           // SymbolTable::Hash(name)
+    int size;           // of the array if its first occurrence declares it, else 0
+    int num_decls;      // array statements declaring it
+    bool plain_use;     // used without an index
+    bool indexed_use;   // used with an index
+    LineLocation* head_line;
+    LineLocation* tail_line;
+    LocalVar* next_var;   // in the order of first occurrence
+    LocalVar* next_entry; // in the same bucket of the worker's table
+};
+
+// a proc statement or a call, where buildSymbolTable would check it
+struct ProcEvent
+{
+    TreeNode* node;
+    ProcEvent* next;
+};
+
+struct SemanticChunk
+{
+    TreeNode* first;    // top-level statement
+    int num_stmts;
+    LocalVar* head_var;
+    LocalVar* tail_var;
+    ProcEvent* head_event;
+    ProcEvent* tail_event;
+    bool type_error;
+};
+
+// the chunks of one worker that are not taken yet
+struct ChunkQueue
+{
+    mutex lock;
+    int head, tail;
+};
+
+struct SemanticAnalysis
+{
+    SymbolTable* symbol_table;
+    SemanticChunk* chunks;
+    ChunkQueue* queues;
+    int num_workers;
+    atomic<int> steals;
+};
+
+void addProcEvent(SemanticChunk* chunk, TreeNode* node)
+{
+    ProcEvent* event = new ProcEvent;
+    event->node = node;
+    event->next = 0;
+    if(chunk->tail_event)
+        chunk->tail_event->next = event;
+    else
+        chunk->head_event = event;
+    chunk->tail_event = event;
+}
+
+// the buffer entry of the variable named by node, with the line of node added
+LocalVar* noteVariable(SymbolTable* symbolTable, LocalVar** buckets, SemanticChunk* chunk, TreeNode* node)
+{
+    int hash = symbolTable->Hash(node->id);
+    LocalVar* var;
+    for(var = buckets[hash]; var; var = var->next_entry)
+        if(Equals(var->name, node->id))
+            break;
+    if(!var)
     {
-        int condition;
-        if(leftChild < rightChild)
+        var = new LocalVar;
+        var->name = node->id;
+        var->hash = hash;
+        var->size = node->node_kind == ARRAY_NODE ? (int)node->child[0]->num : 0;
+        var->num_decls = 0;
+        var->plain_use = var->indexed_use = false;
+        var->head_line = var->tail_line = 0;
+        var->next_var = 0;
+        var->next_entry = buckets[hash];
+        buckets[hash] = var;
+        if(chunk->tail_var)
+            chunk->tail_var->next_var = var;
+        else
+            chunk->head_var = var;
+        chunk->tail_var = var;
+    }
+
+    LineLocation* lineloc = new LineLocation;
+    lineloc->line_num = node->line_num;
+    lineloc->next = 0;
+    if(var->tail_line)
+        var->tail_line->next = lineloc;
+    else
+        var->head_line = lineloc;
+    var->tail_line = lineloc;
+
+    if(node->node_kind == ARRAY_NODE)
+        var->num_decls++;
+    else if(indexOf(node))
+        var->indexed_use = true;
+    else
+        var->plain_use = true;
+    return var;
+}
+
+// one node and its subtrees in the order of buildSymbolTable
+void checkChunkNode(SymbolTable* symbolTable, LocalVar** buckets, SemanticChunk* chunk, TreeNode* node)
+{
+    if(node->node_kind == PROC_NODE)
+        addProcEvent(chunk, node);
+    else if(namesVariable(node))
+        noteVariable(symbolTable, buckets, chunk, node);
+
+    int i;
+    TreeNode* child;
+    for(i = 0; i < MAX_CHILDREN; i++)
+        for(child = node->child[i]; child; child = child->sibling)
+            checkChunkNode(symbolTable, buckets, chunk, child);
+
+    if(typeChecking(node, false))
+        chunk->type_error = true;
+    if(node->node_kind == CALL_NODE)
+        addProcEvent(chunk, node);
+}
+
+void checkChunk(SymbolTable* symbolTable, LocalVar** buckets, SemanticChunk* chunk)
+{
+    int i;
+    TreeNode* node = chunk->first;
+    for(i = 0; i < chunk->num_stmts; i++, node = node->sibling)
+        checkChunkNode(symbolTable, buckets, chunk, node);
+
+    // the table of the worker is empty again for its next chunk
+    LocalVar* var;
+    for(var = chunk->head_var; var; var = var->next_var)
+        buckets[var->hash] = 0;
+}
+
+void semanticWorker(SemanticAnalysis* analysis, int id)
+{
+    int i;
+    LocalVar** buckets = new LocalVar*[SYMBOL_HASH_SIZE];
+    for(i = 0; i < SYMBOL_HASH_SIZE; i++)
+        buckets[i] = 0;
+    for(;;)
+    {
+        int chunk = -1;
         {
-            condition = 1;
+            ChunkQueue* own = &analysis->queues[id];
+            lock_guard<mutex> guard(own->lock);
+            if(own->head < own->tail)
+                chunk = own->head++;
         }
-        else
+        for(i = 1; chunk < 0 && i < analysis->num_workers; i++)
         {
-            condition = 0;
+            ChunkQueue* victim = &analysis->queues[(id+i) % analysis->num_workers];
+            lock_guard<mutex> guard(victim->lock);
+            if(victim->head < victim->tail)
+            {
+                chunk = --victim->tail;
+                analysis->steals++;
+            }
         }
+        if(chunk < 0) // nothing is ever added to the queues, so the work is done
+            break;
+        checkChunk(analysis->symbol_table, buckets, &analysis->chunks[chunk]);
+    }
+    delete[] buckets;
+}
 
-        return condition;
+// merges the chunk buffers in order, returns false if buildSymbolTable would print an error
+bool mergeChunks(SymbolTable* symbolTable, SemanticChunk* chunks, int numChunks)
+{
+    int c;
+    bool ok = true;
+    for(c = 0; c < numChunks; c++)
+    {
+        SemanticChunk* chunk = &chunks[c];
+        ok = ok && !chunk->type_error;
+        LocalVar* var = chunk->head_var;
+        while(var)
+        {
+            bool created;
+            VariableInfo* varInfo = symbolTable->Merge(var->name, var->hash, var->size, var->head_line,
+                                                       var->tail_line, &created);
+            int laterDecls = var->num_decls - (created && var->size > 0 ? 1 : 0);
+            if(laterDecls > 0 || (varInfo->is_array && var->plain_use) || (!varInfo->is_array && var->indexed_use))
+                ok = false;
+            LocalVar* next = var->next_var;
+            delete var;
+            var = next;
+        }
     }
 
-    else if(node->oper == PLUS)
+    for(c = 0; c < numChunks; c++)
     {
-        int result = leftChild + rightChild;
-        return result;
+        ProcEvent* event = chunks[c].head_event;
+        while(event)
+        {
+            TreeNode* node = event->node;
+            if(ok && node->node_kind == PROC_NODE)
+                ok = symbolTable->InsertProc(node);
+            else if(ok)
+            {
+                ProcInfo* procInfo = symbolTable->FindProc(node->id);
+                int numArgs = 0;
+                TreeNode* arg;
+                for(arg = node->child[0]; arg; arg = arg->sibling)
+                    numArgs++;
+                ok = procInfo && procInfo->num_params == numArgs;
+                if(ok)
+                    procInfo->num_calls++;
+            }
+            ProcEvent* next = event->next;
+            delete event;
+            event = next;
+        }
     }
+    return ok;
+}
 
-    else if(node->oper == MINUS)
+// buildSymbolTable on numThreads threads, returns the number of chunks, 0 if the program is too short
+// to be split, and the number of them that were stolen
+int buildSymbolTableParallel(TreeNode* tree, SymbolTable* symbolTable, int numThreads, int* steals)
+{
+    int i, numStmts = 0;
+    TreeNode* node;
+    for(node = tree; node; node = node->sibling)
+        numStmts++;
+    int numChunks = min(numStmts, numThreads*CHUNKS_PER_WORKER);
+    *steals = 0;
+    if(numThreads < 2 || numChunks < 2*numThreads)
     {
-        int result = leftChild - rightChild;
-        return result;
+        buildSymbolTable(tree, symbolTable);
+        return 0;
     }
 
-    else if(node->oper == TIMES)
+    SemanticAnalysis analysis;
+    analysis.symbol_table = symbolTable;
+    analysis.num_workers = numThreads;
+    analysis.steals = 0;
+    analysis.chunks = new SemanticChunk[numChunks];
+    analysis.queues = new ChunkQueue[numThreads];
+    for(i = 0, node = tree; i < numChunks; i++)
     {
-        int result = leftChild * rightChild;
-        return result;
+        SemanticChunk* chunk = &analysis.chunks[i];
+        chunk->first = node;
+        chunk->num_stmts = numStmts/numChunks + (i < numStmts % numChunks ? 1 : 0);
+        chunk->head_var = chunk->tail_var = 0;
+        chunk->head_event = chunk->tail_event = 0;
+        chunk->type_error = false;
+        int j;
+        for(j = 0; j < chunk->num_stmts; j++)
+            node = node->sibling;
+    }
+    for(i = 0; i < numThreads; i++)
+    {
+        analysis.queues[i].head = (long long)numChunks*i/numThreads;
+        analysis.queues[i].tail = (long long)numChunks*(i+1)/numThreads;
     }
 
-    else if(node->oper == DIVIDE)
+    thread* workers = new thread[numThreads-1];
+    for(i = 1; i < numThreads; i++)
+        workers[i-1] = thread(semanticWorker, &analysis, i);
+    semanticWorker(&analysis, 0);
+    for(i = 1; i < numThreads; i++)
+        workers[i-1].join();
+    delete[] workers;
+
+    if(!mergeChunks(symbolTable, analysis.chunks, numChunks))
     {
-        int result = leftChild / rightChild;
-        return result;
+        symbolTable->Destroy();
+        buildSymbolTable(tree, symbolTable);
+    }
+    delete[] analysis.chunks;
+    delete[] analysis.queues;
+    *steals = analysis.steals;
+    return numChunks;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+// Profiler ////////////////////////////////////////////////////////////////////////
+
+// cycle counter of the profiler, nanoseconds where there is no cycle counter
+inline unsigned long long ReadCycles()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct ProfileCounters
+{
+    long long hits;
+    unsigned long long self_cycles;  // time in the node itself
+    unsigned long long total_cycles; // time in the node and its children
+};
 
+struct Profiler
+{
+    int num_nodes;
+    ProfileCounters* counters;        // indexed by TreeNode::index
+    unsigned long long child_cycles; // total cycles of the finished children of the current node
+
+    Profiler(int _num_nodes)
+    {
+        num_nodes = _num_nodes;
+        counters = new ProfileCounters[num_nodes];
+        memset(counters, 0, num_nodes*sizeof(ProfileCounters));
+        child_cycles = 0;
     }
+    ~Profiler(){delete[] counters;}
+};
 
-    else if(node->oper == POWER)
+// profiles one run of a statement until the end of the enclosing scope, does nothing without a profiler.
+// Expression nodes are only counted: reading the cycle counter twice costs more than evaluating most
+// of them, so their time is part of the self time of their statement.
+struct ProfileScope
+{
+    Profiler* profiler;
+    TreeNode* node;
+    unsigned long long start, outer_child_cycles;
+
+    ProfileScope(Profiler* _profiler, TreeNode* _node)
     {
-        return pow(leftChild, rightChild);
+        profiler = _profiler;
+        node = _node;
+        start = outer_child_cycles = 0;
+        if(!profiler)
+            return;
+        outer_child_cycles = profiler->child_cycles;
+        profiler->child_cycles = 0;
+        start = ReadCycles();
     }
 
-    else
+    ~ProfileScope()
     {
-        throw 0;
-        return 0;
+        if(!profiler)
+            return;
+        unsigned long long total = ReadCycles() - start;
+        ProfileCounters* counters = &profiler->counters[node->index];
+        counters->hits++;
+        counters->total_cycles += total;
+        counters->self_cycles += total - min(total, profiler->child_cycles);
+        profiler->child_cycles = outer_child_cycles + total;
     }
-}
+};
 
 
-//runs the if-statement / repeat-statement / assign-statement / read-statement / write-statement
-void runCode(TreeNode* node, SymbolTable* symbolTable, int* memory)
+// gives every node its pre-order number in TreeNode::index, returns the number of nodes
+int numberNodes(TreeNode* node, int next = 0)
 {
-    if(node->node_kind == IF_NODE)
+    int i;
+    for(; node; node = node->sibling)
     {
-        //child[0] = the condition
-        //child[1] = the body
-        //child[2] = the else part body
-        int condition = run(node->child[0], symbolTable, memory);
+        node->index = next++;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                next = numberNodes(node->child[i], next);
+    }
+    return next;
+}
 
-        // if the condition of the if-statement is true
-        if(condition)
-        {
-            runCode(node->child[1], symbolTable, memory);
-        }
-        else if(node->child[2])
+
+string profileFrameName(TreeNode* node)
+{
+    string name = to_string(node->line_num) + ":" + NodeKindStr[node->node_kind];
+    if(node->node_kind == OPER_NODE)
+        name = name + "[" + TokenTypeStr[node->oper] + "]";
+    else if(hasIdName(node))
+        name = name + "[" + node->id + "]";
+    return name;
+}
+
+
+struct LineProfile
+{
+    long long hits;
+    unsigned long long self_cycles, total_cycles;
+};
+
+// a line is entered when a node on it is reached from a node on another line: only those
+// nodes count as hits and inclusive time of the line, nested nodes of the same line add self time
+void collectProfile(TreeNode* node, int parent_line, Profiler* profiler, LineProfile* lines,
+                    const string& stack, map<string, unsigned long long>* folded)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        ProfileCounters* counters = &profiler->counters[node->index];
+        LineProfile* line = &lines[node->line_num];
+        if(node->line_num != parent_line)
         {
-            runCode(node->child[2], symbolTable, memory);
+            line->hits += counters->hits;
+            line->total_cycles += counters->total_cycles;
         }
+        line->self_cycles += counters->self_cycles;
+
+        string nodeStack = stack + ";" + profileFrameName(node);
+        if(counters->self_cycles)
+            (*folded)[nodeStack] += counters->self_cycles;
+
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                collectProfile(node->child[i], node->line_num, profiler, lines, nodeStack, folded);
     }
+}
 
-    else if(node->node_kind == REPEAT_NODE)
+
+// writes prefix.lines.txt, the source annotated with hits and cycles per line, and prefix.folded,
+// the self cycles per tree path as collapsed stacks for flamegraph tools
+bool writeProfile(TreeNode* tree, Profiler* profiler, const char* sourcePath, const char* prefix)
+{
+    int maxLine = 0;
+    InFile source(sourcePath);
+    string listingPath = string(prefix) + ".lines.txt", foldedPath = string(prefix) + ".folded";
+    FILE* listing = fopen(listingPath.c_str(), "w");
+    FILE* foldedFile = fopen(foldedPath.c_str(), "w");
+    if(!source.file || !listing || !foldedFile)
     {
-        int condition;
-        do
-        {
-           runCode(node->child[0], symbolTable, memory);
-           condition = run(node->child[1], symbolTable, memory);
-        }
-        while(!condition);
+        if(listing) fclose(listing);
+        if(foldedFile) fclose(foldedFile);
+        return false;
     }
 
-    else if(node->node_kind == ASSIGN_NODE)
+    while(source.GetNewLine())
+        maxLine = source.cur_line_num;
+    fseek(source.file, 0, SEEK_SET);
+    source.cur_line_num = 0;
+
+    LineProfile* lines = new LineProfile[maxLine+2];
+    memset(lines, 0, (maxLine+2)*sizeof(LineProfile));
+    map<string, unsigned long long> folded;
+    collectProfile(tree, -1, profiler, lines, "program", &folded);
+
+    fprintf(listing, "%12s %16s %16s | source\n", "hits", "self cycles", "total cycles");
+    while(source.GetNewLine())
     {
-        int var = run(node->child[0], symbolTable, memory);
-        VariableInfo* varInfo = symbolTable->Find(node->id);
-        memory[varInfo->memloc] = var;
+        LineProfile* line = &lines[source.cur_line_num];
+        char* text = source.line_buf;
+        int len = strlen(text);
+        while(len > 0 && (text[len-1] == '\n' || text[len-1] == '\r'))
+            text[--len] = 0;
+
+        if(line->hits || line->self_cycles)
+            fprintf(listing, "%12lld %16llu %16llu | %s\n", line->hits, line->self_cycles, line->total_cycles, text);
+        else
+            fprintf(listing, "%12s %16s %16s | %s\n", "", "", "", text);
     }
 
-    else if(node->node_kind == READ_NODE)
+    map<string, unsigned long long>::iterator it;
+    for(it = folded.begin(); it != folded.end(); ++it)
+        fprintf(foldedFile, "%s %llu\n", it->first.c_str(), it->second);
+
+    delete[] lines;
+    fclose(listing);
+    fclose(foldedFile);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Profile-Guided Optimization /////////////////////////////////////////////////////
+
+// --profile-gen records branch outcomes, loop trip counts and variable accesses of a run into a
+// text profile, --profile-use reads it back in a later compile:
+//   tiny-profile 1
+//   var <name> <accesses>
+//   if <line> <hash> <cond hash> <true count> <false count>
+//   repeat <line> <hash> <cond hash> <entries> <iterations> <min trips> <max trips>
+// The hashes cover the shape of the statement (kinds, operators and names, but no numbers or line
+// numbers), so a record still finds its statement after lines are inserted above it or a constant
+// is changed; if the statement itself was edited, it is matched by its line and its condition.
+// The trip counts size the groups of counted loops (see Loop Unrolling).
+
+struct BranchCounters
+{
+    long long taken;      // if: condition true, repeat: entries
+    long long not_taken;  // if: condition false, repeat: iterations
+    long long min_trips, max_trips;
+};
+
+// filled by an instrumented run
+struct PgoCounters
+{
+    int num_nodes, num_vars;
+    BranchCounters* branches; // indexed by TreeNode::index
+    long long* var_accesses;  // indexed by memloc
+
+    PgoCounters(int _num_nodes, int _num_vars)
     {
-        printf("Enter the value of %s: ", node->id);
-        VariableInfo* varInfo = symbolTable->Find(node->id);
-        scanf("%d", &memory[varInfo->memloc]);
+        num_nodes = _num_nodes;
+        num_vars = _num_vars;
+        branches = new BranchCounters[num_nodes];
+        memset(branches, 0, num_nodes*sizeof(BranchCounters));
+        var_accesses = new long long[num_vars];
+        memset(var_accesses, 0, num_vars*sizeof(long long));
     }
+    ~PgoCounters(){delete[] branches; delete[] var_accesses;}
 
-    else if(node->node_kind == WRITE_NODE)
+    void Branch(TreeNode* node, int condition)
+    {
+        if(condition)
+            branches[node->index].taken++;
+        else
+            branches[node->index].not_taken++;
+    }
+
+    void Loop(TreeNode* node, long long trips)
+    {
+        BranchCounters* counters = &branches[node->index];
+        if(counters->taken == 0 || trips < counters->min_trips)
+            counters->min_trips = trips;
+        if(trips > counters->max_trips)
+            counters->max_trips = trips;
+        counters->taken++;
+        counters->not_taken += trips;
+    }
+};
+
+
+unsigned int shapeHash(TreeNode* node, unsigned int hash = 2166136261u)
+{
+    int i;
+    hash = (hash ^ (unsigned int)(node->node_kind+1)) * 16777619u;
+    if(node->node_kind == OPER_NODE)
+        hash = (hash ^ (unsigned int)node->oper) * 16777619u;
+    else if(hasIdName(node))
     {
-        int var = run(node->child[0], symbolTable, memory);
-        printf("the value is: %d\n", var);
+        const char* c;
+        for(c = node->id; *c; c++)
+            hash = (hash ^ (unsigned char)*c) * 16777619u;
     }
 
-    if(node->sibling)
+    for(i = 0; i < MAX_CHILDREN; i++)
     {
-        runCode(node->sibling, symbolTable, memory);
+        hash = (hash ^ 0x9e) * 16777619u;
+        TreeNode* child;
+        for(child = node->child[i]; child; child = child->sibling)
+            hash = shapeHash(child, hash);
     }
+    return hash;
 }
 
 
-void codeGeneration(TreeNode* syntaxTree, SymbolTable* symbolTable)
+unsigned int conditionHash(TreeNode* node)
 {
-    int i;
-    int* memory = new int[symbolTable->num_vars];
+    return shapeHash(node->node_kind == IF_NODE ? node->child[0] : node->child[1]);
+}
+
 
-    for(i = 0; i < symbolTable->num_vars; i++)
+// calls visit for every if and repeat node
+void forEachBranch(TreeNode* node, void (*visit)(TreeNode*, void*), void* data)
+{
+    int i;
+    for(; node; node = node->sibling)
     {
-       memory[i] = 0;
+        if(node->node_kind == IF_NODE || node->node_kind == REPEAT_NODE)
+            visit(node, data);
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                forEachBranch(node->child[i], visit, data);
     }
+}
+
+
+struct PgoWriter
+{
+    FILE* file;
+    PgoCounters* counters;
+};
 
-    runCode(syntaxTree, symbolTable, memory);
-    delete[] memory;
+void writeBranchRecord(TreeNode* node, void* data)
+{
+    PgoWriter* writer = (PgoWriter*)data;
+    BranchCounters* c = &writer->counters->branches[node->index];
+    if(node->node_kind == IF_NODE)
+        fprintf(writer->file, "if %d %u %u %lld %lld\n", node->line_num, shapeHash(node), conditionHash(node),
+                c->taken, c->not_taken);
+    else
+        fprintf(writer->file, "repeat %d %u %u %lld %lld %lld %lld\n", node->line_num, shapeHash(node),
+                conditionHash(node), c->taken, c->not_taken, c->min_trips, c->max_trips);
 }
 
-int main()
+
+bool writePgoProfile(const char* path, TreeNode* tree, SymbolTable* symbolTable, PgoCounters* counters)
 {
-    string tempFilePath;
-    cin >> tempFilePath;
-    const char* filePath = tempFilePath.c_str();
+    FILE* file = fopen(path, "w");
+    if(!file)
+        return false;
 
-    if(!fopen(filePath,"r"))
+    fprintf(file, "tiny-profile 1\n");
+    int i;
+    for(i = 0; i < SYMBOL_HASH_SIZE; i++)
     {
-        throw 0;
+        VariableInfo* curv;
+        for(curv = symbolTable->var_info[i]; curv; curv = curv->next_var)
+            fprintf(file, "var %s %lld\n", curv->name, counters->var_accesses[curv->memloc]);
     }
 
-    //parsing phase
-    TreeNode* parseTree = syntaxAnalysis(filePath);
-    printf("\nSyntax Tree:\n");
-    printf("-------------\n");
-    printTree(parseTree);
-    printf("_________________________________________________________________\n\n");
+    PgoWriter writer;
+    writer.file = file;
+    writer.counters = counters;
+    forEachBranch(tree, writeBranchRecord, &writer);
 
+    fclose(file);
+    return true;
+}
 
-    //generating the symbol table
-    SymbolTable symbolTable;
-    buildSymbolTable(parseTree, &symbolTable);
-    printf("Symbol Table:\n");
-    printf("--------------\n");
-    symbolTable.Print();
-    printf("_________________________________________________________________\n\n");
 
+struct BranchRecord
+{
+    bool is_if;
+    int line_num;
+    unsigned int hash, cond_hash;
+    BranchCounters counters;
+    bool used;
+};
 
-    //code generation phase
-    printf("The run of the program:\n");
-    printf("------------------------\n");
-    codeGeneration(parseTree, &symbolTable);
-    printf("__________________________________________________________________\n\n");
+// a profile read by --profile-use, matched against the tree of the new compile
+struct PgoProfile
+{
+    map<string, long long> var_accesses;
+    BranchRecord* records;
+    int num_records;
 
-    DestroyTree(parseTree);
-    symbolTable.Destroy();
+    // the records not used yet, by kind and shape then by line, and by kind, line and condition
+    map<unsigned long long, multimap<int, BranchRecord*> > by_shape;
+    multimap<unsigned long long, BranchRecord*> by_line;
 
-    return 0;
+    int num_nodes;
+    BranchCounters** node_counters; // indexed by TreeNode::index, 0 if no record matched the node
+    int matched, unmatched;
+
+    PgoProfile(){records = 0; num_records = 0; num_nodes = 0; node_counters = 0; matched = unmatched = 0;}
+    ~PgoProfile(){delete[] records; delete[] node_counters;}
+
+    bool Read(const char* path)
+    {
+        FILE* file = fopen(path, "r");
+        if(!file)
+            return false;
+
+        char kind[16], name[MAX_LINE_LENGTH];
+        int version = 0;
+        if(fscanf(file, "tiny-profile %d", &version) != 1 || version != 1)
+        {
+            fclose(file);
+            return false;
+        }
+
+        int capacity = 0;
+        while(fscanf(file, "%15s", kind) == 1)
+        {
+            if(Equals(kind, "var"))
+            {
+                long long count;
+                if(fscanf(file, "%9999s %lld", name, &count) == 2)
+                    var_accesses[name] = count;
+                continue;
+            }
+            if(num_records == capacity)
+            {
+                capacity = 2*capacity + 16;
+                BranchRecord* grown = new BranchRecord[capacity];
+                if(num_records)
+                    memcpy(grown, records, num_records*sizeof(BranchRecord));
+                delete[] records;
+                records = grown;
+            }
+
+            BranchRecord* r = &records[num_records];
+            memset(r, 0, sizeof(BranchRecord));
+            r->is_if = Equals(kind, "if");
+            int n = fscanf(file, "%d %u %u %lld %lld", &r->line_num, &r->hash, &r->cond_hash,
+                           &r->counters.taken, &r->counters.not_taken);
+            if(!r->is_if)
+                n += fscanf(file, "%lld %lld", &r->counters.min_trips, &r->counters.max_trips);
+            if(n != (r->is_if ? 5 : 7))
+                break;
+            num_records++;
+        }
+        fclose(file);
+        return true;
+    }
+
+    static unsigned long long ShapeKey(bool isIf, unsigned int hash)
+    {
+        return ((unsigned long long)hash << 1) | isIf;
+    }
+
+    static unsigned long long LineKey(bool isIf, int lineNum, unsigned int condHash)
+    {
+        return ((unsigned long long)(unsigned int)lineNum << 33) | ((unsigned long long)condHash << 1) | isIf;
+    }
+
+    // takes a record out of both indexes
+    void Use(BranchRecord* r)
+    {
+        r->used = true;
+        multimap<int, BranchRecord*>& lines = by_shape[ShapeKey(r->is_if, r->hash)];
+        multimap<int, BranchRecord*>::iterator it = lines.lower_bound(r->line_num);
+        while(it->second != r)
+            ++it;
+        lines.erase(it);
+
+        multimap<unsigned long long, BranchRecord*>::iterator at = by_line.lower_bound(LineKey(r->is_if, r->line_num, r->cond_hash));
+        while(at->second != r)
+            ++at;
+        by_line.erase(at);
+    }
+
+    void MatchNode(TreeNode* node)
+    {
+        bool isIf = (node->node_kind == IF_NODE);
+        BranchRecord* best = 0;
+
+        // the same statement, possibly moved: the closest line wins, the earlier one on a tie
+        map<unsigned long long, multimap<int, BranchRecord*> >::iterator shape = by_shape.find(ShapeKey(isIf, shapeHash(node)));
+        if(shape != by_shape.end() && !shape->second.empty())
+        {
+            multimap<int, BranchRecord*>& lines = shape->second;
+            multimap<int, BranchRecord*>::iterator after = lines.lower_bound(node->line_num);
+            if(after != lines.end())
+                best = after->second;
+            if(after != lines.begin())
+            {
+                multimap<int, BranchRecord*>::iterator before = lines.lower_bound((--after)->first);
+                if(!best || node->line_num - before->first <= best->line_num - node->line_num)
+                    best = before->second;
+            }
+        }
+        // an edited statement on the same line with the same condition
+        if(!best)
+        {
+            multimap<unsigned long long, BranchRecord*>::iterator at =
+                by_line.find(LineKey(isIf, node->line_num, conditionHash(node)));
+            if(at != by_line.end())
+                best = at->second;
+        }
+
+        if(best)
+        {
+            Use(best);
+            node_counters[node->index] = &best->counters;
+            matched++;
+        }
+        else
+            unmatched++;
+    }
+
+    void Match(TreeNode* tree, int _num_nodes)
+    {
+        int i;
+        for(i = 0; i < num_records; i++)
+        {
+            BranchRecord* r = &records[i];
+            by_shape[ShapeKey(r->is_if, r->hash)].insert(make_pair(r->line_num, r));
+            by_line.insert(make_pair(LineKey(r->is_if, r->line_num, r->cond_hash), r));
+        }
+
+        num_nodes = _num_nodes;
+        node_counters = new BranchCounters*[num_nodes];
+        memset(node_counters, 0, num_nodes*sizeof(BranchCounters*));
+        forEachBranch(tree, matchBranchRecord, this);
+    }
+
+    static void matchBranchRecord(TreeNode* node, void* data)
+    {
+        ((PgoProfile*)data)->MatchNode(node);
+    }
+
+    // numbers the tree that layoutTree copied into block again, the copies keep their records
+    void Renumber(TreeNode* tree, TreeNode* block)
+    {
+        BranchCounters** old = node_counters;
+        int i;
+        node_counters = new BranchCounters*[num_nodes];
+        for(i = 0; i < num_nodes; i++)
+            node_counters[i] = old[block[i].index];
+        numberNodes(tree);
+        for(i = 0; i < num_nodes; i++)
+            old[block[i].index] = node_counters[i];
+        delete[] node_counters;
+        node_counters = old;
+    }
+};
+
+
+// orders variables by descending access count, then by their old memloc (first occurrence)
+struct HotterVariable
+{
+    long long* accesses; // indexed by the old memloc, -1 for variables without a record
+
+    bool operator()(VariableInfo* a, VariableInfo* b) const
+    {
+        if(accesses[a->memloc] != accesses[b->memloc])
+            return accesses[a->memloc] > accesses[b->memloc];
+        return a->memloc < b->memloc;
+    }
+};
+
+// gives the most accessed variables the lowest memlocs, variables without a record keep their
+// first occurrence order after them
+void assignHotMemlocs(SymbolTable* symbolTable, PgoProfile* profile)
+{
+    int i, n = 0;
+    VariableInfo** vars = new VariableInfo*[symbolTable->num_vars];
+    for(i = 0; i < SYMBOL_HASH_SIZE; i++)
+    {
+        VariableInfo* curv;
+        for(curv = symbolTable->var_info[i]; curv; curv = curv->next_var)
+            vars[n++] = curv;
+    }
+
+    HotterVariable hotter;
+    hotter.accesses = new long long[symbolTable->num_vars];
+    for(i = 0; i < n; i++)
+    {
+        map<string, long long>::iterator it = profile->var_accesses.find(vars[i]->name);
+        hotter.accesses[vars[i]->memloc] = (it == profile->var_accesses.end()) ? -1 : it->second;
+    }
+
+    sort(vars, vars+n, hotter);
+    int next = 0;
+    for(i = 0; i < n; i++)
+    {
+        vars[i]->memloc = next;
+        next += vars[i]->size;
+    }
+
+    delete[] hotter.accesses;
+    delete[] vars;
+}
+
+
+// Copies the tree into one block of nodes in execution order, so the nodes of the hot paths are
+// contiguous in memory. Branches of an if taken in less than 1/16 of the recorded runs and loops
+// that never ran are moved behind everything else. The original nodes are released.
+struct TreeLayout
+{
+    PgoProfile* profile;
+    SymbolTable* symbol_table; // the procedures are pointed at the copies of their proc statements
+    TreeNode* block;
+    int used;
+    TreeNode*** cold_slots; // where a cold subtree is linked once it is copied
+    TreeNode** cold_trees;
+    int num_cold;
+};
+
+bool isColdChild(TreeNode* node, int i, PgoProfile* profile)
+{
+    BranchCounters* counters = profile->node_counters[node->index];
+    if(!counters)
+        return false;
+    if(node->node_kind == IF_NODE && i > 0)
+    {
+        long long runs = counters->taken + counters->not_taken;
+        long long hits = (i == 1) ? counters->taken : counters->not_taken;
+        return runs > 0 && hits*16 < runs;
+    }
+    if(node->node_kind == REPEAT_NODE)
+        return counters->taken == 0;
+    return false;
+}
+
+TreeNode* layoutSubtree(TreeNode* node, TreeLayout* layout)
+{
+    TreeNode* first = 0;
+    TreeNode** link = &first;
+    int i;
+    while(node)
+    {
+        TreeNode* copy = &layout->block[layout->used++];
+        *copy = *node;
+        *link = copy;
+        link = &copy->sibling;
+        if(node->node_kind == PROC_NODE)
+        {
+            ProcInfo* procInfo = layout->symbol_table->FindProc(node->id);
+            if(procInfo && procInfo->node == node)
+                procInfo->node = copy;
+        }
+
+        for(i = 0; i < MAX_CHILDREN; i++)
+        {
+            if(node->child[i] && isColdChild(node, i, layout->profile))
+            {
+                layout->cold_slots[layout->num_cold] = &copy->child[i];
+                layout->cold_trees[layout->num_cold++] = node->child[i];
+                copy->child[i] = 0;
+            }
+            else if(node->child[i])
+                copy->child[i] = layoutSubtree(node->child[i], layout);
+        }
+
+        TreeNode* next = node->sibling;
+        delete node;
+        node = next;
+    }
+    *link = 0;
+    return first;
+}
+
+TreeNode* layoutTree(TreeNode* tree, int numNodes, PgoProfile* profile, SymbolTable* symbolTable, TreeNode** block)
+{
+    TreeLayout layout;
+    layout.profile = profile;
+    layout.symbol_table = symbolTable;
+    layout.block = *block = new TreeNode[numNodes];
+    layout.used = 0;
+    layout.cold_slots = new TreeNode**[numNodes];
+    layout.cold_trees = new TreeNode*[numNodes];
+    layout.num_cold = 0;
+
+    TreeNode* newTree = layoutSubtree(tree, &layout);
+    int i;
+    for(i = 0; i < layout.num_cold; i++) // cold subtrees found here are appended and copied in turn
+        *layout.cold_slots[i] = layoutSubtree(layout.cold_trees[i], &layout);
+
+    delete[] layout.cold_slots;
+    delete[] layout.cold_trees;
+    return newTree;
+}
+
+// releases a tree made by layoutTree
+void DestroyTreeBlock(TreeNode* block, int numNodes)
+{
+    int i;
+    for(i = 0; i < numNodes; i++)
+    {
+        TreeNode* node = &block[i];
+        if(hasIdName(node))
+            if(node->id) delete[] node->id;
+    }
+    delete[] block;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Integers ////////////////////////////////////////////////////////////////////////
+
+// --int: 64-bit integers that wrap around, 64-bit integers that stop the run on overflow,
+// or integers of any size. With bigint the values that fit in 64 bits are kept as they are,
+// in the memory and as results of run, the others are BIG_VALUE there and live in BigInts.
+enum IntModel {INT_WRAP64, INT_CHECKED64, INT_BIGINT};
+const char* IntModelStr[] = {"wrap64", "checked64", "bigint"};
+
+// stands for a value that does not fit in 64 bits with --int=bigint, LLONG_MIN itself is kept in a BigInt
+const long long BIG_VALUE = LLONG_MIN;
+
+#define MAX_BIG_LIMBS (1<<12) // 131072 bits, a longer result stops the run, the operations are quadratic
+
+inline bool AddOverflows(long long a, long long b, long long* result)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_add_overflow(a, b, result);
+#else
+    if((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b))
+        return true;
+    *result = a + b;
+    return false;
+#endif
+}
+
+inline bool SubOverflows(long long a, long long b, long long* result)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_sub_overflow(a, b, result);
+#else
+    if((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b))
+        return true;
+    *result = a - b;
+    return false;
+#endif
+}
+
+inline bool MulOverflows(long long a, long long b, long long* result)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(a, b, result);
+#else
+    if(a > 0 ? (b > 0 ? a > LLONG_MAX / b : b < LLONG_MIN / a)
+             : (b > 0 ? a < LLONG_MIN / b : a != 0 && b < LLONG_MAX / a))
+        return true;
+    *result = a * b;
+    return false;
+#endif
+}
+
+// base^exponent, exponent >= 0, wrapping around
+long long wrapPower(long long base, long long exponent)
+{
+    unsigned long long result = 1, b = (unsigned long long)base;
+    while(exponent > 0)
+    {
+        if(exponent & 1)
+            result *= b;
+        b *= b;
+        exponent >>= 1;
+    }
+    return (long long)result;
+}
+
+// base^exponent, exponent >= 0, false if it does not fit in 64 bits
+bool powerFits(long long base, long long exponent, long long* result)
+{
+    if(base == 0 || base == 1)
+    {
+        *result = exponent == 0 ? 1 : base;
+        return true;
+    }
+    if(base == -1)
+    {
+        *result = exponent % 2 ? -1 : 1;
+        return true;
+    }
+    long long r = 1;
+    for(; exponent > 0; exponent--) // |base| >= 2, so this overflows within 64 steps
+        if(MulOverflows(r, base, &r))
+            return false;
+    *result = r;
+    return true;
+}
+
+
+// Integers of any size for --int=bigint: sign and magnitude in 32-bit limbs, least significant first.
+// The limbs are never shrunk, a BigInt that is reused only allocates when a value outgrows it.
+struct BigInt
+{
+    unsigned int* limbs;
+    int size, capacity; // no leading zero limbs, size 0 is zero
+    bool negative;
+
+    BigInt(){limbs = 0; size = capacity = 0; negative = false;}
+    ~BigInt(){delete[] limbs;}
+
+    void Reserve(int n)
+    {
+        if(n <= capacity)
+            return;
+        int newCapacity = max(n, 2*capacity);
+        unsigned int* grown = new unsigned int[newCapacity];
+        if(size)
+            memcpy(grown, limbs, size*sizeof(unsigned int));
+        delete[] limbs;
+        limbs = grown;
+        capacity = newCapacity;
+    }
+
+    void Trim()
+    {
+        while(size > 0 && limbs[size-1] == 0)
+            size--;
+        if(size == 0)
+            negative = false;
+    }
+
+    void Set(long long v)
+    {
+        Reserve(2);
+        negative = v < 0;
+        unsigned long long u = negative ? 0-(unsigned long long)v : (unsigned long long)v;
+        limbs[0] = (unsigned int)u;
+        limbs[1] = (unsigned int)(u >> 32);
+        size = 2;
+        Trim();
+    }
+
+    void Swap(BigInt* b)
+    {
+        swap(limbs, b->limbs);
+        swap(size, b->size);
+        swap(capacity, b->capacity);
+        swap(negative, b->negative);
+    }
+
+    // false if the value does not fit in a long long
+    bool ToSmall(long long* v)
+    {
+        if(size > 2)
+            return false;
+        unsigned long long u = 0;
+        if(size > 0)
+            u = limbs[0];
+        if(size > 1)
+            u |= (unsigned long long)limbs[1] << 32;
+        if(u > (unsigned long long)LLONG_MAX + negative)
+            return false;
+        *v = negative ? (long long)(0-u) : (long long)u;
+        return true;
+    }
+
+    string ToString()
+    {
+        if(size == 0)
+            return "0";
+        unsigned int* rest = new unsigned int[size];
+        memcpy(rest, limbs, size*sizeof(unsigned int));
+        int i, n = size;
+        string digits; // 9 at a time, least significant first
+        while(n > 0)
+        {
+            unsigned long long rem = 0;
+            for(i = n-1; i >= 0; i--)
+            {
+                unsigned long long cur = (rem << 32) | rest[i];
+                rest[i] = (unsigned int)(cur / 1000000000);
+                rem = cur % 1000000000;
+            }
+            while(n > 0 && rest[n-1] == 0)
+                n--;
+            for(i = 0; i < 9 && (n > 0 || rem > 0); i++, rem /= 10)
+                digits += (char)('0' + rem%10);
+        }
+        delete[] rest;
+        if(negative)
+            digits += '-';
+        return string(digits.rbegin(), digits.rend());
+    }
+};
+
+int compareMagnitude(const BigInt* a, const BigInt* b)
+{
+    int i;
+    if(a->size != b->size)
+        return a->size < b->size ? -1 : 1;
+    for(i = a->size-1; i >= 0; i--)
+        if(a->limbs[i] != b->limbs[i])
+            return a->limbs[i] < b->limbs[i] ? -1 : 1;
+    return 0;
+}
+
+int bigCompare(const BigInt* a, const BigInt* b)
+{
+    if(a->negative != b->negative)
+        return a->negative ? -1 : 1;
+    int c = compareMagnitude(a, b);
+    return a->negative ? -c : c;
+}
+
+// |r| = |a| + |b|, r is neither a nor b
+void addMagnitude(BigInt* r, const BigInt* a, const BigInt* b)
+{
+    if(a->size < b->size)
+        swap(a, b);
+    r->Reserve(a->size+1);
+    unsigned long long carry = 0;
+    int i;
+    for(i = 0; i < a->size; i++)
+    {
+        carry += (unsigned long long)a->limbs[i] + (i < b->size ? b->limbs[i] : 0);
+        r->limbs[i] = (unsigned int)carry;
+        carry >>= 32;
+    }
+    r->limbs[i] = (unsigned int)carry;
+    r->size = a->size+1;
+}
+
+// |r| = |a| - |b| for |a| >= |b|, r may be a
+void subMagnitude(BigInt* r, const BigInt* a, const BigInt* b)
+{
+    r->Reserve(a->size);
+    long long borrow = 0;
+    int i, size = a->size;
+    for(i = 0; i < size; i++)
+    {
+        long long cur = (long long)a->limbs[i] - (i < b->size ? b->limbs[i] : 0) - borrow;
+        borrow = cur < 0;
+        r->limbs[i] = (unsigned int)(cur + (borrow << 32));
+    }
+    r->size = size;
+}
+
+// r = a + b or a - b, r is neither a nor b
+void bigAdd(BigInt* r, const BigInt* a, const BigInt* b, bool subtract)
+{
+    bool bNegative = b->negative != subtract;
+    if(a->negative == bNegative)
+    {
+        addMagnitude(r, a, b);
+        r->negative = a->negative;
+    }
+    else if(compareMagnitude(a, b) >= 0)
+    {
+        subMagnitude(r, a, b);
+        r->negative = a->negative;
+    }
+    else
+    {
+        subMagnitude(r, b, a);
+        r->negative = bNegative;
+    }
+    r->Trim();
+}
+
+// r = a * b, r is neither a nor b, false if the result would have more than MAX_BIG_LIMBS limbs
+bool bigMultiply(BigInt* r, const BigInt* a, const BigInt* b)
+{
+    if(a->size + b->size > MAX_BIG_LIMBS)
+        return false;
+    int i, j, size = a->size + b->size;
+    r->Reserve(size);
+    memset(r->limbs, 0, size*sizeof(unsigned int));
+    for(i = 0; i < a->size; i++)
+    {
+        unsigned long long carry = 0;
+        for(j = 0; j < b->size; j++)
+        {
+            carry += (unsigned long long)a->limbs[i]*b->limbs[j] + r->limbs[i+j];
+            r->limbs[i+j] = (unsigned int)carry;
+            carry >>= 32;
+        }
+        r->limbs[i+b->size] = (unsigned int)carry;
+    }
+    r->size = size;
+    r->negative = a->negative != b->negative;
+    r->Trim();
+    return true;
+}
+
+// q = a / b rounded toward zero like the / of 64-bit integers, b != 0, q is neither a nor b
+void bigDivide(BigInt* q, const BigInt* a, const BigInt* b, BigInt* rem)
+{
+    int i;
+    q->Reserve(a->size);
+    q->size = a->size;
+    memset(q->limbs, 0, a->size*sizeof(unsigned int));
+    if(b->size == 1)
+    {
+        unsigned long long r = 0;
+        for(i = a->size-1; i >= 0; i--)
+        {
+            unsigned long long cur = (r << 32) | a->limbs[i];
+            q->limbs[i] = (unsigned int)(cur / b->limbs[0]);
+            r = cur % b->limbs[0];
+        }
+    }
+    else
+    {
+        // one bit at a time, the remainder stays below 2|b|
+        rem->Reserve(b->size+1);
+        rem->size = 0;
+        for(i = 32*a->size-1; i >= 0; i--)
+        {
+            int j;
+            unsigned int carry = (a->limbs[i/32] >> (i%32)) & 1;
+            for(j = 0; j < rem->size; j++)
+            {
+                unsigned int next = rem->limbs[j] >> 31;
+                rem->limbs[j] = (rem->limbs[j] << 1) | carry;
+                carry = next;
+            }
+            if(carry)
+                rem->limbs[rem->size++] = carry;
+            if(compareMagnitude(rem, b) >= 0)
+            {
+                subMagnitude(rem, rem, b);
+                rem->Trim();
+                q->limbs[i/32] |= 1u << (i%32);
+            }
+        }
+    }
+    q->negative = a->negative != b->negative;
+    q->Trim();
+}
+
+// r = base^exponent, exponent >= 0, r is not base, false if the result would be too long
+bool bigPower(BigInt* r, const BigInt* base, long long exponent, BigInt* temp)
+{
+    int bits = 32*base->size;
+    while(bits > 0 && !((base->limbs[(bits-1)/32] >> ((bits-1)%32)) & 1))
+        bits--;
+    if(bits > 1 && exponent > 32LL*MAX_BIG_LIMBS/(bits-1))
+        return false;
+
+    BigInt* square = &temp[0];
+    square->Reserve(base->size);
+    memcpy(square->limbs, base->limbs, base->size*sizeof(unsigned int));
+    square->size = base->size;
+    square->negative = base->negative;
+    r->Set(1);
+    while(exponent > 0)
+    {
+        if(exponent & 1)
+        {
+            if(!bigMultiply(&temp[1], r, square))
+                return false;
+            r->Swap(&temp[1]);
+        }
+        exponent >>= 1;
+        if(exponent > 0)
+        {
+            if(!bigMultiply(&temp[1], square, square))
+                return false;
+            square->Swap(&temp[1]);
+        }
+    }
+    return true;
+}
+
+
+// The values of --int=bigint expressions being evaluated that do not fit in 64 bits: run returns
+// BIG_VALUE for such a value and pushes it here, and whatever uses the value pops it, so the stack
+// follows the evaluation of the tree. The BigInts are reused from one operation to the next.
+struct BigStack
+{
+    BigInt* items;
+    int top, capacity;
+    BigInt operand[2]; // the operands of an operation that fit in 64 bits
+    BigInt result;
+    BigInt temp[2];
+
+    BigStack(){capacity = 16; items = new BigInt[capacity]; top = 0;}
+    ~BigStack(){delete[] items;}
+
+    BigInt* Push()
+    {
+        int i;
+        if(top == capacity)
+        {
+            BigInt* grown = new BigInt[2*capacity];
+            for(i = 0; i < capacity; i++)
+                grown[i].Swap(&items[i]);
+            delete[] items;
+            items = grown;
+            capacity *= 2;
+        }
+        return &items[top++];
+    }
+
+    BigInt* Top(int depth = 0){return &items[top-1-depth];}
+    void Pop(){top--;}
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Code Generation /////////////////////////////////////////////////////////////////
+
+// why a run was stopped before the end of the program
+enum BudgetKind {BUDGET_NONE, BUDGET_STEPS, BUDGET_ITERATIONS, BUDGET_TIME};
+const char* BudgetKindStr[] = {"None", "steps", "loop iterations", "time"};
+
+// thrown out of runCode when a budget runs out, caught by the caller of runCode
+struct BudgetExceeded
+{
+    BudgetKind kind;
+    int line_num; // line of the repeat or call whose next trip or call would go over the budget
+};
+
+// nodes of one trip of a loop body or condition, nested loops charge their own trips
+long long tripCost(TreeNode* node)
+{
+    long long cost = 0;
+    int i;
+    for(; node; node = node->sibling)
+    {
+        cost++;
+        if(node->node_kind == REPEAT_NODE)
+            continue;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                cost += tripCost(node->child[i]);
+    }
+    return cost;
+}
+
+// Execution budgets for untrusted programs. They are checked only when a repeat loop starts a trip
+// (the loop entry and its back-edges) and when a procedure is called: code outside loops and calls
+// runs at most once per statement, only loops and recursion can run for long. Each trip is charged
+// the nodes of the loop body and condition (both branches of an if count), so the step count is an
+// upper bound of the evaluated nodes; a call is charged the nodes of the body and one iteration.
+// A trip that would go over a limit is not started. The clock is read once every
+// CLOCK_CHECK_STEPS charged steps, not on every trip.
+const long long CLOCK_CHECK_STEPS = 1<<16;
+
+struct Budget
+{
+    long long max_steps, max_iterations, timeout_ms; // 0 = no limit
+    long long steps_left, iterations_left, clock_countdown;
+    bool started;
+    chrono::steady_clock::time_point start, deadline;
+    BudgetExceeded exceeded; // kind is BUDGET_NONE while the budget lasts
+
+    Budget(long long _max_steps, long long _max_iterations, long long _timeout_ms)
+    {
+        max_steps = _max_steps;
+        max_iterations = _max_iterations;
+        timeout_ms = _timeout_ms;
+        steps_left = max_steps ? max_steps : LLONG_MAX;
+        iterations_left = max_iterations ? max_iterations : LLONG_MAX;
+        clock_countdown = timeout_ms ? CLOCK_CHECK_STEPS : LLONG_MAX;
+        started = false;
+        exceeded.kind = BUDGET_NONE;
+        exceeded.line_num = 0;
+    }
+
+    // the deadline counts from the first call, later calls (next streamed statements) keep it
+    void Start()
+    {
+        if(started)
+            return;
+        started = true;
+        start = chrono::steady_clock::now();
+        deadline = start + chrono::milliseconds(timeout_ms);
+    }
+
+    void Trip(TreeNode* loop)
+    {
+        if(loop->trip_cost == 0)
+            loop->trip_cost = tripCost(loop->child[0]) + tripCost(loop->child[1]);
+        Charge(loop, loop->trip_cost);
+    }
+
+    void Call(TreeNode* call, ProcInfo* procInfo)
+    {
+        if(procInfo->call_cost == 0)
+            procInfo->call_cost = tripCost(procInfo->node->child[1]) + 1;
+        Charge(call, procInfo->call_cost);
+    }
+
+    // node is the repeat or call statement
+    void Charge(TreeNode* node, long long cost)
+    {
+        steps_left -= cost;
+        iterations_left--;
+        clock_countdown -= cost;
+        if(steps_left < 0 || iterations_left < 0 || clock_countdown <= 0)
+            Check(node, cost);
+    }
+
+    void Check(TreeNode* node, long long cost)
+    {
+        BudgetExceeded e;
+        e.line_num = node->line_num;
+        if(steps_left < 0)
+            e.kind = BUDGET_STEPS;
+        else if(iterations_left < 0)
+            e.kind = BUDGET_ITERATIONS;
+        else
+        {
+            clock_countdown = CLOCK_CHECK_STEPS;
+            if(chrono::steady_clock::now() < deadline)
+                return;
+            e.kind = BUDGET_TIME;
+        }
+        // the trip or call is not run, so it is not counted
+        steps_left += cost;
+        iterations_left++;
+        throw e;
+    }
+
+    long long Steps(){return max_steps ? max_steps-steps_left : LLONG_MAX-steps_left;}
+    long long Iterations(){return max_iterations ? max_iterations-iterations_left : LLONG_MAX-iterations_left;}
+
+    // path:line: error: budget exceeded: loop iterations (limit 1000), after ...
+    void Print(const char* path)
+    {
+        long long limit = exceeded.kind == BUDGET_STEPS ? max_steps :
+                          exceeded.kind == BUDGET_ITERATIONS ? max_iterations : timeout_ms;
+        printf("%s:%d: error: budget exceeded: %s (limit %lld%s), after %lld steps, %lld iterations, %.3f ms\n",
+               path, exceeded.line_num, BudgetKindStr[exceeded.kind], limit,
+               exceeded.kind == BUDGET_TIME ? " ms" : "", Steps(), Iterations(),
+               chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+};
+
+// the nodes of a numbered tree by index, with the statement whose body (or condition) holds each one
+struct NodeIndex
+{
+    int num_nodes;
+    TreeNode** nodes;
+    TreeNode** parents; // 0 for top-level statements
+
+    NodeIndex(TreeNode* tree, int _num_nodes)
+    {
+        num_nodes = _num_nodes;
+        nodes = new TreeNode*[num_nodes];
+        parents = new TreeNode*[num_nodes];
+        Add(tree, 0);
+    }
+    ~NodeIndex(){delete[] nodes; delete[] parents;}
+
+    void Add(TreeNode* node, TreeNode* parent)
+    {
+        int i;
+        for(; node; node = node->sibling)
+        {
+            nodes[node->index] = node;
+            parents[node->index] = parent;
+            for(i = 0; i < MAX_CHILDREN; i++)
+                if(node->child[i])
+                    Add(node->child[i], node);
+        }
+    }
+};
+
+// FNV-1a of the source file, a checkpoint is only resumed by the program that wrote it
+unsigned long long fileHash(const char* path)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    FILE* file = fopen(path, "rb");
+    if(!file)
+        return 0;
+    int ch;
+    while((ch = fgetc(file)) != EOF)
+        hash = (hash ^ (unsigned char)ch) * 1099511628211ULL;
+    fclose(file);
+    return hash;
+}
+
+// closes the file and renames it over path, so a crash leaves either the old or the new file
+bool replaceFile(FILE* file, const char* tmpPath, const char* path)
+{
+    bool ok = fflush(file) == 0;
+#if defined(_WIN32)
+    ok = ok && _commit(_fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok && MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok && rename(tmpPath, path) == 0;
+#endif
+}
+
+// Checkpoints of long runs. Between statements the whole state of a run is the memory, the number
+// of values read so far and the position, so a checkpoint is taken when a repeat loop starts a
+// trip and the position is the chain of statements from the top level down to that loop:
+//   tiny-checkpoint 1
+//   program <hash of the source>
+//   reads <values read>
+//   path <length> <node index>...
+//   memory <num vars> <value>...
+struct Checkpointer
+{
+    const char* path;
+    string tmp_path;
+    long long every, countdown; // a checkpoint every `every` loop trips
+    unsigned long long program_hash;
+    NodeIndex* node_index;
+    int num_vars;
+    int written;
+    double write_ms;            // total time spent writing checkpoints
+
+    Checkpointer(const char* _path, long long _every, unsigned long long _program_hash,
+                 NodeIndex* _node_index, int _num_vars)
+    {
+        path = _path;
+        tmp_path = string(path) + ".tmp";
+        every = countdown = _every;
+        program_hash = _program_hash;
+        node_index = _node_index;
+        num_vars = _num_vars;
+        written = 0;
+        write_ms = 0;
+    }
+
+    void Trip(TreeNode* loop, long long* memory, long long reads)
+    {
+        if(--countdown > 0)
+            return;
+        countdown = every;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if(Write(loop, memory, reads))
+            written++;
+        write_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    bool Write(TreeNode* loop, long long* memory, long long reads)
+    {
+        FILE* file = fopen(tmp_path.c_str(), "w");
+        if(!file)
+            return false;
+
+        int depth = 0, i;
+        TreeNode* node;
+        for(node = loop; node; node = node_index->parents[node->index])
+            depth++;
+
+        int* chain = new int[depth];
+        for(node = loop, i = depth-1; node; node = node_index->parents[node->index], i--)
+            chain[i] = node->index;
+
+        fprintf(file, "tiny-checkpoint 1\nprogram %016llx\nreads %lld\npath %d", program_hash, reads, depth);
+        for(i = 0; i < depth; i++)
+            fprintf(file, " %d", chain[i]);
+        delete[] chain;
+        fprintf(file, "\nmemory %d", num_vars);
+        for(i = 0; i < num_vars; i++)
+            fprintf(file, " %lld", memory[i]);
+        fprintf(file, "\n");
+
+        return replaceFile(file, tmp_path.c_str(), path);
+    }
+};
+
+
+// an error that stops a run, like an index out of the bounds of an array
+struct RunError
+{
+    int line_num; // 0 as long as there is no error
+    char message[2*MAX_TOKEN_LEN+100];
+};
+
+struct VectorLoop;
+struct CountedLoop;
+struct ParallelBatch;
+struct ThreadPool;
+
+#define FRAME_POOL_SIZE (1<<16)
+#define MAX_CALL_DEPTH 10000
+
+// Activation frames of procedure calls. A parameter x of f is the variable f.x, a call keeps the
+// values the parameters had in its frame while the body runs and puts them back on return, so a
+// recursive call does not change the parameters of its caller. Frames are taken from one block
+// allocated before the run, a call never allocates. Calls are nested up to MAX_CALL_DEPTH deep, and
+// less when their bodies nest deep enough to use 3/4 of the stack of the thread below the run.
+struct FramePool
+{
+    long long* slots;
+    BigInt** big_slots; // with --int=bigint, the BigInts of the values that are BIG_VALUE
+    int capacity, top;
+    int depth, max_depth; // calls running now and at most
+    char* stack_base;     // a local of the function that starts the run, 0 if the stack is not checked
+    long stack_bytes;     // the stack calls may use below stack_base
+
+    FramePool(int _capacity, bool big)
+    {
+        int i;
+        capacity = _capacity;
+        slots = capacity ? new long long[capacity] : 0;
+        big_slots = 0;
+        if(capacity && big)
+        {
+            big_slots = new BigInt*[capacity];
+            for(i = 0; i < capacity; i++)
+                big_slots[i] = 0;
+        }
+        top = 0;
+        depth = max_depth = 0;
+        stack_base = 0;
+        stack_bytes = runStackBytes();
+    }
+    ~FramePool(){delete[] slots; delete[] big_slots;}
+
+    // the main thread has the stack of the process, 1 MB on Windows
+    static long runStackBytes()
+    {
+#ifdef _WIN32
+        return 3*(1L<<20)/4;
+#else
+        struct rlimit limit;
+        if(getrlimit(RLIMIT_STACK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY)
+            return 3*(8L<<20)/4;
+        return (long)(3*(limit.rlim_cur/4));
+#endif
+    }
+
+    long long* Push(int size, TreeNode* call)
+    {
+        char here;
+        if(depth == MAX_CALL_DEPTH || top + size > capacity || (stack_base && stack_base - &here > stack_bytes))
+        {
+            RunError e;
+            e.line_num = call->line_num;
+            sprintf(e.message, "the calls of %s are nested too deep", call->id);
+            throw e;
+        }
+        long long* frame = &slots[top];
+        top += size;
+        depth++;
+        max_depth = max(max_depth, depth);
+        return frame;
+    }
+
+    void Pop(int size)
+    {
+        top -= size;
+        depth--;
+    }
+};
+
+// state of one run of the program
+struct RunInfo
+{
+    SymbolTable* symbol_table;
+    long long* memory;
+    int memory_size;    // locations in memory, more once a lazy body adds variables
+    IntModel int_model;
+    BigInt** big_memory; // --int=bigint: the BigInt of each memory location that holds BIG_VALUE, or 0
+    BigStack* big_stack; // --int=bigint: the big values of the expressions being evaluated
+    Profiler* profiler; // 0 unless the run is profiled
+    PgoCounters* pgo;   // 0 unless the run records a profile for --profile-use
+    Budget* budget;     // 0 unless the run has execution budgets
+    Checkpointer* checkpointer; // 0 unless the run writes checkpoints
+    FramePool* frames;  // 0 if the program has no procedures
+    long long reads;    // values read from the input so far
+    long long* given_values; // --specialize: the first num_given reads take given_values where given is set
+    bool* given;
+    int num_given;
+    bool bounds_check;  // array indexes are checked unless --no-bounds-check
+    VectorLoop** vector_loops; // by TreeNode::index, 0 if array loops are run node by node
+    CountedLoop** counted_loops; // by TreeNode::index, 0 if every loop checks its condition every trip
+    ParallelBatch** parallel_batches; // by TreeNode::index of their first statement, 0 if all runs in order
+    ThreadPool* pool;   // runs the parallel batches
+    atomic<int>* first_failed; // in a parallel batch: the first statement that failed, later ones stop
+    int stmt;           // in a parallel batch: the statement being run
+    LazySource* lazy;   // --lazy: where the if bodies left to the run are parsed from
+    RunError error;     // why the run stopped, if it did
+
+    RunInfo(SymbolTable* _symbol_table, long long* _memory)
+    {
+        symbol_table = _symbol_table;
+        memory = _memory;
+        memory_size = 0;
+        int_model = INT_WRAP64;
+        big_memory = 0;
+        big_stack = 0;
+        profiler = 0;
+        pgo = 0;
+        budget = 0;
+        checkpointer = 0;
+        frames = 0;
+        reads = 0;
+        given_values = 0;
+        given = 0;
+        num_given = 0;
+        bounds_check = true;
+        vector_loops = 0;
+        counted_loops = 0;
+        parallel_batches = 0;
+        lazy = 0;
+        pool = 0;
+        first_failed = 0;
+        stmt = 0;
+        error.line_num = 0;
+        error.message[0] = 0;
+    }
+};
+
+
+long long run(TreeNode* node, RunInfo* runInfo);
+
+void throwRunError(TreeNode* node, const char* message)
+{
+    RunError e;
+    e.line_num = node->line_num;
+    Copy(e.message, message);
+    throw e;
+}
+
+const char* operatorStr(TokenType oper)
+{
+    int i;
+    for(i = 0; i < num_symbolic_tokens; i++)
+        if(symbolic_tokens[i].type == oper)
+            return symbolic_tokens[i].str;
+    return "?";
+}
+
+// --int=bigint: an operation with an operand that does not fit in 64 bits, or whose result does not.
+// The big operands are on the big stack, the right one on top.
+long long runBig(TreeNode* node, long long left, long long right, RunInfo* runInfo)
+{
+    BigStack* stack = runInfo->big_stack;
+    int numBig = (left == BIG_VALUE) + (right == BIG_VALUE);
+    BigInt* b = right == BIG_VALUE ? stack->Top() : &stack->operand[1];
+    BigInt* a = left == BIG_VALUE ? stack->Top(right == BIG_VALUE) : &stack->operand[0];
+    if(left != BIG_VALUE)
+        a->Set(left);
+    if(right != BIG_VALUE)
+        b->Set(right);
+
+    BigInt* r = &stack->result;
+    bool fits = true;
+    long long value;
+    if(node->oper == EQUAL || node->oper == LESS_THAN)
+    {
+        int c = bigCompare(a, b);
+        stack->top -= numBig;
+        return node->oper == EQUAL ? c == 0 : c < 0;
+    }
+    else if(node->oper == PLUS || node->oper == MINUS)
+        bigAdd(r, a, b, node->oper == MINUS);
+    else if(node->oper == TIMES)
+        fits = bigMultiply(r, a, b);
+    else if(node->oper == DIVIDE)
+    {
+        if(b->size == 0)
+            throwRunError(node, "division by zero");
+        bigDivide(r, a, b, &stack->temp[0]);
+    }
+    else
+    {
+        long long exponent, base;
+        if(!b->ToSmall(&exponent)) // only the sign and the parity matter then
+            exponent = (b->negative ? -2 : LLONG_MAX-1) + (b->limbs[0] & 1);
+
+        if(a->ToSmall(&base) && (base == 0 || base == 1 || base == -1))
+        {
+            if(base == 0 && exponent < 0)
+                throwRunError(node, "division by zero");
+            r->Set(base == 0 ? exponent == 0 : (base == -1 && exponent % 2 ? -1 : 1));
+        }
+        else if(exponent < 0)
+            r->Set(0);
+        else
+            fits = bigPower(r, a, exponent, stack->temp);
+    }
+    if(!fits)
+    {
+        char message[100];
+        sprintf(message, "the result of %s does not fit in %d bits", operatorStr(node->oper), 32*MAX_BIG_LIMBS);
+        throwRunError(node, message);
+    }
+
+    stack->top -= numBig;
+    if(r->ToSmall(&value) && value != BIG_VALUE)
+        return value;
+    stack->Push()->Swap(r);
+    return BIG_VALUE;
+}
+
+// an operation whose result does not fit in 64 bits, or is LLONG_MIN with --int=bigint
+long long outOfRange(TreeNode* node, long long left, long long right, RunInfo* runInfo)
+{
+    if(runInfo->int_model == INT_BIGINT)
+        return runBig(node, left, right, runInfo);
+
+    char message[100];
+    sprintf(message, "integer overflow in %lld %s %lld", left, operatorStr(node->oper), right);
+    throwRunError(node, message);
+    return 0;
+}
+
+// base^exponent for exponent < 0, the integer part of 1/base^-exponent
+long long negativePower(TreeNode* node, long long base, long long exponent)
+{
+    if(base == 0)
+        throwRunError(node, "division by zero");
+    if(base == 1 || base == -1)
+        return base == -1 && exponent % 2 ? -1 : 1;
+    return 0;
+}
+
+// with --int=bigint, takes the big value of an expression off the big stack
+void dropValue(long long value, RunInfo* runInfo)
+{
+    if(value == BIG_VALUE && runInfo->big_stack)
+        runInfo->big_stack->Pop();
+}
+
+// a condition holds if it is not 0, BIG_VALUE is never 0
+bool isTrue(long long value, RunInfo* runInfo)
+{
+    dropValue(value, runInfo);
+    return value != 0;
+}
+
+// stores a value in the memory, with --int=bigint a big value is moved from the big stack
+void storeValue(long long* var, long long value, RunInfo* runInfo)
+{
+    *var = value;
+    if(value != BIG_VALUE || !runInfo->big_stack)
+        return;
+    BigInt** big = &runInfo->big_memory[var - runInfo->memory];
+    if(!*big)
+        *big = new BigInt;
+    (*big)->Swap(runInfo->big_stack->Top());
+    runInfo->big_stack->Pop();
+}
+
+// reads a value from the memory, with --int=bigint a big value is copied to the big stack
+long long loadValue(long long* var, RunInfo* runInfo)
+{
+    if(*var != BIG_VALUE || !runInfo->big_stack)
+        return *var;
+    BigInt* big = runInfo->big_memory[var - runInfo->memory];
+    BigInt* copy = runInfo->big_stack->Push();
+    copy->Reserve(big->size);
+    memcpy(copy->limbs, big->limbs, big->size*sizeof(unsigned int));
+    copy->size = big->size;
+    copy->negative = big->negative;
+    return BIG_VALUE;
+}
+
+// the memory of the variable of an ID, ASSIGN or READ node, evaluating the index of an array element
+long long* varAddress(TreeNode* node, RunInfo* runInfo)
+{
+    VariableInfo* varInfo = runInfo->symbol_table->Find(node->id);
+    if(runInfo->pgo)
+        runInfo->pgo->var_accesses[varInfo->memloc]++;
+    TreeNode* index = indexOf(node);
+    if(!index)
+        return &runInfo->memory[varInfo->memloc];
+
+    long long i = run(index, runInfo);
+    dropValue(i, runInfo);
+    if((runInfo->bounds_check || (i == BIG_VALUE && runInfo->big_stack)) && (i < 0 || i >= varInfo->size))
+    {
+        char message[2*MAX_TOKEN_LEN+100];
+        if(i == BIG_VALUE && runInfo->big_stack)
+            sprintf(message, "an index of more than 64 bits is out of the bounds of %s[%d]", node->id, varInfo->size);
+        else
+            sprintf(message, "index %lld is out of the bounds of %s[%d]", i, node->id, varInfo->size);
+        throwRunError(node, message);
+    }
+    return &runInfo->memory[varInfo->memloc + i];
+}
+
+
+//runs the operations / evaluates the conditions / returns the variables
+long long run(TreeNode* node, RunInfo* runInfo)
+{
+    STATS_INC(node_evals);
+    if(runInfo->profiler)
+        runInfo->profiler->counters[node->index].hits++;
+    if(node->node_kind == NUM_NODE)
+    {
+        long long num = node->num;
+        return num;
+    }
+
+    //assign / write / read
+    if(node->node_kind == ID_NODE)
+    {
+        long long var = loadValue(varAddress(node, runInfo), runInfo);
+        return var;
+    }
+
+    long long leftChild, rightChild;
+    leftChild = run(node->child[0], runInfo);
+    rightChild = run(node->child[1], runInfo);
+
+    // wrap64 does the arithmetic on unsigned integers, which wrap around, the other models check it
+    IntModel model = runInfo->int_model;
+    bool big = model == INT_BIGINT;
+    if(big && (leftChild == BIG_VALUE || rightChild == BIG_VALUE))
+        return runBig(node, leftChild, rightChild, runInfo);
+
+    if(node->oper == EQUAL)
+    {
+        int condition;
+        if(leftChild == rightChild)
+        {
+            condition = 1;
+        }
+        else
+        {
+            condition = 0;
+        }
+
+        return condition;
+    }
+
+    else if(node->oper == LESS_THAN)
+    {
+        int condition;
+        if(leftChild < rightChild)
+        {
+            condition = 1;
+        }
+        else
+        {
+            condition = 0;
+        }
+
+        return condition;
+    }
+
+    else if(node->oper == PLUS)
+    {
+        long long result;
+        if(model == INT_WRAP64)
+            result = (long long)((unsigned long long)leftChild + (unsigned long long)rightChild);
+        else if(AddOverflows(leftChild, rightChild, &result) || (big && result == BIG_VALUE))
+            return outOfRange(node, leftChild, rightChild, runInfo);
+        return result;
+    }
+
+    else if(node->oper == MINUS)
+    {
+        long long result;
+        if(model == INT_WRAP64)
+            result = (long long)((unsigned long long)leftChild - (unsigned long long)rightChild);
+        else if(SubOverflows(leftChild, rightChild, &result) || (big && result == BIG_VALUE))
+            return outOfRange(node, leftChild, rightChild, runInfo);
+        return result;
+    }
+
+    else if(node->oper == TIMES)
+    {
+        long long result;
+        if(model == INT_WRAP64)
+            result = (long long)((unsigned long long)leftChild * (unsigned long long)rightChild);
+        else if(MulOverflows(leftChild, rightChild, &result) || (big && result == BIG_VALUE))
+            return outOfRange(node, leftChild, rightChild, runInfo);
+        return result;
+    }
+
+    else if(node->oper == DIVIDE)
+    {
+        if(rightChild == 0)
+            throwRunError(node, "division by zero");
+        if(leftChild == LLONG_MIN && rightChild == -1) // the one quotient that does not fit
+            return model == INT_WRAP64 ? LLONG_MIN : outOfRange(node, leftChild, rightChild, runInfo);
+        long long result = leftChild / rightChild;
+        return result;
+
+    }
+
+    else if(node->oper == POWER)
+    {
+        long long result;
+        if(rightChild < 0)
+            return negativePower(node, leftChild, rightChild);
+        if(model == INT_WRAP64)
+            return wrapPower(leftChild, rightChild);
+        if(!powerFits(leftChild, rightChild, &result) || (big && result == BIG_VALUE))
+            return outOfRange(node, leftChild, rightChild, runInfo);
+        return result;
+    }
+
+    else
+    {
+        throw 0;
+        return 0;
+    }
+}
+
+
+// A repeat loop that walks arrays element by element:
+//   repeat
+//     a[i] := <expr>; b[i] := <expr>; ...
+//     i := i + 1
+//   until i = <bound>
+// where every array is indexed by exactly i, the element expressions only use + - * on numbers,
+// i, array elements [i] and scalars (none of which the loop assigns) and the bound is an expression
+// of such scalars. The iterations are then independent, so the assignments are run over blocks of
+// VECTOR_BLOCK elements by plain loops over integer arrays that the C++ compiler vectorizes.
+// Only used with --int=wrap64, the loops compute on unsigned integers so they wrap around like run.
+
+#define VECTOR_BLOCK 256
+#define MAX_VECTOR_DEPTH 16
+
+enum VectorOpKind {VEC_NUM, VEC_SCALAR, VEC_COUNTER, VEC_ELEMENT, VEC_PLUS, VEC_MINUS, VEC_TIMES};
+
+// an element expression in postfix order, arg is the number or the memory location
+struct VectorOp
+{
+    VectorOpKind kind;
+    long long arg;
+};
+
+struct VectorAssign
+{
+    int target;     // memory location of the assigned array
+    VectorOp* ops;
+    int num_ops;
+};
+
+struct VectorLoop
+{
+    int counter;    // memory location of i
+    TreeNode* bound;
+    VectorAssign* assigns;
+    int num_assigns;
+    int min_size;   // size of the smallest array used, i stays below it
+};
+
+// appends the postfix form of an element expression, returns the stack depth it needs or 0 if
+// the expression cannot be vectorized
+int vectorOps(TreeNode* node, SymbolTable* symbolTable, const char* counter, VectorLoop* loop,
+              VectorOp* ops, int* numOps)
+{
+    if(*numOps >= 2*MAX_VECTOR_DEPTH)
+        return 0;
+    VectorOp* op = &ops[*numOps];
+    if(node->node_kind == NUM_NODE)
+    {
+        op->kind = VEC_NUM;
+        op->arg = node->num;
+        (*numOps)++;
+        return 1;
+    }
+    if(node->node_kind == ID_NODE)
+    {
+        VariableInfo* varInfo = symbolTable->Find(node->id);
+        TreeNode* index = node->child[0];
+        if(!index)
+        {
+            if(varInfo->is_array)
+                return 0;
+            op->kind = Equals(node->id, counter) ? VEC_COUNTER : VEC_SCALAR;
+            op->arg = varInfo->memloc;
+        }
+        else
+        {
+            if(!varInfo->is_array || index->node_kind != ID_NODE || index->child[0] || !Equals(index->id, counter))
+                return 0;
+            op->kind = VEC_ELEMENT;
+            op->arg = varInfo->memloc;
+            loop->min_size = min(loop->min_size, varInfo->size);
+        }
+        (*numOps)++;
+        return 1;
+    }
+    if(node->node_kind != OPER_NODE || (node->oper != PLUS && node->oper != MINUS && node->oper != TIMES))
+        return 0;
+
+    int left = vectorOps(node->child[0], symbolTable, counter, loop, ops, numOps);
+    int right = left ? vectorOps(node->child[1], symbolTable, counter, loop, ops, numOps) : 0;
+    if(!right || max(left, right+1) > MAX_VECTOR_DEPTH || *numOps >= 2*MAX_VECTOR_DEPTH)
+        return 0;
+    op = &ops[(*numOps)++];
+    op->kind = node->oper == PLUS ? VEC_PLUS : node->oper == MINUS ? VEC_MINUS : VEC_TIMES;
+    op->arg = 0;
+    return max(left, right+1);
+}
+
+// true for expressions that only use numbers and scalars other than the counter
+bool isLoopInvariant(TreeNode* node, SymbolTable* symbolTable, const char* counter)
+{
+    int i;
+    if(node->node_kind == ID_NODE)
+    {
+        if(node->child[0] || Equals(node->id, counter))
+            return false;
+        return !symbolTable->Find(node->id)->is_array;
+    }
+    for(i = 0; i < MAX_CHILDREN; i++)
+        if(node->child[i] && !isLoopInvariant(node->child[i], symbolTable, counter))
+            return false;
+    return true;
+}
+
+void DestroyVectorLoop(VectorLoop* loop)
+{
+    int i;
+    for(i = 0; i < loop->num_assigns; i++)
+        delete[] loop->assigns[i].ops;
+    delete[] loop->assigns;
+    delete loop;
+}
+
+// the plan of a repeat loop that walks arrays element by element, 0 for any other loop
+VectorLoop* matchVectorLoop(TreeNode* node, SymbolTable* symbolTable)
+{
+    //the last statement of the body is i := i + 1
+    TreeNode* last = node->child[0];
+    int numAssigns = 0;
+    for(; last->sibling; last = last->sibling)
+        numAssigns++;
+    if(last->node_kind != ASSIGN_NODE || last->child[1] || numAssigns == 0)
+        return 0;
+    const char* counter = last->id;
+    TreeNode* step = last->child[0];
+    if(step->node_kind != OPER_NODE || step->oper != PLUS)
+        return 0;
+    TreeNode* stepVar = step->child[0]->node_kind == ID_NODE ? step->child[0] : step->child[1];
+    TreeNode* stepNum = step->child[0]->node_kind == ID_NODE ? step->child[1] : step->child[0];
+    if(stepVar->node_kind != ID_NODE || stepVar->child[0] || !Equals(stepVar->id, counter) ||
+       stepNum->node_kind != NUM_NODE || stepNum->num != 1)
+        return 0;
+    if(symbolTable->Find(counter)->is_array)
+        return 0;
+
+    //until i = bound | until bound = i
+    TreeNode* condition = node->child[1];
+    if(condition->node_kind != OPER_NODE || condition->oper != EQUAL)
+        return 0;
+    TreeNode* bound = 0;
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+        TreeNode* side = condition->child[i];
+        if(side->node_kind == ID_NODE && !side->child[0] && Equals(side->id, counter))
+            bound = condition->child[1-i];
+    }
+    if(!bound || !isLoopInvariant(bound, symbolTable, counter))
+        return 0;
+
+    VectorLoop* loop = new VectorLoop;
+    loop->counter = symbolTable->Find(counter)->memloc;
+    loop->bound = bound;
+    loop->min_size = INT_MAX;
+    loop->num_assigns = 0;
+    loop->assigns = new VectorAssign[numAssigns];
+
+    //a[i] := <expr>, a being an array
+    TreeNode* cur;
+    for(cur = node->child[0]; cur != last; cur = cur->sibling)
+    {
+        VariableInfo* target = cur->node_kind == ASSIGN_NODE ? symbolTable->Find(cur->id) : 0;
+        TreeNode* index = cur->node_kind == ASSIGN_NODE ? cur->child[1] : 0;
+        if(!target || !target->is_array || !index || index->node_kind != ID_NODE || index->child[0] ||
+           !Equals(index->id, counter))
+            break;
+
+        VectorAssign* assign = &loop->assigns[loop->num_assigns++];
+        assign->target = target->memloc;
+        assign->ops = new VectorOp[2*MAX_VECTOR_DEPTH];
+        assign->num_ops = 0;
+        loop->min_size = min(loop->min_size, target->size);
+        if(!vectorOps(cur->child[0], symbolTable, counter, loop, assign->ops, &assign->num_ops))
+            break;
+    }
+    if(cur != last)
+    {
+        DestroyVectorLoop(loop);
+        return 0;
+    }
+    return loop;
+}
+
+// the plans of all the array loops of the tree by TreeNode::index, the tree must be numbered
+void planVectorLoops(TreeNode* node, SymbolTable* symbolTable, VectorLoop** loops)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        if(node->node_kind == REPEAT_NODE)
+            loops[node->index] = matchVectorLoop(node, symbolTable);
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                planVectorLoops(node->child[i], symbolTable, loops);
+    }
+}
+
+int countVectorLoops(VectorLoop** loops, int numNodes)
+{
+    int i, count = 0;
+    for(i = 0; i < numNodes; i++)
+        if(loops[i])
+            count++;
+    return count;
+}
+
+// the elements [first, first+n) of one assignment, n <= VECTOR_BLOCK
+void runVectorAssign(VectorAssign* assign, unsigned long long* memory, int first, int n)
+{
+    static thread_local unsigned long long buffers[MAX_VECTOR_DEPTH][VECTOR_BLOCK];
+    const unsigned long long* stack[MAX_VECTOR_DEPTH];
+    int i, k, sp = 0;
+    for(i = 0; i < assign->num_ops; i++)
+    {
+        VectorOp* op = &assign->ops[i];
+        unsigned long long* out = buffers[sp];
+        if(op->kind == VEC_ELEMENT)
+        {
+            stack[sp++] = &memory[op->arg + first];
+            continue;
+        }
+        if(op->kind == VEC_NUM || op->kind == VEC_SCALAR)
+        {
+            unsigned long long value = op->kind == VEC_NUM ? (unsigned long long)op->arg : memory[op->arg];
+            for(k = 0; k < n; k++)
+                out[k] = value;
+            stack[sp++] = out;
+            continue;
+        }
+        if(op->kind == VEC_COUNTER)
+        {
+            for(k = 0; k < n; k++)
+                out[k] = first + k;
+            stack[sp++] = out;
+            continue;
+        }
+
+        const unsigned long long* a = stack[sp-2];
+        const unsigned long long* b = stack[sp-1];
+        out = buffers[sp-2];
+        if(op->kind == VEC_PLUS)
+            for(k = 0; k < n; k++)
+                out[k] = a[k] + b[k];
+        else if(op->kind == VEC_MINUS)
+            for(k = 0; k < n; k++)
+                out[k] = a[k] - b[k];
+        else
+            for(k = 0; k < n; k++)
+                out[k] = a[k] * b[k];
+        stack[sp-2] = out;
+        sp--;
+    }
+    memmove(&memory[assign->target + first], stack[0], n*sizeof(unsigned long long));
+}
+
+// runs the loop if all its trips stay within the arrays, returns false to run it node by node
+bool runVectorLoop(VectorLoop* loop, RunInfo* runInfo)
+{
+    unsigned long long* memory = (unsigned long long*)runInfo->memory;
+    long long first = runInfo->memory[loop->counter];
+    long long bound = run(loop->bound, runInfo);
+    if(first < 0 || bound <= first || bound > loop->min_size)
+        return false;
+
+    int i, start;
+    for(start = first; start < bound; start += VECTOR_BLOCK)
+    {
+        int n = (int)min((long long)VECTOR_BLOCK, bound-start);
+        for(i = 0; i < loop->num_assigns; i++)
+            runVectorAssign(&loop->assigns[i], memory, start, n);
+    }
+    memory[loop->counter] = bound;
+    return true;
+}
+
+
+void runCode(TreeNode* node, RunInfo* runInfo, bool single = false);
+bool runCountedLoop(CountedLoop* loop, RunInfo* runInfo);
+
+////////////////////////////////////////////////////////////////////////////////////
+// Parallel Loops //////////////////////////////////////////////////////////////////
+
+// A region is a run of consecutive top-level statements that do no I/O and call no procedure.
+// Its statements are split into tasks by their memory accesses. If a variable is written by any
+// statement of the region, every statement that uses it is in the same task; an array counts as
+// one variable. Statements of different tasks then never see each other's variables, so the tasks
+// of a region can run on different threads. Each task runs its statements in program order and
+// gives the same output as running the region in order. A scalar that a statement writes before
+// reading it gets a new value that does not depend on the old one, so it is given a variable of
+// its own up to the next such statement, and loops reusing a counter are not chained; the last
+// value keeps the variable itself.
+// If statements fail, the error of the first one in program order is reported. A statement after it stops at its next loop trip, or
+// is not started, since it would never have run.
+
+#define MAX_THREADS 64
+#define PARALLEL_MIN_WORK 100000 // nodes a task evaluates, below it a thread costs more than it saves
+
+// a region whose statements are split into at least two tasks with enough work
+struct ParallelBatch
+{
+    TreeNode** stmts; // in program order
+    int num_stmts;
+    int* task_of;     // the task of each statement
+    int num_tasks;
+    RunError* errors; // by task, the error that stopped it
+    int* failed_at;   // by task, the statement that failed or INT_MAX
+};
+
+// thrown out of a statement of a batch once a statement before it has failed
+struct BatchCancelled {};
+
+void DestroyParallelBatch(ParallelBatch* batch)
+{
+    delete[] batch->stmts;
+    delete[] batch->task_of;
+    delete[] batch->errors;
+    delete[] batch->failed_at;
+    delete batch;
+}
+
+// memory locations used by one statement, written ones are also in used
+struct Accesses
+{
+    int* used;
+    int num_used, capacity;
+    bool* writes; // parallel to used
+
+    Accesses(){used = 0; writes = 0; num_used = capacity = 0;}
+    ~Accesses(){delete[] used; delete[] writes;}
+
+    void Add(int memloc, bool write)
+    {
+        if(num_used == capacity)
+        {
+            capacity = max(16, 2*capacity);
+            int* grownUsed = new int[capacity];
+            bool* grownWrites = new bool[capacity];
+            if(num_used)
+            {
+                memcpy(grownUsed, used, num_used*sizeof(int));
+                memcpy(grownWrites, writes, num_used*sizeof(bool));
+            }
+            delete[] used;
+            delete[] writes;
+            used = grownUsed;
+            writes = grownWrites;
+        }
+        used[num_used] = memloc;
+        writes[num_used++] = write;
+    }
+};
+
+// adds the variables of a statement to accesses, false if it does I/O or calls a procedure
+bool collectAccesses(TreeNode* node, SymbolTable* symbolTable, Accesses* accesses, bool* hasLoop)
+{
+    NodeKind kind = node->node_kind;
+    if(kind == READ_NODE || kind == WRITE_NODE || kind == CALL_NODE || kind == PROC_NODE || kind == ARRAY_NODE)
+        return false;
+    if(kind == REPEAT_NODE)
+        *hasLoop = true;
+    if(kind == ID_NODE || kind == ASSIGN_NODE)
+        accesses->Add(symbolTable->Find(node->id)->memloc, kind == ASSIGN_NODE);
+
+    int i;
+    TreeNode* child;
+    for(i = 0; i < MAX_CHILDREN; i++)
+        for(child = node->child[i]; child; child = child->sibling)
+            if(!collectAccesses(child, symbolTable, accesses, hasLoop))
+                return false;
+    return true;
+}
+
+// the variables are told apart by their memory locations, which memory compaction may share
+bool usesVariable(TreeNode* node, SymbolTable* symbolTable, int memloc)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        if(node->node_kind == ID_NODE && symbolTable->Find(node->id)->memloc == memloc)
+            return true;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(usesVariable(node->child[i], symbolTable, memloc))
+                return true;
+    }
+    return false;
+}
+
+enum FirstAccess {ACCESS_NONE, ACCESS_WRITE, ACCESS_READ};
+
+FirstAccess firstAccess(TreeNode* node, SymbolTable* symbolTable, int memloc);
+
+// how a statement first uses a scalar: it may read it, it writes it on every path before
+// reading it, or it does neither
+FirstAccess firstAccessOf(TreeNode* node, SymbolTable* symbolTable, int memloc)
+{
+    if(node->node_kind == ASSIGN_NODE)
+    {
+        if(usesVariable(node->child[0], symbolTable, memloc) || usesVariable(node->child[1], symbolTable, memloc))
+            return ACCESS_READ;
+        return symbolTable->Find(node->id)->memloc == memloc ? ACCESS_WRITE : ACCESS_NONE;
+    }
+    if(node->node_kind == REPEAT_NODE) // the body is run at least once
+    {
+        FirstAccess access = firstAccess(node->child[0], symbolTable, memloc);
+        if(access == ACCESS_NONE && usesVariable(node->child[1], symbolTable, memloc))
+            return ACCESS_READ;
+        return access;
+    }
+    if(node->node_kind == IF_NODE)
+    {
+        if(usesVariable(node->child[0], symbolTable, memloc))
+            return ACCESS_READ;
+        FirstAccess thenAccess = firstAccess(node->child[1], symbolTable, memloc);
+        FirstAccess elseAccess = firstAccess(node->child[2], symbolTable, memloc);
+        return thenAccess == elseAccess ? thenAccess : ACCESS_READ;
+    }
+    return ACCESS_NONE;
+}
+
+// the first use of a scalar by a statement sequence
+FirstAccess firstAccess(TreeNode* node, SymbolTable* symbolTable, int memloc)
+{
+    for(; node; node = node->sibling)
+    {
+        FirstAccess access = firstAccessOf(node, symbolTable, memloc);
+        if(access != ACCESS_NONE)
+            return access;
+    }
+    return ACCESS_NONE;
+}
+
+// adds the scalars that stmt writes before reading them, the new values they get do not depend on
+// the old ones. seen marks the ones already looked at
+void collectKills(TreeNode* stmt, TreeNode* node, SymbolTable* symbolTable, Accesses* kills, int* seen, int stamp)
+{
+    if(node->node_kind == ASSIGN_NODE && !node->child[1])
+    {
+        VariableInfo* varInfo = symbolTable->Find(node->id);
+        if(!varInfo->is_array && seen[varInfo->memloc] != stamp)
+        {
+            seen[varInfo->memloc] = stamp;
+            if(firstAccessOf(stmt, symbolTable, varInfo->memloc) == ACCESS_WRITE)
+                kills->Add(varInfo->memloc, true);
+        }
+    }
+
+    int i;
+    TreeNode* child;
+    for(i = 0; i < MAX_CHILDREN; i++)
+        for(child = node->child[i]; child; child = child->sibling)
+            collectKills(stmt, child, symbolTable, kills, seen, stamp);
+}
+
+// renames the variables of a statement that have a name in names, by memory location
+void renameVariables(TreeNode* node, SymbolTable* symbolTable, char** names)
+{
+    if(node->node_kind == ID_NODE || node->node_kind == ASSIGN_NODE)
+    {
+        char* name = names[symbolTable->Find(node->id)->memloc];
+        if(name)
+        {
+            delete[] node->id;
+            AllocateAndCopy(&node->id, name);
+        }
+    }
+
+    int i;
+    TreeNode* child;
+    for(i = 0; i < MAX_CHILDREN; i++)
+        for(child = node->child[i]; child; child = child->sibling)
+            renameVariables(child, symbolTable, names);
+}
+
+// gives every value of a scalar but the last one in the region a variable of its own. The run looks
+// variables up by name, so the new ones get short names that no identifier can have: #1f, #20...
+void renameVersions(TreeNode** stmts, int n, SymbolTable* symbolTable)
+{
+    int i, j, numVars = symbolTable->num_vars;
+    int* killsLeft = new int[numVars];
+    int* seen = new int[numVars];
+    char** names = new char*[numVars]; // of the current values, 0 for the variable itself
+    for(i = 0; i < numVars; i++)
+    {
+        killsLeft[i] = 0;
+        seen[i] = 0;
+        names[i] = 0;
+    }
+    Accesses kills;
+    for(i = 0; i < n; i++)
+    {
+        kills.num_used = 0;
+        collectKills(stmts[i], stmts[i], symbolTable, &kills, seen, i+1);
+        for(j = 0; j < kills.num_used; j++)
+            killsLeft[kills.used[j]]++;
+    }
+
+    for(i = 0; i < n; i++)
+    {
+        kills.num_used = 0;
+        collectKills(stmts[i], stmts[i], symbolTable, &kills, seen, n+i+1);
+        for(j = 0; j < kills.num_used; j++)
+        {
+            int memloc = kills.used[j];
+            delete[] names[memloc];
+            names[memloc] = 0;
+            if(--killsLeft[memloc] > 0)
+            {
+                char name[16];
+                sprintf(name, "#%x", symbolTable->num_vars);
+                symbolTable->Insert(name, stmts[i]->line_num);
+                AllocateAndCopy(&names[memloc], name);
+            }
+        }
+        renameVariables(stmts[i], symbolTable, names);
+    }
+    for(i = 0; i < numVars; i++)
+        delete[] names[i];
+    delete[] names;
+    delete[] seen;
+    delete[] killsLeft;
+}
+
+CountedLoop* matchCountedLoop(TreeNode* node, SymbolTable* symbolTable, int factor, bool closedForm);
+long long constantTrips(CountedLoop* loop, TreeNode* prev, SymbolTable* symbolTable);
+void DestroyCountedLoop(CountedLoop* loop);
+long long statementWork(TreeNode* node, TreeNode* prev, SymbolTable* symbolTable);
+
+// the nodes a statement sequence evaluates, up to PARALLEL_MIN_WORK
+long long sequenceWork(TreeNode* node, SymbolTable* symbolTable)
+{
+    long long work = 0;
+    TreeNode* prev = 0;
+    for(; node; prev = node, node = node->sibling)
+        work = min(work + statementWork(node, prev, symbolTable), (long long)PARALLEL_MIN_WORK);
+    return work;
+}
+
+// the nodes one run of a statement evaluates, up to PARALLEL_MIN_WORK: both branches of an if, and
+// the trips of a loop times the nodes of a trip. A loop whose trips are not known before the run
+// (see constantTrips) may run any number of them and counts as PARALLEL_MIN_WORK.
+long long statementWork(TreeNode* node, TreeNode* prev, SymbolTable* symbolTable)
+{
+    long long work = 1;
+    int i;
+    if(node->node_kind != REPEAT_NODE)
+    {
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                work += sequenceWork(node->child[i], symbolTable);
+        return min(work, (long long)PARALLEL_MIN_WORK);
+    }
+
+    long long trips = 0;
+    CountedLoop* loop = matchCountedLoop(node, symbolTable, 1, false);
+    if(loop)
+    {
+        trips = constantTrips(loop, prev, symbolTable);
+        DestroyCountedLoop(loop);
+    }
+    work += sequenceWork(node->child[0], symbolTable) + sequenceWork(node->child[1], symbolTable);
+    if(!trips || trips >= PARALLEL_MIN_WORK / work)
+        return PARALLEL_MIN_WORK;
+    return trips*work;
+}
+
+int findTask(int* parent, int i)
+{
+    while(parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+// splits the region stmts[0..n) into tasks, returns 0 if fewer than two of them have PARALLEL_MIN_WORK
+ParallelBatch* planRegion(TreeNode** stmts, Accesses* accesses, long long* work, int n, int numVars)
+{
+    if(n < 2)
+        return 0;
+    int i, j;
+    bool* written = new bool[numVars];
+    int* first = new int[numVars]; // the first statement using a written variable
+    int* parent = new int[n];
+    for(i = 0; i < numVars; i++)
+    {
+        written[i] = false;
+        first[i] = -1;
+    }
+    for(i = 0; i < n; i++)
+        for(j = 0; j < accesses[i].num_used; j++)
+            if(accesses[i].writes[j])
+                written[accesses[i].used[j]] = true;
+
+    for(i = 0; i < n; i++)
+    {
+        parent[i] = i;
+        for(j = 0; j < accesses[i].num_used; j++)
+        {
+            int memloc = accesses[i].used[j];
+            if(!written[memloc])
+                continue;
+            if(first[memloc] < 0)
+                first[memloc] = i;
+            else
+                parent[findTask(parent, i)] = findTask(parent, first[memloc]);
+        }
+    }
+
+    // the tasks are numbered in the order of their first statements
+    int* task_of = new int[n];
+    int* number = new int[n];
+    int numTasks = 0, heavyTasks = 0;
+    for(i = 0; i < n; i++)
+        number[i] = -1;
+    for(i = 0; i < n; i++)
+    {
+        int root = findTask(parent, i);
+        if(number[root] < 0)
+            number[root] = numTasks++;
+        task_of[i] = number[root];
+    }
+    long long* taskWork = new long long[numTasks];
+    for(i = 0; i < numTasks; i++)
+        taskWork[i] = 0;
+    for(i = 0; i < n; i++)
+        taskWork[task_of[i]] = min(taskWork[task_of[i]] + work[i], (long long)PARALLEL_MIN_WORK);
+    for(i = 0; i < numTasks; i++)
+        heavyTasks += taskWork[i] >= PARALLEL_MIN_WORK;
+    delete[] written;
+    delete[] first;
+    delete[] parent;
+    delete[] number;
+    delete[] taskWork;
+    if(heavyTasks < 2)
+    {
+        delete[] task_of;
+        return 0;
+    }
+
+    ParallelBatch* batch = new ParallelBatch;
+    batch->stmts = new TreeNode*[n];
+    for(i = 0; i < n; i++)
+        batch->stmts[i] = stmts[i];
+    batch->num_stmts = n;
+    batch->task_of = task_of;
+    batch->num_tasks = numTasks;
+    batch->errors = new RunError[numTasks];
+    batch->failed_at = new int[numTasks];
+    return batch;
+}
+
+// the batches of the top-level statements by TreeNode::index of their first statements, returns their number
+// and adds the tasks of all of them to numTasks
+int planParallelBatches(TreeNode* tree, SymbolTable* symbolTable, ParallelBatch** batches, int* numTasks)
+{
+    int numStmts = 0, n = 0, numBatches = 0;
+    TreeNode* node;
+    for(node = tree; node; node = node->sibling)
+        numStmts++;
+    TreeNode** region = new TreeNode*[numStmts];
+    Accesses* accesses = new Accesses[numStmts];
+    bool* hasLoop = new bool[numStmts];
+    long long* work = new long long[numStmts];
+    for(node = tree; ; node = node->sibling)
+    {
+        if(node)
+        {
+            accesses[n].num_used = 0;
+            hasLoop[n] = false;
+            if(collectAccesses(node, symbolTable, &accesses[n], &hasLoop[n]))
+            {
+                region[n++] = node;
+                continue;
+            }
+        }
+
+        int i, numLoops = 0;
+        for(i = 0; i < n; i++)
+            numLoops += hasLoop[i];
+        if(numLoops >= 2)
+        {
+            renameVersions(region, n, symbolTable);
+            for(i = 0; i < n; i++)
+            {
+                accesses[i].num_used = 0;
+                collectAccesses(region[i], symbolTable, &accesses[i], &hasLoop[i]);
+                work[i] = statementWork(region[i], i ? region[i-1] : 0, symbolTable);
+            }
+        }
+        ParallelBatch* batch = numLoops >= 2 ? planRegion(region, accesses, work, n, symbolTable->num_vars) : 0;
+        if(batch)
+        {
+            batches[region[0]->index] = batch;
+            numBatches++;
+            *numTasks += batch->num_tasks;
+        }
+        n = 0;
+        if(!node)
+            break;
+    }
+    delete[] region;
+    delete[] accesses;
+    delete[] hasLoop;
+    delete[] work;
+    return numBatches;
+}
+
+// the threads that run the tasks of a batch with the thread that runs the program
+struct ThreadPool
+{
+    thread* workers;
+    int num_workers;
+    mutex lock;
+    condition_variable wake, finished;
+    long long round;   // counts the batches, a worker waits for the next one
+    int running;       // workers still on the batch
+    bool quit;
+    ParallelBatch* batch;
+    RunInfo* run_info;
+    atomic<int> next_task;
+    atomic<int> first_failed;
+
+    ThreadPool(int numWorkers);
+    ~ThreadPool()
+    {
+        int i;
+        {
+            lock_guard<mutex> guard(lock);
+            quit = true;
+        }
+        wake.notify_all();
+        for(i = 0; i < num_workers; i++)
+            workers[i].join();
+        delete[] workers;
+    }
+};
+
+// takes the tasks of the batch one at a time until there are none left
+void runBatchTasks(ThreadPool* pool)
+{
+    ParallelBatch* batch = pool->batch;
+    int task, i = 0;
+    while((task = pool->next_task++) < batch->num_tasks)
+    {
+        RunInfo runInfo = *pool->run_info;
+        if(runInfo.big_stack)
+            runInfo.big_stack = new BigStack; // the variables of a task are its own, not the stack
+        runInfo.parallel_batches = 0;
+        runInfo.first_failed = &pool->first_failed;
+        try
+        {
+            for(i = 0; i < batch->num_stmts; i++)
+            {
+                if(batch->task_of[i] != task)
+                    continue;
+                if(pool->first_failed.load(memory_order_relaxed) < i)
+                    break;
+                runInfo.stmt = i;
+                runCode(batch->stmts[i], &runInfo, true);
+            }
+        }
+        catch(RunError e)
+        {
+            batch->errors[task] = e;
+            batch->failed_at[task] = i;
+            int failed = pool->first_failed;
+            while(i < failed && !pool->first_failed.compare_exchange_weak(failed, i))
+                ;
+        }
+        catch(BatchCancelled)
+        {
+        }
+        if(runInfo.big_stack)
+            delete runInfo.big_stack;
+    }
+}
+
+void workerMain(ThreadPool* pool)
+{
+    long long round = 0;
+    for(;;)
+    {
+        {
+            unique_lock<mutex> guard(pool->lock);
+            while(!pool->quit && pool->round == round)
+                pool->wake.wait(guard);
+            if(pool->quit)
+                return;
+            round = pool->round;
+        }
+        runBatchTasks(pool);
+        {
+            lock_guard<mutex> guard(pool->lock);
+            if(--pool->running == 0)
+                pool->finished.notify_one();
+        }
+    }
+}
+
+ThreadPool::ThreadPool(int numWorkers)
+{
+    int i;
+    num_workers = numWorkers;
+    round = 0;
+    running = 0;
+    quit = false;
+    batch = 0;
+    run_info = 0;
+    workers = new thread[num_workers];
+    for(i = 0; i < num_workers; i++)
+        workers[i] = thread(workerMain, this);
+}
+
+// runs the batch that starts at a top-level statement, returns its last statement
+TreeNode* runParallelBatch(ParallelBatch* batch, RunInfo* runInfo)
+{
+    ThreadPool* pool = runInfo->pool;
+    int i;
+    for(i = 0; i < batch->num_tasks; i++)
+        batch->failed_at[i] = INT_MAX;
+    {
+        lock_guard<mutex> guard(pool->lock);
+        pool->batch = batch;
+        pool->run_info = runInfo;
+        pool->next_task = 0;
+        pool->first_failed = INT_MAX;
+        pool->running = pool->num_workers;
+        pool->round++;
+    }
+    pool->wake.notify_all();
+    runBatchTasks(pool);
+    {
+        unique_lock<mutex> guard(pool->lock);
+        while(pool->running)
+            pool->finished.wait(guard);
+    }
+
+    for(i = 0; i < batch->num_tasks; i++)
+        if(batch->failed_at[i] != INT_MAX && batch->failed_at[i] == pool->first_failed)
+            throw batch->errors[i];
+    return batch->stmts[batch->num_stmts-1];
+}
+
+// call f(a, b): the arguments are evaluated into a new frame first, then swapped with the values
+// of f.x and f.y, which are swapped back once the body has run. With --int=bigint the BigInts of
+// big values are swapped along with them
+void callProcedure(TreeNode* node, RunInfo* runInfo)
+{
+    ProcInfo* procInfo = runInfo->symbol_table->FindProc(node->id);
+    int i, numArgs = 0;
+    TreeNode* arg;
+    for(arg = node->child[0]; arg; arg = arg->sibling)
+        numArgs++;
+    if(!procInfo || !procInfo->node || numArgs != procInfo->num_params)
+    {
+        RunError e;
+        e.line_num = node->line_num;
+        sprintf(e.message, "%s is not a procedure with %d parameters", node->id, numArgs);
+        throw e;
+    }
+
+    if(runInfo->budget)
+        runInfo->budget->Call(node, procInfo);
+    FramePool* frames = runInfo->frames;
+    long long* frame = frames->Push(numArgs, node);
+    BigInt** bigFrame = frames->big_slots ? &frames->big_slots[frame - frames->slots] : 0;
+    for(arg = node->child[0], i = 0; arg; arg = arg->sibling, i++)
+    {
+        frame[i] = run(arg, runInfo);
+        if(!bigFrame)
+            continue;
+        bigFrame[i] = 0;
+        if(frame[i] == BIG_VALUE)
+        {
+            bigFrame[i] = new BigInt;
+            bigFrame[i]->Swap(runInfo->big_stack->Top());
+            runInfo->big_stack->Pop();
+        }
+    }
+
+    TreeNode* param;
+    for(param = procInfo->node->child[0], i = 0; param; param = param->sibling, i++)
+    {
+        int memloc = runInfo->symbol_table->Find(param->id)->memloc;
+        swap(runInfo->memory[memloc], frame[i]);
+        if(bigFrame)
+            swap(runInfo->big_memory[memloc], bigFrame[i]);
+    }
+
+    runCode(procInfo->node->child[1], runInfo);
+
+    for(param = procInfo->node->child[0], i = 0; param; param = param->sibling, i++)
+    {
+        int memloc = runInfo->symbol_table->Find(param->id)->memloc;
+        runInfo->memory[memloc] = frame[i];
+        if(bigFrame)
+        {
+            delete runInfo->big_memory[memloc];
+            runInfo->big_memory[memloc] = bigFrame[i];
+        }
+    }
+    frames->Pop(numArgs);
+}
+
+
+// --lazy: parses child[i] of an if when the run first reaches it. Its variables are added to the
+// symbol table and the memory, its semantic errors are printed as the symbol table prints them,
+// and a syntax error stops the run
+void parseLazyBody(TreeNode* node, int i, RunInfo* runInfo)
+{
+    LazyBodies* lazy = node->lazy;
+    CompilerInfo compInfo(runInfo->lazy->text, runInfo->lazy->size);
+    compInfo.in_file.Seek(lazy->line_start[i], lazy->line_num[i], lazy->offset[i]);
+    Diagnostics diagnostics;
+    ParseInfo parseInfo(&diagnostics);
+    parseInfo.lazy = runInfo->lazy;
+    parseInfo.proc = lazy->proc;
+    parseInfo.nesting = 1;
+    GetNextToken(&compInfo, &parseInfo.next_token);
+    TreeNode* body = stmtSeq(&compInfo, &parseInfo);
+    lazy->offset[i] = -1;
+    runInfo->lazy->parsed++;
+    if(diagnostics.count)
+    {
+        DestroyTree(body);
+        RunError e;
+        e.line_num = diagnostics.head->line_num;
+        Copy(e.message, diagnostics.head->message);
+        throw e;
+    }
+    node->child[i] = body;
+
+    SymbolTable* symbolTable = runInfo->symbol_table;
+    buildSymbolTable(body, symbolTable);
+    if(symbolTable->num_vars > runInfo->memory_size)
+    {
+        int k, size = symbolTable->num_vars;
+        long long* memory = new long long[size];
+        memcpy(memory, runInfo->memory, runInfo->memory_size*sizeof(long long));
+        for(k = runInfo->memory_size; k < size; k++)
+            memory[k] = 0;
+        delete[] runInfo->memory;
+        runInfo->memory = memory;
+        if(runInfo->big_memory)
+        {
+            BigInt** bigMemory = new BigInt*[size];
+            memcpy(bigMemory, runInfo->big_memory, runInfo->memory_size*sizeof(BigInt*));
+            for(k = runInfo->memory_size; k < size; k++)
+                bigMemory[k] = 0;
+            delete[] runInfo->big_memory;
+            runInfo->big_memory = bigMemory;
+        }
+        runInfo->memory_size = size;
+    }
+}
+
+
+//runs the if-statement / repeat-statement / assign-statement / read-statement / write-statement,
+//and the statements after it unless single
+void runCode(TreeNode* node, RunInfo* runInfo, bool single)
+{
+    for(; node; node = single ? 0 : node->sibling) //the statements of a sequence are run one after the other
+    {
+        if(runInfo->parallel_batches && runInfo->parallel_batches[node->index])
+        {
+            node = runParallelBatch(runInfo->parallel_batches[node->index], runInfo);
+            continue;
+        }
+        STATS_INC(node_evals);
+        ProfileScope profileScope(runInfo->profiler, node);
+        if(node->node_kind == IF_NODE)
+        {
+            //child[0] = the condition
+            //child[1] = the body
+            //child[2] = the else part body
+            bool condition = isTrue(run(node->child[0], runInfo), runInfo);
+            if(runInfo->pgo)
+                runInfo->pgo->Branch(node, condition);
+            if(node->lazy && node->lazy->offset[condition ? 1 : 2] >= 0)
+                parseLazyBody(node, condition ? 1 : 2, runInfo);
+
+            // if the condition of the if-statement is true
+            if(condition)
+            {
+                runCode(node->child[1], runInfo);
+            }
+            else if(node->child[2])
+            {
+                runCode(node->child[2], runInfo);
+            }
+        }
+
+        else if(node->node_kind == REPEAT_NODE)
+        {
+            if(runInfo->vector_loops && runInfo->vector_loops[node->index] &&
+               runVectorLoop(runInfo->vector_loops[node->index], runInfo))
+                continue;
+            if(runInfo->counted_loops && runInfo->counted_loops[node->index] &&
+               runCountedLoop(runInfo->counted_loops[node->index], runInfo))
+                continue;
+
+            bool condition;
+            long long trips = 0;
+            do
+            {
+               if(runInfo->budget)
+                   runInfo->budget->Trip(node);
+               if(runInfo->checkpointer && !(runInfo->frames && runInfo->frames->depth))
+                   runInfo->checkpointer->Trip(node, runInfo->memory, runInfo->reads);
+               if(runInfo->first_failed && runInfo->first_failed->load(memory_order_relaxed) < runInfo->stmt)
+                   throw BatchCancelled();
+               runCode(node->child[0], runInfo);
+               condition = isTrue(run(node->child[1], runInfo), runInfo);
+               trips++;
+            }
+            while(!condition);
+
+            if(runInfo->pgo)
+                runInfo->pgo->Loop(node, trips);
+        }
+
+        else if(node->node_kind == ASSIGN_NODE)
+        {
+            long long var = run(node->child[0], runInfo);
+            storeValue(varAddress(node, runInfo), var, runInfo);
+        }
+
+        else if(node->node_kind == READ_NODE)
+        {
+            long long* var = varAddress(node, runInfo);
+            if(indexOf(node))
+                printf("Enter the value of %s[%d]: ", node->id, (int)(var - runInfo->memory) -
+                       runInfo->symbol_table->Find(node->id)->memloc);
+            else
+                printf("Enter the value of %s: ", node->id);
+            if(runInfo->reads < runInfo->num_given && runInfo->given[runInfo->reads])
+                *var = runInfo->given_values[runInfo->reads];
+            else
+                scanf("%lld", var);
+            runInfo->reads++;
+            if(*var == BIG_VALUE && runInfo->big_stack) // the sentinel itself is read, box it
+            {
+                runInfo->big_stack->Push()->Set(BIG_VALUE);
+                storeValue(var, BIG_VALUE, runInfo);
+            }
+        }
+
+        else if(node->node_kind == WRITE_NODE)
+        {
+            long long var = run(node->child[0], runInfo);
+            if(var == BIG_VALUE && runInfo->big_stack)
+            {
+                printf("the value is: %s\n", runInfo->big_stack->Top()->ToString().c_str());
+                runInfo->big_stack->Pop();
+            }
+            else
+                printf("the value is: %lld\n", var);
+        }
+
+        else if(node->node_kind == CALL_NODE)
+        {
+            callProcedure(node, runInfo);
+        }
+    }
+}
+
+
+// a checkpoint read by --resume
+struct Checkpoint
+{
+    unsigned long long program_hash;
+    long long reads;
+    int path_len;
+    int* path;
+    int num_vars;
+    long long* memory;
+
+    Checkpoint(){path = 0; memory = 0;}
+    ~Checkpoint(){delete[] path; delete[] memory;}
+
+    bool Read(const char* filePath)
+    {
+        FILE* file = fopen(filePath, "r");
+        if(!file)
+            return false;
+
+        int version = 0, i;
+        bool ok = fscanf(file, "tiny-checkpoint %d program %llx reads %lld path %d",
+                         &version, &program_hash, &reads, &path_len) == 4 && version == 1 && path_len > 0;
+        if(ok)
+        {
+            path = new int[path_len];
+            for(i = 0; ok && i < path_len; i++)
+                ok = fscanf(file, "%d", &path[i]) == 1;
+        }
+        ok = ok && fscanf(file, " memory %d", &num_vars) == 1 && num_vars >= 0;
+        if(ok)
+        {
+            memory = new long long[num_vars+1];
+            for(i = 0; ok && i < num_vars; i++)
+                ok = fscanf(file, "%lld", &memory[i]) == 1;
+        }
+        fclose(file);
+        return ok;
+    }
+
+    // the path must lead from a top-level statement down to a repeat, one body at a time
+    bool Fits(NodeIndex* nodeIndex, int numVars, TreeNode** nodes)
+    {
+        int i;
+        if(num_vars != numVars)
+            return false;
+        for(i = 0; i < path_len; i++)
+        {
+            if(path[i] < 0 || path[i] >= nodeIndex->num_nodes)
+                return false;
+            nodes[i] = nodeIndex->nodes[path[i]];
+            if(nodeIndex->parents[path[i]] != (i ? nodes[i-1] : 0))
+                return false;
+            NodeKind kind = nodes[i]->node_kind;
+            if(kind != REPEAT_NODE && (kind != IF_NODE || i == path_len-1))
+                return false;
+        }
+        return true;
+    }
+};
+
+
+// runs the rest of the program from a checkpointed position: path[depth] and its following
+// statements, entering the branch or loop body that holds path[depth+1] without running the
+// statements before it
+void resumeCode(TreeNode** path, int depth, int pathLen, RunInfo* runInfo)
+{
+    TreeNode* node = path[depth];
+    if(depth == pathLen-1) // the loop about to start a trip, which is the same as starting the loop
+    {
+        runCode(node, runInfo);
+        return;
+    }
+
+    resumeCode(path, depth+1, pathLen, runInfo);
+    if(node->node_kind == REPEAT_NODE) // the rest of the trip was run, finish the loop
+    {
+        while(!isTrue(run(node->child[1], runInfo), runInfo))
+        {
+            if(runInfo->budget)
+                runInfo->budget->Trip(node);
+            if(runInfo->checkpointer)
+                runInfo->checkpointer->Trip(node, runInfo->memory, runInfo->reads);
+            runCode(node->child[0], runInfo);
+        }
+    }
+    runCode(node->sibling, runInfo);
+}
+
+
+// reads a checkpoint for the program in filePath, returns the nodes of its path or 0 with the error printed
+TreeNode** loadCheckpoint(const char* checkpointPath, const char* filePath, Checkpoint* checkpoint,
+                          NodeIndex* nodeIndex, int numVars)
+{
+    if(!checkpoint->Read(checkpointPath))
+    {
+        printf("Cannot read the checkpoint %s\n", checkpointPath);
+        return 0;
+    }
+    if(checkpoint->program_hash != fileHash(filePath))
+    {
+        printf("%s: error: the checkpoint %s was written by another program\n", filePath, checkpointPath);
+        return 0;
+    }
+    TreeNode** path = new TreeNode*[checkpoint->path_len];
+    if(!checkpoint->Fits(nodeIndex, numVars, path))
+    {
+        printf("%s: error: the checkpoint %s does not fit the program\n", filePath, checkpointPath);
+        delete[] path;
+        return 0;
+    }
+    printf("Resuming from %s at line %d, %lld values already read\n\n",
+           checkpointPath, path[checkpoint->path_len-1]->line_num, checkpoint->reads);
+    return path;
+}
+
+
+// runs the program with the profiler, counters, budget etc. set in runInfo, the memory is allocated here;
+// returns false if the run was stopped: runInfo->budget->exceeded or runInfo->error tell why and where.
+// With resume the run continues from a checkpoint, resumePath holds the nodes of its path.
+bool codeGeneration(TreeNode* syntaxTree, RunInfo* runInfo, Checkpoint* resume = 0, TreeNode** resumePath = 0)
+{
+    STATS_TIMER(PHASE_EXECUTE);
+    int i;
+    int numVars = runInfo->symbol_table->num_vars;
+    long long* memory = new long long[numVars];
+
+    for(i = 0; i < numVars; i++)
+    {
+       memory[i] = resume ? resume->memory[i] : 0;
+    }
+
+    runInfo->memory = memory;
+    runInfo->memory_size = numVars;
+    bool big = runInfo->int_model == INT_BIGINT;
+    BigStack bigStack;
+    runInfo->big_memory = big ? new BigInt*[numVars] : 0;
+    runInfo->big_stack = big ? &bigStack : 0;
+    for(i = 0; big && i < numVars; i++)
+        runInfo->big_memory[i] = 0;
+    FramePool frames(runInfo->symbol_table->num_procs ? FRAME_POOL_SIZE : 0, big);
+    frames.stack_base = (char*)&frames;
+    runInfo->frames = &frames;
+    if(resume)
+    {
+        // the values read before the checkpoint are read again from the same input and dropped
+        long long value;
+        for(runInfo->reads = 0; runInfo->reads < resume->reads; runInfo->reads++)
+            scanf("%lld", &value);
+    }
+    if(runInfo->budget)
+        runInfo->budget->Start();
+    try
+    {
+        if(resume)
+            resumeCode(resumePath, 0, resume->path_len, runInfo);
+        else
+            runCode(syntaxTree, runInfo);
+    }
+    catch(BudgetExceeded e)
+    {
+        runInfo->budget->exceeded = e;
+    }
+    catch(RunError e)
+    {
+        runInfo->error = e;
+    }
+    for(i = 0; big && i < runInfo->memory_size; i++)
+        delete runInfo->big_memory[i];
+    delete[] runInfo->big_memory;
+    delete[] runInfo->memory; // not memory, a lazy body may have added variables
+    runInfo->memory = 0;
+    runInfo->big_memory = 0;
+    runInfo->big_stack = 0;
+    runInfo->frames = 0;
+    return runInfo->error.line_num == 0 && (!runInfo->budget || runInfo->budget->exceeded.kind == BUDGET_NONE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Benchmark ///////////////////////////////////////////////////////////////////////
+
+double ElapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+// The generator writes deterministic TINY programs along these axes, the same spec and seed
+// always give the same program on every platform so results are comparable across commits.
+// spec: comma separated key=value list, ex: stmts=10000,depth=3,pow=2,nest=2,trips=10
+struct BenchSpec
+{
+    int stmts;    // number of top-level statements
+    int depth;    // depth of the generated expression trees
+    int pow;      // length of the ^ chain added to every assignment (0 = none)
+    int nest;     // repeat nesting of the loop statements (0 = no loops)
+    int trips;    // trip count of every repeat loop
+    int loops;    // percentage of top-level statements that are loop nests
+    int comments; // percentage of statements followed by a comment
+    int ids;      // number of distinct identifiers
+    int seed;
+    int reps;     // every phase is timed reps times and the best time is reported
+
+    BenchSpec()
+    {
+        stmts = 10000;
+        depth = 3;
+        pow = 0;
+        nest = 0;
+        trips = 10;
+        loops = 10;
+        comments = 0;
+        ids = 100;
+        seed = 1;
+        reps = 3;
+    }
+
+    bool Parse(const char* spec)
+    {
+        while(*spec)
+        {
+            const char* eq = strchr(spec, '=');
+            if(!eq)
+                return false;
+
+            int n = eq-spec, val = atoi(eq+1);
+            if(n == 5 && StartsWith(spec, "stmts")) stmts = val;
+            else if(n == 5 && StartsWith(spec, "depth")) depth = val;
+            else if(n == 3 && StartsWith(spec, "pow")) pow = val;
+            else if(n == 4 && StartsWith(spec, "nest")) nest = val;
+            else if(n == 5 && StartsWith(spec, "trips")) trips = val;
+            else if(n == 5 && StartsWith(spec, "loops")) loops = val;
+            else if(n == 8 && StartsWith(spec, "comments")) comments = val;
+            else if(n == 3 && StartsWith(spec, "ids")) ids = val;
+            else if(n == 4 && StartsWith(spec, "seed")) seed = val;
+            else if(n == 4 && StartsWith(spec, "reps")) reps = val;
+            else return false;
+
+            spec = strchr(eq, ',');
+            if(!spec)
+                break;
+            spec++;
+        }
+        if(stmts < 1) stmts = 1;
+        if(ids < 1) ids = 1;
+        if(trips < 1) trips = 1;
+        if(reps < 1) reps = 1;
+        return true;
+    }
+};
+
+// a fixed LCG instead of rand(), whose sequence differs between C libraries
+struct BenchRandom
+{
+    unsigned long long state;
+    BenchRandom(int seed){state = (unsigned long long)seed*2654435761ULL + 1;}
+
+    int Next(int n) // in [0, n)
+    {
+        state = state*6364136223846793005ULL + 1442695040888963407ULL;
+        return (int)((state >> 33) % (unsigned long long)n);
+    }
+};
+
+struct BenchGenerator
+{
+    BenchSpec* spec;
+    BenchRandom random;
+    string program;
+    int line;
+    long long operations; // node evaluations the interpreter does when the program runs
+    long long iterations; // loop trips when the program runs
+
+    BenchGenerator(BenchSpec* _spec) : random(_spec->seed) {spec = _spec; line = 1; operations = 0; iterations = 0;}
+
+    static void LetterName(string* out, const char* prefix, int k)
+    {
+        *out += prefix;
+        do
+        {
+            *out += (char)('a' + k%26);
+            k /= 26;
+        }
+        while(k);
+    }
+
+    void Variable()
+    {
+        LetterName(&program, "v", random.Next(spec->ids));
+    }
+
+    // returns the number of nodes of the generated expression
+    int Expr(int depth)
+    {
+        if(depth <= 0)
+        {
+            if(random.Next(2))
+                Variable();
+            else
+                program += to_string(random.Next(100));
+            return 1;
+        }
+
+        static const char* ops[] = {" + ", " - ", " * "};
+        program += "(";
+        int nodes = Expr(depth-1);
+        program += ops[random.Next(3)];
+        nodes += Expr(depth-1);
+        program += ")";
+        return nodes+1;
+    }
+
+    void EndStatement(bool last)
+    {
+        if(!last)
+            program += ";";
+        if(random.Next(100) < spec->comments)
+            program += " { generated comment }";
+        program += "\n";
+        line++;
+    }
+
+    void Indent(int level)
+    {
+        program.append(2*level, ' ');
+    }
+
+    // an assignment to one of the identifiers, returns the node evaluations of one run of it
+    long long Assign(int level, bool last)
+    {
+        Indent(level);
+        Variable();
+        program += " := ";
+        int nodes = Expr(spec->depth);
+        int i;
+        if(spec->pow > 0)
+        {
+            // x ^ 1 ^ ... ^ 1 keeps the value in range for any chain length
+            program += " + ";
+            Variable();
+            for(i = 1; i < spec->pow; i++)
+                program += " ^ 1";
+            nodes += 2*spec->pow;
+        }
+        EndStatement(last);
+        return 1+nodes;
+    }
+
+    // loop counters are named apart from the identifier pool so the generated body never changes them
+    long long Loop(int level, int nest, bool last)
+    {
+        string counter;
+        LetterName(&counter, "loop", level);
+
+        Indent(level);
+        program += counter + " := 0;\n";
+        line++;
+        Indent(level);
+        program += "repeat\n";
+        line++;
+
+        long long body;
+        if(nest > 1)
+            body = Loop(level+1, nest-1, false);
+        else
+            body = Assign(level+1, false);
+
+        Indent(level+1);
+        program += counter + " := " + counter + " + 1\n";
+        line++;
+        body += 4;
+
+        Indent(level);
+        program += "until " + counter + " = " + to_string(spec->trips);
+        EndStatement(last);
+
+        // counter := 0, the repeat node, then body and the 3 node condition per trip
+        return 2 + 1 + (long long)spec->trips*(body+3);
+    }
+
+    void Generate()
+    {
+        int i;
+        for(i = 0; i < spec->stmts; i++)
+        {
+            bool last = (i == spec->stmts-1);
+            if(spec->nest > 0 && random.Next(100) < spec->loops)
+            {
+                operations += Loop(0, spec->nest, last);
+                long long trips = 1;
+                int k;
+                for(k = 0; k < spec->nest; k++)
+                {
+                    trips *= spec->trips;
+                    iterations += trips;
+                }
+            }
+            else
+                operations += Assign(0, last);
+        }
+    }
+};
+
+
+int countNodes(TreeNode* node)
+{
+    int i, count = 0;
+    for(; node; node = node->sibling)
+    {
+        count++;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                count += countNodes(node->child[i]);
+    }
+    return count;
+}
+
+
+int countSymbolInserts(TreeNode* node)
+{
+    int i, count = 0;
+    for(; node; node = node->sibling)
+    {
+        if(namesVariable(node))
+            count++;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                count += countSymbolInserts(node->child[i]);
+    }
+    return count;
+}
+
+
+void printBenchPhase(const char* name, const char* unit, long long count, double seconds, bool last)
+{
+    printf("    \"%s\": {\"%s\": %lld, \"seconds\": %.6f, \"%s_per_s\": %.1f}%s\n",
+           name, unit, count, seconds, unit, seconds > 0 ? count/seconds : 0.0, last ? "" : ",");
+}
+
+
+double timeUnrolledRun(TreeNode** tree, SymbolTable* symbolTable, int factor, double* unrollSec, int* numLoops);
+
+// a new file in the temporary directory, its name goes to path; never a file that exists
+FILE* createTempFile(char* path, int size)
+{
+#ifdef _WIN32
+    char dir[MAX_PATH];
+    if(size < MAX_PATH || !GetTempPathA(MAX_PATH, dir) || !GetTempFileNameA(dir, "tny", 0, path))
+        return 0;
+    return fopen(path, "w"); // GetTempFileName created it empty
+#else
+    const char* dir = getenv("TMPDIR");
+    snprintf(path, size, "%s/tiny_bench_XXXXXX", dir && *dir ? dir : "/tmp");
+    int fd = mkstemp(path);
+    return fd < 0 ? 0 : fdopen(fd, "w");
+#endif
+}
+
+// times GetNextToken, the parser, the symbol table and the interpreter on the generated program,
+// which is written to a temporary file and removed afterwards, and the interpreter again with its
+// loops unrolled, and prints the results as JSON, returns false if the program cannot be written
+bool runBenchmark(BenchSpec* spec)
+{
+    BenchGenerator generator(spec);
+    generator.Generate();
+
+    char path[4096];
+    FILE* file = createTempFile(path, sizeof(path));
+    if(!file)
+    {
+        printf("Cannot create a temporary file for the benchmark program\n");
+        return false;
+    }
+    fwrite(generator.program.c_str(), 1, generator.program.size(), file);
+    fclose(file);
+
+    double scanSec = 1e30, parseSec = 1e30, symbolSec = 1e30, runSec = 1e30, unrollSec = 1e30, unrolledSec = 1e30;
+    long long tokens = 0, nodes = 0, inserts = 0;
+    int r, loops = 0;
+    for(r = 0; r < spec->reps; r++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        CompilerInfo compInfo(path);
+        Token token;
+        tokens = 0;
+        do
+        {
+            GetNextToken(&compInfo, &token);
+            tokens++;
+        }
+        while(token.type != ENDFILE);
+        scanSec = min(scanSec, ElapsedMs(start)/1000);
+
+        start = chrono::steady_clock::now();
+        Diagnostics diagnostics;
+        TreeNode* tree = syntaxAnalysis(path, &diagnostics);
+        parseSec = min(parseSec, ElapsedMs(start)/1000);
+
+        SymbolTable symbolTable;
+        start = chrono::steady_clock::now();
+        buildSymbolTable(tree, &symbolTable);
+        symbolSec = min(symbolSec, ElapsedMs(start)/1000);
+
+        start = chrono::steady_clock::now();
+        RunInfo runInfo(&symbolTable, 0);
+        codeGeneration(tree, &runInfo);
+        runSec = min(runSec, ElapsedMs(start)/1000);
+
+        nodes = countNodes(tree);
+        inserts = countSymbolInserts(tree);
+        double seconds;
+        unrolledSec = min(unrolledSec, timeUnrolledRun(&tree, &symbolTable, 8, &seconds, &loops));
+        unrollSec = min(unrollSec, seconds);
+        DestroyTree(tree);
+        symbolTable.Destroy();
+    }
+    remove(path);
+
+    printf("{\n");
+    printf("  \"spec\": {\"stmts\": %d, \"depth\": %d, \"pow\": %d, \"nest\": %d, \"trips\": %d, \"loops\": %d, "
+           "\"comments\": %d, \"ids\": %d, \"seed\": %d, \"reps\": %d},\n",
+           spec->stmts, spec->depth, spec->pow, spec->nest, spec->trips, spec->loops,
+           spec->comments, spec->ids, spec->seed, spec->reps);
+    printf("  \"program\": {\"bytes\": %zu, \"lines\": %d},\n", generator.program.size(), generator.line);
+    printf("  \"phases\": {\n");
+    printBenchPhase("scan", "tokens", tokens, scanSec, false);
+    printBenchPhase("parse", "nodes", nodes, parseSec, false);
+    printBenchPhase("symbol_table", "inserts", inserts, symbolSec, false);
+    printBenchPhase("execute", "operations", generator.operations, runSec, false);
+    printBenchPhase("unroll", "loops", loops, unrollSec, false);
+    printBenchPhase("loops", "iterations", generator.iterations, runSec, false);
+    printBenchPhase("loops_unrolled", "iterations", generator.iterations, unrolledSec, true);
+    printf("  }\n");
+    printf("}\n");
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Inliner /////////////////////////////////////////////////////////////////////////
+
+// Before the run, calls of small procedures and of procedures called once are replaced by a copy
+// of the body:  call f(a, b)  ->  f.x := a; f.y := b; <body of f>
+// Only procedures whose body calls nothing (once the calls in it are inlined) are inlined, so an
+// inlined body never runs while a call of the same procedure is running and the parameters need
+// no saving. Bodies are done before the statements after them, and procedures are declared before
+// they are called, so the body that is copied has its own calls inlined already.
+// A procedure that is not called anymore is removed from the program.
+
+#define INLINE_MAX_NODES 32     // procedures up to this size are inlined at every call
+#define INLINE_EXTRA_NODES 4096 // the copies may add this many nodes plus the size of the program
+
+struct Inliner
+{
+    SymbolTable* symbol_table;
+    long long budget; // nodes the copies of small procedures may still add
+    int calls, inlined_calls, removed_procs;
+};
+
+
+TreeNode* CopyTree(TreeNode* node)
+{
+    TreeNode* first = 0;
+    TreeNode** link = &first;
+    int i;
+    for(; node; node = node->sibling)
+    {
+        TreeNode* copy = new TreeNode;
+        *copy = *node;
+        if(hasIdName(node))
+            AllocateAndCopy(&copy->id, node->id);
+        for(i = 0; i < MAX_CHILDREN; i++)
+            copy->child[i] = CopyTree(node->child[i]);
+
+        *link = copy;
+        link = &copy->sibling;
+    }
+    *link = 0;
+    return first;
+}
+
+
+bool hasCalls(TreeNode* node)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        if(node->node_kind == CALL_NODE)
+            return true;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i] && hasCalls(node->child[i]))
+                return true;
+    }
+    return false;
+}
+
+
+bool shouldInline(TreeNode* call, ProcInfo* procInfo, Inliner* inliner)
+{
+    // not done yet (a call from its own body) or calling other procedures
+    if(!procInfo->node || procInfo->num_nodes < 0 || !procInfo->leaf)
+        return false;
+
+    int numArgs = 0;
+    TreeNode* arg;
+    for(arg = call->child[0]; arg; arg = arg->sibling)
+        numArgs++;
+    if(numArgs != procInfo->num_params)
+        return false;
+
+    if(procInfo->num_calls == 1)
+        return true;
+    if(procInfo->num_nodes > INLINE_MAX_NODES || procInfo->num_nodes + numArgs > inliner->budget)
+        return false;
+    inliner->budget -= procInfo->num_nodes + numArgs;
+    return true;
+}
+
+
+// the statements a call is replaced by, its arguments are moved into the assignments
+TreeNode* expandCall(TreeNode* call, ProcInfo* procInfo)
+{
+    TreeNode* first = 0;
+    TreeNode** link = &first;
+    TreeNode* param;
+    TreeNode* arg = call->child[0];
+    for(param = procInfo->node->child[0]; param; param = param->sibling)
+    {
+        TreeNode* next = arg->sibling;
+        TreeNode* assign = new TreeNode;
+        assign->node_kind = ASSIGN_NODE;
+        assign->line_num = call->line_num;
+        AllocateAndCopy(&assign->id, param->id);
+        assign->child[0] = arg;
+        arg->sibling = 0;
+
+        *link = assign;
+        link = &assign->sibling;
+        arg = next;
+    }
+    call->child[0] = 0;
+    *link = CopyTree(procInfo->node->child[1]);
+    return first;
+}
+
+
+// inlines the calls of the statement sequence that starts at *link and of the blocks in it
+void inlineCalls(TreeNode** link, Inliner* inliner)
+{
+    while(*link)
+    {
+        TreeNode* node = *link;
+        if(node->node_kind == CALL_NODE)
+        {
+            inliner->calls++;
+            ProcInfo* procInfo = inliner->symbol_table->FindProc(node->id);
+            if(procInfo && shouldInline(node, procInfo, inliner))
+            {
+                TreeNode* expansion = expandCall(node, procInfo);
+                TreeNode* last = expansion;
+                while(last->sibling)
+                    last = last->sibling;
+                last->sibling = node->sibling;
+                *link = expansion;
+                link = &last->sibling;
+
+                node->sibling = 0;
+                DestroyTree(node);
+                inliner->inlined_calls++;
+                continue;
+            }
+            if(procInfo)
+                procInfo->calls_left++;
+        }
+        else if(node->node_kind == IF_NODE)
+        {
+            inlineCalls(&node->child[1], inliner);
+            inlineCalls(&node->child[2], inliner);
+        }
+        else if(node->node_kind == REPEAT_NODE)
+            inlineCalls(&node->child[0], inliner);
+        else if(node->node_kind == PROC_NODE)
+        {
+            inlineCalls(&node->child[1], inliner);
+            ProcInfo* procInfo = inliner->symbol_table->FindProc(node->id);
+            if(procInfo->node == node)
+            {
+                procInfo->num_nodes = countNodes(node->child[1]);
+                procInfo->leaf = !hasCalls(node->child[1]);
+            }
+        }
+        link = &node->sibling;
+    }
+}
+
+
+// returns the program with the calls inlined and the procedures that are not called anymore removed
+TreeNode* inlineProcedures(TreeNode* tree, SymbolTable* symbolTable, Inliner* inliner)
+{
+    inliner->symbol_table = symbolTable;
+    inliner->budget = countNodes(tree) + INLINE_EXTRA_NODES;
+    inliner->calls = inliner->inlined_calls = inliner->removed_procs = 0;
+    inlineCalls(&tree, inliner);
+
+    TreeNode** link = &tree;
+    while(*link)
+    {
+        TreeNode* node = *link;
+        ProcInfo* procInfo = node->node_kind == PROC_NODE ? symbolTable->FindProc(node->id) : 0;
+        if(procInfo && procInfo->node == node && procInfo->calls_left == 0)
+        {
+            *link = node->sibling;
+            node->sibling = 0;
+            DestroyTree(node);
+            procInfo->node = 0;
+            inliner->removed_procs++;
+        }
+        else
+            link = &node->sibling;
+    }
+    return tree;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+// Loop Unrolling //////////////////////////////////////////////////////////////////
+
+// A counted loop steps a counter by a constant as its last statement and stops when the counter
+// reaches a bound that the loop does not change:
+//   repeat <body> i := i + c until i = n      (or i - c, until n < i, until i < n)
+// where n is a number or a scalar, and nothing else in the loop assigns i or n or calls a
+// procedure. The trips are then known when the loop starts: the counter moves by c every trip
+// and the exit test holds first after (n - i)/c trips. A counted loop runs that many trips of
+// its body without the condition, adding c to the counter itself, in groups of --unroll trips
+// followed by the remaining ones. If the bound cannot be reached before the counter leaves 64
+// bits the loop is run as before, trip by trip.
+// When the counter is set to a number just before the loop and the bound is a number, the trips
+// are known before the run, and a loop of at most --unroll trips whose copies have at most
+// UNROLL_MAX_NODES nodes is replaced by that many copies of its body. With --int=wrap64 a loop whose body only adds
+// expressions of numbers and unchanged scalars, or the counter, to variables is run in closed
+// form: each sum is added all at once, the values of the counter adding up to an arithmetic series.
+
+#define MAX_UNROLL 64        // --unroll=n
+#define UNROLL_MAX_NODES 64  // of the copies of a fully unrolled loop
+
+enum LoopExit {EXIT_EQUAL, EXIT_ABOVE, EXIT_BELOW}; // until i = n, until n < i, until i < n
+
+struct CountedLoop
+{
+    int counter;      // memory location of i
+    long long step;
+    LoopExit exit;
+    TreeNode* bound;  // a number or a scalar
+    TreeNode** body;  // the statements before the step, run one at a time
+    int num_body;
+    int factor;       // trips run between two checks for a cancelled batch
+    // closed form, body[k] is target := target + term or target - term
+    int num_sums;
+    int* sum_targets; // memory locations
+    TreeNode** sum_terms;
+    bool* sum_negative;
+    bool* sum_counter; // the term is the counter
+};
+
+struct LoopUnroller
+{
+    SymbolTable* symbol_table;
+    int factor;
+    int loops, counted, constant, unrolled;
+};
+
+
+void DestroyCountedLoop(CountedLoop* loop)
+{
+    delete[] loop->body;
+    delete[] loop->sum_targets;
+    delete[] loop->sum_terms;
+    delete[] loop->sum_negative;
+    delete[] loop->sum_counter;
+    delete loop;
+}
+
+// true if a statement sequence assigns or reads a value into the variable at memloc
+bool assignsVariable(TreeNode* node, SymbolTable* symbolTable, int memloc)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        if((node->node_kind == ASSIGN_NODE || node->node_kind == READ_NODE) &&
+           symbolTable->Find(node->id)->memloc == memloc)
+            return true;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(assignsVariable(node->child[i], symbolTable, memloc))
+                return true;
+    }
+    return false;
+}
+
+// the memory location of a scalar, -1 for any other node
+int scalarOf(TreeNode* node, SymbolTable* symbolTable)
+{
+    if(node->node_kind != ID_NODE || node->child[0])
+        return -1;
+    VariableInfo* varInfo = symbolTable->Find(node->id);
+    return varInfo->is_array ? -1 : varInfo->memloc;
+}
+
+// true for + - * of numbers and of scalars other than the counter that the loop does not assign
+bool isSumTerm(TreeNode* node, TreeNode* body, SymbolTable* symbolTable, int counter)
+{
+    if(node->node_kind == NUM_NODE)
+        return true;
+    if(node->node_kind == ID_NODE)
+    {
+        int memloc = scalarOf(node, symbolTable);
+        return memloc >= 0 && memloc != counter && !assignsVariable(body, symbolTable, memloc);
+    }
+    if(node->node_kind != OPER_NODE || (node->oper != PLUS && node->oper != MINUS && node->oper != TIMES))
+        return false;
+    return isSumTerm(node->child[0], body, symbolTable, counter) && isSumTerm(node->child[1], body, symbolTable, counter);
+}
+
+// v := v + <term>, <term> + v or v - <term>, the term being the counter or a sum term
+bool matchSum(TreeNode* stmt, TreeNode* body, SymbolTable* symbolTable, CountedLoop* loop)
+{
+    if(stmt->node_kind != ASSIGN_NODE || stmt->child[1])
+        return false;
+    int target = symbolTable->Find(stmt->id)->memloc;
+    TreeNode* sum = stmt->child[0];
+    if(sum->node_kind != OPER_NODE || (sum->oper != PLUS && sum->oper != MINUS))
+        return false;
+    int side = scalarOf(sum->child[0], symbolTable) == target ? 0 : 1;
+    if(scalarOf(sum->child[side], symbolTable) != target || (sum->oper == MINUS && side == 1))
+        return false;
+    TreeNode* term = sum->child[1-side];
+    bool isCounter = scalarOf(term, symbolTable) == loop->counter;
+    if(!isCounter && !isSumTerm(term, body, symbolTable, loop->counter))
+        return false;
+
+    int k = loop->num_sums++;
+    loop->sum_targets[k] = target;
+    loop->sum_terms[k] = term;
+    loop->sum_negative[k] = sum->oper == MINUS;
+    loop->sum_counter[k] = isCounter;
+    return true;
+}
+
+// the plan of a counted repeat loop, 0 for any other loop. closedForm also looks for sums
+CountedLoop* matchCountedLoop(TreeNode* node, SymbolTable* symbolTable, int factor, bool closedForm)
+{
+    //the last statement of the body is i := i + c, c + i or i - c
+    TreeNode* body = node->child[0];
+    TreeNode* last = body;
+    int numBody = 0;
+    for(; last->sibling; last = last->sibling)
+        numBody++;
+    if(last->node_kind != ASSIGN_NODE || last->child[1] || symbolTable->Find(last->id)->is_array)
+        return 0;
+    int counter = symbolTable->Find(last->id)->memloc;
+    TreeNode* step = last->child[0];
+    if(step->node_kind != OPER_NODE || (step->oper != PLUS && step->oper != MINUS))
+        return 0;
+    int side = scalarOf(step->child[0], symbolTable) == counter ? 0 : 1;
+    TreeNode* stepNum = step->child[1-side];
+    if(scalarOf(step->child[side], symbolTable) != counter || stepNum->node_kind != NUM_NODE || stepNum->num == 0 ||
+       (step->oper == MINUS && side == 1))
+        return 0;
+
+    //until i = n | n = i | n < i | i < n
+    TreeNode* condition = node->child[1];
+    if(condition->node_kind != OPER_NODE || (condition->oper != EQUAL && condition->oper != LESS_THAN))
+        return 0;
+    side = scalarOf(condition->child[0], symbolTable) == counter ? 0 : 1;
+    TreeNode* bound = condition->child[1-side];
+    int boundVar = scalarOf(bound, symbolTable);
+    if(scalarOf(condition->child[side], symbolTable) != counter || (bound->node_kind != NUM_NODE && boundVar < 0) ||
+       boundVar == counter)
+        return 0;
+
+    //nothing else assigns i or n, or calls a procedure that may assign them
+    TreeNode* cur;
+    int i;
+    for(cur = body; cur != last; cur = cur->sibling)
+    {
+        if((cur->node_kind == ASSIGN_NODE || cur->node_kind == READ_NODE) &&
+           symbolTable->Find(cur->id)->memloc == counter)
+            return 0;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(assignsVariable(cur->child[i], symbolTable, counter))
+                return 0;
+    }
+    if(hasCalls(body) || (boundVar >= 0 && assignsVariable(body, symbolTable, boundVar)))
+        return 0;
+
+    CountedLoop* loop = new CountedLoop;
+    loop->counter = counter;
+    loop->step = step->oper == PLUS ? stepNum->num : -stepNum->num;
+    loop->exit = condition->oper == EQUAL ? EXIT_EQUAL : side == 1 ? EXIT_ABOVE : EXIT_BELOW;
+    loop->bound = bound;
+    loop->num_body = numBody;
+    loop->body = new TreeNode*[max(numBody, 1)];
+    loop->factor = factor;
+    for(cur = body, numBody = 0; cur != last; cur = cur->sibling)
+        loop->body[numBody++] = cur;
+
+    loop->num_sums = 0;
+    loop->sum_targets = 0;
+    loop->sum_terms = 0;
+    loop->sum_negative = 0;
+    loop->sum_counter = 0;
+    if(closedForm && numBody)
+    {
+        loop->sum_targets = new int[numBody];
+        loop->sum_terms = new TreeNode*[numBody];
+        loop->sum_negative = new bool[numBody];
+        loop->sum_counter = new bool[numBody];
+        for(cur = body; cur != last && matchSum(cur, body, symbolTable, loop); cur = cur->sibling);
+        if(cur != last)
+            loop->num_sums = 0;
+    }
+    return loop;
+}
+
+// the trips of a counted loop from the counter and the bound at its start, 0 if the counter
+// would leave 64 bits before the loop stops
+long long countedTrips(CountedLoop* loop, long long first, long long bound)
+{
+    long long next, distance, trips, last;
+    if(AddOverflows(first, loop->step, &next))
+        return 0;
+    if(loop->exit == EXIT_EQUAL)
+    {
+        if(SubOverflows(bound, first, &distance) || distance % loop->step != 0 || distance / loop->step < 1)
+            return 0;
+        return distance / loop->step;
+    }
+    if(loop->exit == EXIT_ABOVE ? next > bound : next < bound)
+        return 1;
+    if(loop->exit == EXIT_ABOVE ? loop->step < 0 : loop->step > 0) // moving away from the bound
+        return 0;
+    if(loop->exit == EXIT_ABOVE ? SubOverflows(bound, first, &distance) : SubOverflows(first, bound, &distance))
+        return 0;
+    trips = distance / (loop->step > 0 ? loop->step : -loop->step) + 1;
+    if(MulOverflows(trips, loop->step, &last) || AddOverflows(first, last, &last))
+        return 0;
+    return trips;
+}
+
+// the trips of a counted loop known before the run, when the statement prev just before it sets the
+// counter to a number and the bound is a number, 0 otherwise
+long long constantTrips(CountedLoop* loop, TreeNode* prev, SymbolTable* symbolTable)
+{
+    if(prev && prev->node_kind == ASSIGN_NODE && !prev->child[1] && prev->child[0]->node_kind == NUM_NODE &&
+       symbolTable->Find(prev->id)->memloc == loop->counter && loop->bound->node_kind == NUM_NODE)
+        return countedTrips(loop, prev->child[0]->num, loop->bound->num);
+    return 0;
+}
+
+// runs the loop if its trips are known, returns false to run it trip by trip
+bool runCountedLoop(CountedLoop* loop, RunInfo* runInfo)
+{
+    long long* counter = &runInfo->memory[loop->counter];
+    long long first = *counter;
+    long long trips = countedTrips(loop, first, run(loop->bound, runInfo));
+    if(!trips)
+        return false;
+
+    int k;
+    if(loop->num_sums)
+    {
+        // wrap64: sum of first + t*step for t < trips is trips*first + step*trips*(trips-1)/2
+        unsigned long long n = (unsigned long long)trips;
+        unsigned long long series = (n % 2 == 0) ? (n/2)*(n-1) : n*((n-1)/2);
+        series = series*(unsigned long long)loop->step + n*(unsigned long long)first;
+        for(k = 0; k < loop->num_sums; k++)
+        {
+            unsigned long long sum = loop->sum_counter[k] ? series : n*(unsigned long long)run(loop->sum_terms[k], runInfo);
+            unsigned long long* target = (unsigned long long*)&runInfo->memory[loop->sum_targets[k]];
+            *target = loop->sum_negative[k] ? *target - sum : *target + sum;
+        }
+        *counter = (long long)((unsigned long long)first + n*(unsigned long long)loop->step);
+        return true;
+    }
+
+    long long groups = trips / loop->factor;
+    int rest = (int)(trips % loop->factor);
+    int j;
+    for(; groups >= 0; groups--)
+    {
+        if(runInfo->first_failed && runInfo->first_failed->load(memory_order_relaxed) < runInfo->stmt)
+            throw BatchCancelled();
+        int groupTrips = groups ? loop->factor : rest;
+        for(k = 0; k < groupTrips; k++)
+        {
+            for(j = 0; j < loop->num_body; j++)
+                runCode(loop->body[j], runInfo, true);
+            *counter += loop->step;
+        }
+    }
+    return true;
+}
+
+// the plans of all the counted loops of the tree by TreeNode::index, the tree must be numbered.
+// With a profile, loops that only ever ran one trip are left to their condition and the others run
+// groups of as many trips as they ran at most, up to factor
+int planCountedLoops(TreeNode* node, SymbolTable* symbolTable, CountedLoop** loops, int factor, bool closedForm,
+                     int* numClosed, PgoProfile* profile)
+{
+    int i, count = 0;
+    for(; node; node = node->sibling)
+    {
+        BranchCounters* counters = profile ? profile->node_counters[node->index] : 0;
+        if(node->node_kind == REPEAT_NODE && counters && counters->taken && counters->max_trips <= 1)
+            loops[node->index] = 0;
+        else if(node->node_kind == REPEAT_NODE)
+        {
+            int loopFactor = counters && counters->taken ? (int)min((long long)factor, counters->max_trips) : factor;
+            loops[node->index] = matchCountedLoop(node, symbolTable, loopFactor, closedForm);
+            if(loops[node->index])
+            {
+                count++;
+                *numClosed += loops[node->index]->num_sums > 0;
+            }
+        }
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                count += planCountedLoops(node->child[i], symbolTable, loops, factor, closedForm, numClosed, profile);
+    }
+    return count;
+}
+
+// replaces the loops of the statement sequence that starts at *link, and of the blocks in it, whose
+// trips are known before the run by copies of their bodies
+void unrollLoops(TreeNode** link, LoopUnroller* unroller)
+{
+    TreeNode* prev = 0; // the statement before *link
+    while(*link)
+    {
+        TreeNode* node = *link;
+        if(node->node_kind == IF_NODE)
+        {
+            unrollLoops(&node->child[1], unroller);
+            unrollLoops(&node->child[2], unroller);
+        }
+        else if(node->node_kind == PROC_NODE)
+            unrollLoops(&node->child[1], unroller);
+        if(node->node_kind != REPEAT_NODE)
+        {
+            prev = node;
+            link = &node->sibling;
+            continue;
+        }
+
+        unrollLoops(&node->child[0], unroller);
+        unroller->loops++;
+        CountedLoop* loop = matchCountedLoop(node, unroller->symbol_table, unroller->factor, false);
+        long long trips = 0;
+        if(loop)
+        {
+            unroller->counted++;
+            trips = constantTrips(loop, prev, unroller->symbol_table);
+            unroller->constant += trips > 0;
+            DestroyCountedLoop(loop);
+        }
+        if(!trips || trips > unroller->factor || trips*countNodes(node->child[0]) > UNROLL_MAX_NODES)
+        {
+            prev = node;
+            link = &node->sibling;
+            continue;
+        }
+
+        TreeNode* after = node->sibling;
+        int i;
+        for(i = 0; i < trips; i++)
+        {
+            *link = CopyTree(node->child[0]);
+            while(*link)
+            {
+                prev = *link;
+                link = &prev->sibling;
+            }
+        }
+        *link = after;
+        node->sibling = 0;
+        DestroyTree(node);
+        unroller->unrolled++;
+    }
+}
+
+
+// replaces the loops of the program that run at most factor trips by copies of their bodies
+TreeNode* unrollConstantLoops(TreeNode* tree, SymbolTable* symbolTable, LoopUnroller* unroller, int factor)
+{
+    unroller->symbol_table = symbolTable;
+    unroller->factor = factor;
+    unroller->loops = unroller->counted = unroller->constant = unroller->unrolled = 0;
+    unrollLoops(&tree, unroller);
+    return tree;
+}
+
+
+// --bench: the seconds of a run of the program with its loops unrolled, the seconds of the
+// unrolling and the planning go to *unrollSec and the loops to *numLoops
+double timeUnrolledRun(TreeNode** tree, SymbolTable* symbolTable, int factor, double* unrollSec, int* numLoops)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    LoopUnroller unroller;
+    *tree = unrollConstantLoops(*tree, symbolTable, &unroller, factor);
+    int i, numNodes = numberNodes(*tree), numClosed = 0;
+    CountedLoop** countedLoops = new CountedLoop*[numNodes];
+    for(i = 0; i < numNodes; i++)
+        countedLoops[i] = 0;
+    planCountedLoops(*tree, symbolTable, countedLoops, factor, true, &numClosed, 0);
+    *unrollSec = ElapsedMs(start)/1000;
+    *numLoops = unroller.loops;
+
+    start = chrono::steady_clock::now();
+    RunInfo runInfo(symbolTable, 0);
+    runInfo.counted_loops = countedLoops;
+    codeGeneration(*tree, &runInfo);
+    double seconds = ElapsedMs(start)/1000;
+
+    for(i = 0; i < numNodes; i++)
+        if(countedLoops[i])
+            DestroyCountedLoop(countedLoops[i]);
+    delete[] countedLoops;
+    return seconds;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+// Partial Evaluation //////////////////////////////////////////////////////////////
+
+// --specialize=v1,v2,... gives the values of the first reads of the program, ? for a value left to
+// the run. Before the run the program is evaluated as far as these values and its numbers decide it,
+// and replaced by the residual program, which does the rest and reads only the values left to it.
+// The statements are walked in program order with the state of every memory location: its value
+// if it is known, and whether the memory holds it. An expression of known values is folded as the
+// run computes it with the integer model; what would stop the run or, with bigint, may not fit in
+// 64 bits is left to the run. An assignment or a read of a known value only changes the state, an
+// if with a known condition is replaced by its branch, and a loop whose condition is known after
+// every trip is replaced by the residual statements of its trips, if they have at most
+// SPECIALIZE_MAX_NODES nodes and the trips evaluated so far stay within SPECIALIZE_MAX_TRIPS.
+// A known value is stored by an assignment only when something reads it from the memory: a loop
+// or a branch left to the run that changes it, a call of procedures that use it, or an array
+// element with an index left to the run. A loop left to the run is evaluated once, with what it
+// changes unknown. An if left to the run has both branches evaluated and keeps the values they
+// agree on. The values read are counted up to a read in a loop left to the run, in a procedure or
+// in an if whose branches read different numbers of values; the later reads are left to the run.
+// Procedure bodies are kept as they are. Array statements are moved to the start, an array is 0
+// until it is used either way.
+
+#define SPECIALIZE_MAX_NODES 1024     // of the residual statements of an unrolled loop
+#define SPECIALIZE_MAX_TRIPS 1000000  // loop trips evaluated by the specializer in all
+
+// the state of a memory location, kept in the undo log before it changes
+struct SpecChange
+{
+    int memloc;
+    bool known, stored; // stored: the memory holds the value, always true for an unknown one
+    long long value;
+};
+
+struct Specializer
+{
+    SymbolTable* symbol_table;
+    IntModel int_model;
+    long long* bindings; // the --specialize values, bound[i] is false for a ?
+    bool* bound;
+    int num_bindings;
+    int reads;           // values read so far, -1 once that is left to the run
+    int reads_known;     // the reads before this one are the same in every run, the later ones are left to it
+
+    int num_locations;
+    long long* values;
+    bool* known;
+    bool* stored;
+    int* stamps;         // to visit each location of the undo log once
+    int stamp;
+    SpecChange* changes; // undo log
+    int num_changes, changes_capacity;
+    int* proc_changes;   // locations that procedure bodies assign or read into
+    int num_proc_changes;
+    int* proc_uses;      // locations that procedure bodies use in any way
+    int num_proc_uses;
+    bool procs_read;
+
+    VariableInfo** vars; // by memory location, to name a location
+    int num_var_infos;
+    VariableInfo* noop_var; // a global scalar, v := v stands for an empty body
+    TreeNode** tail;        // where the next residual statement goes
+    long long trips_left;
+    bool failed;            // a variable is used as the symbol table does not declare it
+    int reads_bound, ifs_resolved, loops_unrolled;
+
+    Specializer(SymbolTable* symbolTable, IntModel model, long long* _bindings, bool* _bound, int numBindings)
+    {
+        int i;
+        symbol_table = symbolTable;
+        int_model = model;
+        bindings = _bindings;
+        bound = _bound;
+        num_bindings = numBindings;
+        reads = 0;
+        reads_known = INT_MAX;
+        num_locations = symbolTable->num_vars;
+        values = new long long[num_locations+1];
+        known = new bool[num_locations+1];
+        stored = new bool[num_locations+1];
+        stamps = new int[num_locations+1];
+        for(i = 0; i < num_locations; i++)
+        {
+            values[i] = 0; // the memory starts at 0
+            known[i] = stored[i] = true;
+            stamps[i] = 0;
+        }
+        stamp = 0;
+        changes = 0;
+        num_changes = changes_capacity = 0;
+        proc_changes = proc_uses = 0;
+        num_proc_changes = num_proc_uses = 0;
+        procs_read = false;
+
+        vars = new VariableInfo*[num_locations+1];
+        num_var_infos = 0;
+        noop_var = 0;
+        for(i = 0; i < SYMBOL_HASH_SIZE; i++)
+        {
+            VariableInfo* curv;
+            for(curv = symbolTable->var_info[i]; curv; curv = curv->next_var)
+                vars[num_var_infos++] = curv;
+        }
+        sort(vars, vars+num_var_infos, LowerMemloc());
+        for(i = 0; i < num_var_infos && !noop_var; i++)
+            if(!vars[i]->is_array && !strchr(vars[i]->name, '.'))
+                noop_var = vars[i];
+        tail = 0;
+        trips_left = SPECIALIZE_MAX_TRIPS;
+        failed = false;
+        reads_bound = ifs_resolved = loops_unrolled = 0;
+    }
+
+    ~Specializer()
+    {
+        delete[] values;
+        delete[] known;
+        delete[] stored;
+        delete[] stamps;
+        delete[] changes;
+        delete[] proc_changes;
+        delete[] proc_uses;
+        delete[] vars;
+    }
+
+    void Set(int memloc, bool isKnown, long long value, bool isStored)
+    {
+        if(known[memloc] == isKnown && stored[memloc] == isStored && (!isKnown || values[memloc] == value))
+            return;
+        if(num_changes == changes_capacity)
+        {
+            changes_capacity = 2*changes_capacity + 64;
+            SpecChange* grown = new SpecChange[changes_capacity];
+            if(num_changes)
+                memcpy(grown, changes, num_changes*sizeof(SpecChange));
+            delete[] changes;
+            changes = grown;
+        }
+        SpecChange* change = &changes[num_changes++];
+        change->memloc = memloc;
+        change->known = known[memloc];
+        change->stored = stored[memloc];
+        change->value = values[memloc];
+
+        known[memloc] = isKnown;
+        values[memloc] = value;
+        stored[memloc] = isStored;
+    }
+
+    void Undo(int mark)
+    {
+        while(num_changes > mark)
+        {
+            SpecChange* change = &changes[--num_changes];
+            known[change->memloc] = change->known;
+            values[change->memloc] = change->value;
+            stored[change->memloc] = change->stored;
+        }
+    }
+
+    // the variable that memloc is in
+    VariableInfo* Owner(int memloc)
+    {
+        int low = 0, high = num_var_infos-1;
+        while(low < high)
+        {
+            int mid = (low + high + 1)/2;
+            if(vars[mid]->memloc <= memloc)
+                low = mid;
+            else
+                high = mid-1;
+        }
+        return vars[low];
+    }
+};
+
+
+// a op b as the run computes it with the model, false if the run stops there or, with bigint,
+// the result may not fit in 64 bits
+bool foldOperation(TokenType oper, long long a, long long b, IntModel model, long long* result)
+{
+    bool wrap = model == INT_WRAP64;
+    if(oper == EQUAL)
+        *result = a == b;
+    else if(oper == LESS_THAN)
+        *result = a < b;
+    else if(oper == PLUS)
+    {
+        if(wrap)
+            *result = (long long)((unsigned long long)a + (unsigned long long)b);
+        else if(AddOverflows(a, b, result))
+            return false;
+    }
+    else if(oper == MINUS)
+    {
+        if(wrap)
+            *result = (long long)((unsigned long long)a - (unsigned long long)b);
+        else if(SubOverflows(a, b, result))
+            return false;
+    }
+    else if(oper == TIMES)
+    {
+        if(wrap)
+            *result = (long long)((unsigned long long)a * (unsigned long long)b);
+        else if(MulOverflows(a, b, result))
+            return false;
+    }
+    else if(oper == DIVIDE)
+    {
+        if(b == 0 || (a == LLONG_MIN && b == -1 && !wrap))
+            return false;
+        *result = (a == LLONG_MIN && b == -1) ? LLONG_MIN : a / b;
+    }
+    else if(oper == POWER)
+    {
+        if(b < 0)
+        {
+            if(a == 0)
+                return false;
+            *result = (a == 1 || a == -1) ? (a == -1 && b % 2 ? -1 : 1) : 0;
+        }
+        else if(wrap)
+            *result = wrapPower(a, b);
+        else if(!powerFits(a, b, result))
+            return false;
+    }
+    else
+        return false;
+    return true;
+}
+
+// true if evaluating the expression may stop the run
+bool mayFail(TreeNode* node, IntModel model)
+{
+    if(node->node_kind == NUM_NODE)
+        return false;
+    if(node->node_kind == ID_NODE)
+        return node->child[0] != 0;
+    if(node->oper == DIVIDE || node->oper == POWER ||
+       (model != INT_WRAP64 && node->oper != EQUAL && node->oper != LESS_THAN))
+        return true;
+    return mayFail(node->child[0], model) || mayFail(node->child[1], model);
+}
+
+
+TreeNode* numberNode(long long value, int lineNum)
+{
+    TreeNode* node = new TreeNode;
+    node->node_kind = NUM_NODE;
+    node->expr_data_type = INTEGER;
+    node->num = value;
+    node->line_num = lineNum;
+    return node;
+}
+
+TreeNode* operNode(TokenType oper, TreeNode* left, TreeNode* right, ExprDataType type, int lineNum)
+{
+    TreeNode* node = new TreeNode;
+    node->node_kind = OPER_NODE;
+    node->expr_data_type = type;
+    node->oper = oper;
+    node->child[0] = left;
+    node->child[1] = right;
+    node->line_num = lineNum;
+    return node;
+}
+
+// a number, the least value is -9223372036854775807 - 1 since with bigint it stands for a big value
+TreeNode* constantNode(long long value, int lineNum)
+{
+    if(value != LLONG_MIN)
+        return numberNode(value, lineNum);
+    return operNode(MINUS, numberNode(-LLONG_MAX, lineNum), numberNode(1, lineNum), INTEGER, lineNum);
+}
+
+// 0 = 0 or 0 = 1, the condition of a residual loop that is known
+TreeNode* truthNode(bool truth, int lineNum)
+{
+    return operNode(EQUAL, numberNode(0, lineNum), numberNode(truth ? 0 : 1, lineNum), BOOLEAN, lineNum);
+}
+
+// a statement with its id but without children or siblings
+TreeNode* statementNode(TreeNode* node)
+{
+    TreeNode* copy = new TreeNode;
+    *copy = *node;
+    if(hasIdName(node))
+        AllocateAndCopy(&copy->id, node->id);
+    copy->child[0] = copy->child[1] = copy->child[2] = copy->sibling = 0;
+    return copy;
+}
+
+TreeNode* assignNode(const char* name, TreeNode* index, TreeNode* expr, int lineNum)
+{
+    TreeNode* node = new TreeNode;
+    node->node_kind = ASSIGN_NODE;
+    node->line_num = lineNum;
+    AllocateAndCopy(&node->id, name);
+    node->child[0] = expr;
+    node->child[1] = index;
+    return node;
+}
+
+// v := v, for a body that has nothing left
+TreeNode* noopNode(Specializer* s, int lineNum)
+{
+    if(!s->noop_var)
+    {
+        s->failed = true;
+        return 0;
+    }
+    TreeNode* id = new TreeNode;
+    id->node_kind = ID_NODE;
+    id->expr_data_type = INTEGER;
+    id->line_num = lineNum;
+    AllocateAndCopy(&id->id, s->noop_var->name);
+    return assignNode(s->noop_var->name, 0, id, lineNum);
+}
+
+void emit(Specializer* s, TreeNode* node)
+{
+    *s->tail = node;
+    s->tail = &node->sibling;
+}
+
+// name := value or name[i] := value, which stores a known value of memloc
+TreeNode* storeNode(Specializer* s, int memloc, long long value, int lineNum)
+{
+    VariableInfo* varInfo = s->Owner(memloc);
+    TreeNode* index = varInfo->is_array ? numberNode(memloc - varInfo->memloc, lineNum) : 0;
+    return assignNode(varInfo->name, index, constantNode(value, lineNum), lineNum);
+}
+
+void storeRange(Specializer* s, int first, int count, int lineNum)
+{
+    int memloc;
+    for(memloc = first; memloc < first + count; memloc++)
+        if(s->known[memloc] && !s->stored[memloc])
+        {
+            emit(s, storeNode(s, memloc, s->values[memloc], lineNum));
+            s->Set(memloc, true, s->values[memloc], true);
+        }
+}
+
+// before a call: the procedures see the memory
+void storeForCall(Specializer* s, int lineNum)
+{
+    int i;
+    for(i = 0; i < s->num_proc_uses; i++)
+        storeRange(s, s->proc_uses[i], 1, lineNum);
+}
+
+void forgetRange(Specializer* s, int first, int count)
+{
+    int memloc;
+    for(memloc = first; memloc < first + count; memloc++)
+        s->Set(memloc, false, 0, true);
+}
+
+// the number of values read is left to the run from here on
+void loseReads(Specializer* s)
+{
+    if(s->reads >= 0)
+        s->reads_known = min(s->reads_known, s->reads);
+    s->reads = -1;
+}
+
+// after a call: everything the procedures change is unknown, and so is the number of values read
+// if they read
+void forgetCall(Specializer* s)
+{
+    int i;
+    for(i = 0; i < s->num_proc_changes; i++)
+        s->Set(s->proc_changes[i], false, 0, true);
+    if(s->procs_read)
+        loseReads(s);
+}
+
+
+TreeNode* specExpr(Specializer* s, TreeNode* node, long long* value);
+
+// the memory location that an ID, ASSIGN or READ node names, its residual index goes to *index.
+// -1 if the index is left to the run, the whole array is stored then
+int specLocation(Specializer* s, TreeNode* node, TreeNode* indexNode, TreeNode** index, VariableInfo** varInfo)
+{
+    *index = 0;
+    *varInfo = s->symbol_table->Find(node->id);
+    if(!*varInfo || (*varInfo)->is_array != (indexNode != 0))
+    {
+        s->failed = true;
+        *varInfo = 0;
+        return -1;
+    }
+    if(!indexNode)
+        return (*varInfo)->memloc;
+
+    long long i;
+    *index = specExpr(s, indexNode, &i);
+    if(!*index)
+    {
+        *index = constantNode(i, indexNode->line_num);
+        if(i >= 0 && i < (*varInfo)->size)
+            return (*varInfo)->memloc + (int)i;
+    }
+    storeRange(s, (*varInfo)->memloc, (*varInfo)->size, node->line_num);
+    return -1;
+}
+
+// the residual expression of node, or 0 if its value is known, which then goes to *value
+TreeNode* specExpr(Specializer* s, TreeNode* node, long long* value)
+{
+    if(node->node_kind == NUM_NODE)
+    {
+        *value = node->num;
+        return 0;
+    }
+
+    if(node->node_kind == ID_NODE)
+    {
+        TreeNode* index;
+        VariableInfo* varInfo;
+        int memloc = specLocation(s, node, node->child[0], &index, &varInfo);
+        if(memloc >= 0 && s->known[memloc])
+        {
+            DestroyTree(index);
+            *value = s->values[memloc];
+            return 0;
+        }
+        TreeNode* residual = statementNode(node);
+        residual->child[0] = index;
+        return residual;
+    }
+
+    long long left, right;
+    TreeNode* leftTree = specExpr(s, node->child[0], &left);
+    TreeNode* rightTree = specExpr(s, node->child[1], &right);
+    if(!leftTree && !rightTree && foldOperation(node->oper, left, right, s->int_model, value))
+        return 0;
+    TreeNode* residual = statementNode(node);
+    residual->child[0] = leftTree ? leftTree : constantNode(left, node->line_num);
+    residual->child[1] = rightTree ? rightTree : constantNode(right, node->line_num);
+    return residual;
+}
+
+
+// the locations that the assignments, reads and calls in the statements may change are stored
+// and made unknown; returns true if they may read a value
+bool forgetChanged(Specializer* s, TreeNode* node, int lineNum, bool store, bool forget)
+{
+    int i;
+    bool reads = false;
+    for(; node; node = node->sibling)
+    {
+        if(node->node_kind == ASSIGN_NODE || node->node_kind == READ_NODE)
+        {
+            VariableInfo* varInfo = s->symbol_table->Find(node->id);
+            if(!varInfo)
+            {
+                s->failed = true;
+                continue;
+            }
+            if(store)
+                storeRange(s, varInfo->memloc, varInfo->size, lineNum);
+            if(forget)
+                forgetRange(s, varInfo->memloc, varInfo->size);
+            reads = reads || node->node_kind == READ_NODE;
+        }
+        else if(node->node_kind == CALL_NODE)
+        {
+            if(store)
+                storeForCall(s, lineNum);
+            if(forget)
+                forgetCall(s);
+            reads = reads || s->procs_read;
+        }
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->node_kind != OPER_NODE && node->node_kind != ID_NODE && node->child[i])
+                reads = forgetChanged(s, node->child[i], lineNum, store, forget) || reads;
+    }
+    return reads;
+}
+
+void specStatements(Specializer* s, TreeNode* node);
+
+// both branches are evaluated from the state before the if, the locations where they end in
+// different states are stored at the end of each branch and are unknown after the if. If they read
+// different numbers of values, they are evaluated again with the reads left to the run
+void specIf(Specializer* s, TreeNode* node, TreeNode* condition)
+{
+    int i, k, mark = s->num_changes, reads = s->reads;
+    int readsBound = s->reads_bound, ifsResolved = s->ifs_resolved, loopsUnrolled = s->loops_unrolled;
+    TreeNode** tail = s->tail;
+    TreeNode* parts[2] = {0, 0};
+    TreeNode** tails[2];
+
+    s->tail = &parts[0];
+    specStatements(s, node->child[1]);
+    tails[0] = s->tail;
+    int thenReads = s->reads;
+    s->stamp++;
+    int numThen = 0;
+    SpecChange* thenStates = new SpecChange[s->num_changes - mark + 1];
+    for(k = mark; k < s->num_changes; k++)
+    {
+        int memloc = s->changes[k].memloc;
+        if(s->stamps[memloc] == s->stamp)
+            continue;
+        s->stamps[memloc] = s->stamp;
+        SpecChange* state = &thenStates[numThen++];
+        state->memloc = memloc;
+        state->known = s->known[memloc];
+        state->stored = s->stored[memloc];
+        state->value = s->values[memloc];
+    }
+    s->Undo(mark);
+
+    s->reads = reads;
+    s->tail = &parts[1];
+    specStatements(s, node->child[2]);
+    tails[1] = s->tail;
+    if(s->reads != thenReads)
+    {
+        delete[] thenStates;
+        DestroyTree(parts[0]);
+        DestroyTree(parts[1]);
+        s->Undo(mark);
+        s->tail = tail;
+        s->reads = reads;
+        s->reads_bound = readsBound;
+        s->ifs_resolved = ifsResolved;
+        s->loops_unrolled = loopsUnrolled;
+        loseReads(s);
+        specIf(s, node, condition);
+        return;
+    }
+
+    // the then part ends in thenStates, the else part in the current state, and a location that
+    // only the else part changed has the then part leave the state before the if, which is the
+    // first change of it in the log
+    int end = s->num_changes;
+    s->stamp++;
+    for(k = 0; k < numThen; k++)
+        s->stamps[thenStates[k].memloc] = s->stamp;
+    for(k = 0; k < numThen + end - mark; k++)
+    {
+        SpecChange state;
+        if(k < numThen)
+            state = thenStates[k];
+        else
+        {
+            state = s->changes[mark + k - numThen];
+            if(s->stamps[state.memloc] == s->stamp)
+                continue;
+            s->stamps[state.memloc] = s->stamp;
+        }
+
+        int memloc = state.memloc;
+        if(state.known && s->known[memloc] && state.value == s->values[memloc])
+        {
+            s->Set(memloc, true, state.value, state.stored && s->stored[memloc]);
+            continue;
+        }
+        for(i = 0; i < 2; i++)
+        {
+            bool known = i ? s->known[memloc] : state.known;
+            bool stored = i ? s->stored[memloc] : state.stored;
+            if(!known || stored)
+                continue;
+            TreeNode* store = storeNode(s, memloc, i ? s->values[memloc] : state.value, node->line_num);
+            *tails[i] = store;
+            tails[i] = &store->sibling;
+        }
+        s->Set(memloc, false, 0, true);
+    }
+    delete[] thenStates;
+
+    s->tail = tail;
+    if(!parts[0] && !parts[1] && !mayFail(condition, s->int_model))
+    {
+        DestroyTree(condition);
+        return;
+    }
+    if(!parts[0])
+        parts[0] = noopNode(s, node->line_num);
+    TreeNode* residual = statementNode(node);
+    residual->child[0] = condition;
+    residual->child[1] = parts[0];
+    residual->child[2] = parts[1];
+    residual->lazy = 0;
+    emit(s, residual);
+}
+
+// replaces the loop by the residual statements of its trips if its condition is known after
+// each of them, within the node and trip budgets; false leaves the state as it was
+bool unrollLoop(Specializer* s, TreeNode* node)
+{
+    int mark = s->num_changes, reads = s->reads, numNodes = 0;
+    int readsBound = s->reads_bound, ifsResolved = s->ifs_resolved, loopsUnrolled = s->loops_unrolled;
+    TreeNode** tail = s->tail;
+    TreeNode* trips = 0;
+    s->tail = &trips;
+    bool done = false;
+    while(s->trips_left > 0 && !s->failed)
+    {
+        s->trips_left--;
+        TreeNode** tripStart = s->tail;
+        specStatements(s, node->child[0]);
+        long long value;
+        TreeNode* condition = specExpr(s, node->child[1], &value);
+        numNodes += countNodes(*tripStart);
+        if(condition || numNodes > SPECIALIZE_MAX_NODES)
+        {
+            DestroyTree(condition);
+            break;
+        }
+        if(value)
+        {
+            done = true;
+            break;
+        }
+    }
+
+    s->tail = tail;
+    if(done)
+    {
+        if(trips)
+        {
+            *s->tail = trips;
+            while(*s->tail)
+                s->tail = &(*s->tail)->sibling;
+        }
+        s->loops_unrolled++;
+        return true;
+    }
+    DestroyTree(trips);
+    s->Undo(mark);
+    s->reads = reads;
+    s->reads_bound = readsBound;
+    s->ifs_resolved = ifsResolved;
+    s->loops_unrolled = loopsUnrolled;
+    return false;
+}
+
+// a loop left to the run: what it changes is stored before it and unknown in it, and stored again
+// at the end of its body
+void specLoop(Specializer* s, TreeNode* node)
+{
+    if(forgetChanged(s, node->child[0], node->line_num, true, true))
+        loseReads(s);
+
+    int mark = s->num_changes;
+    TreeNode** tail = s->tail;
+    TreeNode* body = 0;
+    s->tail = &body;
+    specStatements(s, node->child[0]);
+    long long value;
+    TreeNode* condition = specExpr(s, node->child[1], &value);
+    forgetChanged(s, node->child[0], node->line_num, true, false);
+    s->Undo(mark);
+    s->tail = tail;
+
+    TreeNode* residual = statementNode(node);
+    residual->child[0] = body ? body : noopNode(s, node->line_num);
+    residual->child[1] = condition ? condition : truthNode(value != 0, node->line_num);
+    residual->trip_cost = 0;
+    emit(s, residual);
+}
+
+void specStatement(Specializer* s, TreeNode* node)
+{
+    TreeNode* index;
+    VariableInfo* varInfo;
+    long long value = 0;
+
+    if(node->node_kind == ASSIGN_NODE || node->node_kind == READ_NODE)
+    {
+        bool read = node->node_kind == READ_NODE;
+        TreeNode* expr = read ? 0 : specExpr(s, node->child[0], &value);
+        int memloc = specLocation(s, node, read ? node->child[0] : node->child[1], &index, &varInfo);
+        bool known = !read && !expr;
+        if(read && s->reads >= 0)
+        {
+            known = s->reads < s->num_bindings && s->bound[s->reads];
+            value = known ? s->bindings[s->reads] : 0;
+            s->reads_bound += known;
+            s->reads++;
+        }
+        if(known && memloc >= 0)
+        {
+            DestroyTree(index);
+            s->Set(memloc, true, value, false);
+            return;
+        }
+
+        TreeNode* residual;
+        if(read && !known)
+        {
+            residual = statementNode(node);
+            residual->child[0] = index;
+        }
+        else
+            residual = assignNode(node->id, index, known ? constantNode(value, node->line_num) : expr, node->line_num);
+        emit(s, residual);
+        if(memloc >= 0)
+            s->Set(memloc, false, 0, true);
+        else if(varInfo)
+            forgetRange(s, varInfo->memloc, varInfo->size);
+    }
+
+    else if(node->node_kind == WRITE_NODE)
+    {
+        TreeNode* expr = specExpr(s, node->child[0], &value);
+        TreeNode* residual = statementNode(node);
+        residual->child[0] = expr ? expr : constantNode(value, node->line_num);
+        emit(s, residual);
+    }
+
+    else if(node->node_kind == IF_NODE)
+    {
+        TreeNode* condition = specExpr(s, node->child[0], &value);
+        if(condition)
+            specIf(s, node, condition);
+        else
+        {
+            s->ifs_resolved++;
+            specStatements(s, node->child[value ? 1 : 2]);
+        }
+    }
+
+    else if(node->node_kind == REPEAT_NODE)
+    {
+        if(!unrollLoop(s, node))
+            specLoop(s, node);
+    }
+
+    else if(node->node_kind == CALL_NODE)
+    {
+        TreeNode* residual = statementNode(node);
+        TreeNode** link = &residual->child[0];
+        TreeNode* arg;
+        for(arg = node->child[0]; arg; arg = arg->sibling)
+        {
+            TreeNode* expr = specExpr(s, arg, &value);
+            *link = expr ? expr : constantNode(value, arg->line_num);
+            link = &(*link)->sibling;
+        }
+        storeForCall(s, node->line_num);
+        emit(s, residual);
+        forgetCall(s);
+    }
+
+    else if(node->node_kind == PROC_NODE)
+    {
+        TreeNode* residual = statementNode(node);
+        residual->child[0] = CopyTree(node->child[0]);
+        residual->child[1] = CopyTree(node->child[1]);
+        emit(s, residual);
+    }
+    // array statements are at the start of the residual program
+}
+
+void specStatements(Specializer* s, TreeNode* node)
+{
+    for(; node && !s->failed; node = node->sibling)
+        specStatement(s, node);
+}
+
+
+// the locations that procedure bodies assign or read into, or with uses every location they name,
+// each once
+void collectProcLocations(Specializer* s, TreeNode* node, bool inProc, bool uses, int* locations, int* num)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        bool changes = node->node_kind == ASSIGN_NODE || node->node_kind == READ_NODE;
+        VariableInfo* varInfo = inProc && (changes || (uses && node->node_kind == ID_NODE)) ?
+                                s->symbol_table->Find(node->id) : 0;
+        int memloc, end = varInfo ? varInfo->memloc + varInfo->size : 0;
+        for(memloc = varInfo ? varInfo->memloc : 0; memloc < end; memloc++)
+            if(s->stamps[memloc] != s->stamp)
+            {
+                s->stamps[memloc] = s->stamp;
+                locations[(*num)++] = memloc;
+            }
+        s->procs_read = s->procs_read || (inProc && node->node_kind == READ_NODE);
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                collectProcLocations(s, node->child[i], inProc || node->node_kind == PROC_NODE, uses, locations, num);
+    }
+}
+
+// the array statements outside procedures, copied to the start of the residual program
+void hoistArrays(Specializer* s, TreeNode* node)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        if(node->node_kind == ARRAY_NODE)
+        {
+            TreeNode* residual = statementNode(node);
+            residual->child[0] = CopyTree(node->child[0]);
+            emit(s, residual);
+        }
+        else if(node->node_kind != PROC_NODE)
+            for(i = 0; i < MAX_CHILDREN; i++)
+                if(node->child[i])
+                    hoistArrays(s, node->child[i]);
+    }
+}
+
+void countProcCalls(TreeNode* node, SymbolTable* symbolTable)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        ProcInfo* procInfo = node->node_kind == CALL_NODE ? symbolTable->FindProc(node->id) : 0;
+        if(procInfo)
+            procInfo->num_calls++;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            if(node->child[i])
+                countProcCalls(node->child[i], symbolTable);
+    }
+}
+
+// the residual program of tree goes to *residual, false if the tree uses a variable in a way the
+// symbol table does not agree with or needs an empty body where there is no variable to fill it.
+// The procedures of the symbol table are moved to the residual program and their calls counted again
+bool specializeProgram(TreeNode* tree, Specializer* s, TreeNode** residual)
+{
+    int i;
+    *residual = 0;
+    s->proc_changes = new int[s->num_locations+1];
+    s->proc_uses = new int[s->num_locations+1];
+    s->stamp++;
+    collectProcLocations(s, tree, false, false, s->proc_changes, &s->num_proc_changes);
+    s->stamp++;
+    collectProcLocations(s, tree, false, true, s->proc_uses, &s->num_proc_uses);
+    s->tail = residual;
+    hoistArrays(s, tree);
+    specStatements(s, tree);
+    if(s->failed)
+    {
+        DestroyTree(*residual);
+        *residual = 0;
+        return false;
+    }
+
+    // the proc statements are copied in order, and only at the top level
+    TreeNode* node = tree;
+    TreeNode* copy = *residual;
+    for(; node; node = node->sibling)
+    {
+        if(node->node_kind != PROC_NODE)
+            continue;
+        while(copy->node_kind != PROC_NODE)
+            copy = copy->sibling;
+        ProcInfo* procInfo = s->symbol_table->FindProc(node->id);
+        if(procInfo && procInfo->node == node)
+            procInfo->node = copy;
+        copy = copy->sibling;
+    }
+    for(i = 0; i < PROC_HASH_SIZE; i++)
+    {
+        ProcInfo* procInfo;
+        for(procInfo = s->symbol_table->proc_info[i]; procInfo; procInfo = procInfo->next_proc)
+            procInfo->num_calls = 0;
+    }
+    countProcCalls(*residual, s->symbol_table);
+    return true;
+}
+
+
+// the TINY source of a residual program, which parses to the same tree
+
+// how tightly an expression binds in the grammar, a number below 0 is written 0 - n
+int precedenceOf(TreeNode* node)
+{
+    if(node->node_kind == NUM_NODE)
+        return node->num < 0 ? 2 : 5;
+    if(node->node_kind != OPER_NODE)
+        return 5;
+    if(node->oper == EQUAL || node->oper == LESS_THAN)
+        return 1;
+    if(node->oper == PLUS || node->oper == MINUS)
+        return 2;
+    if(node->oper == TIMES || node->oper == DIVIDE)
+        return 3;
+    return 4;
+}
+
+// the name of a variable as the source writes it, without the procedure of a parameter
+void writeTinyName(const char* id, OutBuffer* out)
+{
+    const char* dot = strchr(id, '.');
+    out->Str(dot ? dot+1 : id);
+}
+
+void writeTinyExpr(TreeNode* node, OutBuffer* out, int minPrecedence)
+{
+    int precedence = precedenceOf(node);
+    if(precedence < minPrecedence)
+        out->Char('(');
+
+    if(node->node_kind == NUM_NODE)
+    {
+        if(node->num < 0)
+            out->Str("0 - ");
+        out->Int(node->num < 0 ? -node->num : node->num);
+    }
+    else if(node->node_kind == ID_NODE)
+    {
+        writeTinyName(node->id, out);
+        if(node->child[0])
+        {
+            out->Char('[');
+            writeTinyExpr(node->child[0], out, 0);
+            out->Char(']');
+        }
+    }
+    else
+    {
+        // + - * / are left associative, ^ right associative, = < compare two math expressions
+        int i;
+        for(i = 0; i < num_symbolic_tokens; i++)
+            if(symbolic_tokens[i].type == node->oper)
+                break;
+        bool right = node->oper == POWER;
+        writeTinyExpr(node->child[0], out, precedence == 1 ? 2 : precedence + right);
+        out->Char(' ');
+        out->Str(symbolic_tokens[i].str);
+        out->Char(' ');
+        writeTinyExpr(node->child[1], out, precedence == 1 ? 2 : precedence + !right);
+    }
+
+    if(precedence < minPrecedence)
+        out->Char(')');
+}
+
+void writeTinySource(TreeNode* node, OutBuffer* out, int depth)
+{
+    TreeNode* child;
+    for(; node; node = node->sibling)
+    {
+        out->Repeat(' ', 2*depth);
+        if(node->node_kind == IF_NODE)
+        {
+            out->Str("if ");
+            writeTinyExpr(node->child[0], out, 0);
+            out->Str(" then\n");
+            writeTinySource(node->child[1], out, depth+1);
+            if(node->child[2])
+            {
+                out->Repeat(' ', 2*depth);
+                out->Str("else\n");
+                writeTinySource(node->child[2], out, depth+1);
+            }
+            out->Repeat(' ', 2*depth);
+            out->Str("end");
+        }
+        else if(node->node_kind == REPEAT_NODE)
+        {
+            out->Str("repeat\n");
+            writeTinySource(node->child[0], out, depth+1);
+            out->Repeat(' ', 2*depth);
+            out->Str("until ");
+            writeTinyExpr(node->child[1], out, 0);
+        }
+        else if(node->node_kind == ASSIGN_NODE || node->node_kind == READ_NODE)
+        {
+            TreeNode* index = node->child[node->node_kind == ASSIGN_NODE ? 1 : 0];
+            if(node->node_kind == READ_NODE)
+                out->Str("read ");
+            writeTinyName(node->id, out);
+            if(index)
+            {
+                out->Char('[');
+                writeTinyExpr(index, out, 0);
+                out->Char(']');
+            }
+            if(node->node_kind == ASSIGN_NODE)
+            {
+                out->Str(" := ");
+                writeTinyExpr(node->child[0], out, 0);
+            }
+        }
+        else if(node->node_kind == WRITE_NODE)
+        {
+            out->Str("write ");
+            writeTinyExpr(node->child[0], out, 0);
+        }
+        else if(node->node_kind == ARRAY_NODE)
+        {
+            out->Str("array ");
+            out->Str(node->id);
+            out->Char('[');
+            out->Int(node->child[0]->num);
+            out->Char(']');
+        }
+        else if(node->node_kind == PROC_NODE || node->node_kind == CALL_NODE)
+        {
+            bool proc = node->node_kind == PROC_NODE;
+            out->Str(proc ? "proc " : "call ");
+            out->Str(node->id);
+            if(node->child[0])
+            {
+                out->Char('(');
+                for(child = node->child[0]; child; child = child->sibling)
+                {
+                    if(proc)
+                        writeTinyName(child->id, out);
+                    else
+                        writeTinyExpr(child, out, 0);
+                    if(child->sibling)
+                        out->Str(", ");
+                }
+                out->Char(')');
+            }
+            if(proc)
+            {
+                out->Char('\n');
+                writeTinySource(node->child[1], out, depth+1);
+                out->Repeat(' ', 2*depth);
+                out->Str("end");
+            }
+        }
+        out->Str(node->sibling ? ";\n" : "\n");
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+// Memory Compaction ///////////////////////////////////////////////////////////////
+
+// The symbol table gives every variable a memory location of its own, so a program with many
+// short-lived temporaries spreads its values over a large memory that is mostly dead at any time.
+// Before the run the statements are numbered in program order and every scalar gets the interval
+// from its first to its last access. A scalar that a loop trip may read before writing it carries
+// its value around the loop, so its interval is widened to the whole loop; one that the program
+// may read before writing it is live from the start, where it is 0. Scalars whose intervals do not
+// overlap share a location: the intervals are handed out by their starts, and the location freed
+// last is taken first, so the locations are numbered in the order the program first needs them
+// and the values used together sit next to each other. Arrays and the variables of procedures that
+// are still called keep locations of their own, the arrays after the scalars.
+// The parallel loops tell variables apart by their locations. A scalar that a top-level statement of
+// a region with loops may read before writing it is live in all the region, so its location is not
+// shared there and the statements that use it stay independent of the ones that use other
+// variables. This is done whether or not the run has more than one thread, so the locations only
+// depend on the program. The locations are only shared with --compact: the run finds every
+// location through the symbol table, so a smaller memory saves memory but barely any time.
+
+#define CACHE_LINE_SLOTS 8 // memory locations in a 64-byte cache line
+#define CACHE_SETS 64      // of a 32 KiB, 8-way L1 data cache, for the estimate of the misses
+#define CACHE_WAYS 8
+
+// a repeat loop that is open in the walk of compactMemory, a top-level statement of a region or
+// the whole program
+struct LiveScope
+{
+    int id;        // in the order the scopes open, the ones opened inside this one have larger ids
+    int if_depth;  // of the statement, an access in a deeper if may not happen in a trip
+    int start;     // position of the statement
+    Accesses live; // the scalars a trip may read before writing them, by their old memloc
+};
+
+struct Compactor
+{
+    SymbolTable* symbol_table;
+    int* first;   // position of the first and the last access of each scalar, by its old memloc
+    int* last;
+    int* seen_in; // the innermost scope of the last access of each scalar
+    bool* pinned; // arrays and variables of procedures, never shared
+    LiveScope** scopes;
+    int num_scopes, scope_capacity, next_id;
+    int pos, if_depth;
+    Accesses region_live; // the scalars the statements of the current region may read first
+    Accesses* trace; // every access in program order, for the estimate of the cache misses
+    int locations_before, locations;
+    long long misses_before, misses_after;
+};
+
+
+void openScope(Compactor* compactor)
+{
+    if(compactor->num_scopes == compactor->scope_capacity)
+    {
+        compactor->scope_capacity *= 2;
+        LiveScope** grown = new LiveScope*[compactor->scope_capacity];
+        memcpy(grown, compactor->scopes, compactor->num_scopes*sizeof(LiveScope*));
+        delete[] compactor->scopes;
+        compactor->scopes = grown;
+    }
+    LiveScope* scope = new LiveScope;
+    scope->id = compactor->next_id++;
+    scope->if_depth = compactor->if_depth;
+    scope->start = compactor->pos;
+    compactor->scopes[compactor->num_scopes++] = scope;
+}
+
+void widenIntervals(Compactor* compactor, Accesses* live, int start)
+{
+    int i;
+    for(i = 0; i < live->num_used; i++)
+    {
+        int v = live->used[i];
+        compactor->first[v] = min(compactor->first[v], start);
+        compactor->last[v] = max(compactor->last[v], compactor->pos);
+    }
+}
+
+// the scalars that a trip of the loop may read before writing them are live in all of it
+void closeLoopScope(Compactor* compactor)
+{
+    LiveScope* scope = compactor->scopes[--compactor->num_scopes];
+    widenIntervals(compactor, &scope->live, scope->start);
+    delete scope;
+}
+
+// the scalars that a statement of a region may read before writing them are live in all the region
+void closeStmtScope(Compactor* compactor)
+{
+    LiveScope* scope = compactor->scopes[--compactor->num_scopes];
+    int i;
+    for(i = 0; i < scope->live.num_used; i++)
+        compactor->region_live.Add(scope->live.used[i], false);
+    delete scope;
+}
+
+void compactAccess(Compactor* compactor, const char* name, bool write)
+{
+    int v = compactor->symbol_table->Find(name)->memloc;
+    if(compactor->trace)
+        compactor->trace->Add(v, write);
+    if(compactor->pinned[v])
+        return;
+    if(compactor->first[v] < 0)
+        compactor->first[v] = compactor->pos;
+    compactor->last[v] = compactor->pos;
+
+    // the first access in a scope is the only one that tells if the scope may read the old value.
+    // A scope that saw the scalar has seen it in all the scopes it is in too
+    int i;
+    for(i = compactor->num_scopes-1; i >= 0 && compactor->seen_in[v] < compactor->scopes[i]->id; i--)
+        if(!write || compactor->if_depth != compactor->scopes[i]->if_depth)
+            compactor->scopes[i]->live.Add(v, false);
+    compactor->seen_in[v] = compactor->scopes[compactor->num_scopes-1]->id;
+}
+
+// the reads of an expression, the index of an array element before the element
+void compactExpr(Compactor* compactor, TreeNode* node)
+{
+    if(!node)
+        return;
+    int i;
+    for(i = 0; i < MAX_CHILDREN; i++)
+        compactExpr(compactor, node->child[i]);
+    if(node->node_kind == ID_NODE)
+        compactAccess(compactor, node->id, false);
+}
+
+void compactStmts(Compactor* compactor, TreeNode* node);
+
+// the accesses of a statement in program order, one position per statement
+void compactStmt(Compactor* compactor, TreeNode* node)
+{
+    TreeNode* arg;
+    NodeKind kind = node->node_kind;
+    compactor->pos++;
+    if(kind == IF_NODE)
+    {
+        compactExpr(compactor, node->child[0]);
+        compactor->if_depth++;
+        compactStmts(compactor, node->child[1]);
+        compactStmts(compactor, node->child[2]);
+        compactor->if_depth--;
+    }
+    else if(kind == REPEAT_NODE)
+    {
+        openScope(compactor);
+        compactStmts(compactor, node->child[0]);
+        compactor->pos++;
+        compactExpr(compactor, node->child[1]);
+        closeLoopScope(compactor);
+    }
+    else if(kind == ASSIGN_NODE || kind == READ_NODE)
+    {
+        compactExpr(compactor, indexOf(node));
+        if(kind == ASSIGN_NODE)
+            compactExpr(compactor, node->child[0]);
+        compactAccess(compactor, node->id, true);
+    }
+    else if(kind == WRITE_NODE)
+        compactExpr(compactor, node->child[0]);
+    else if(kind == CALL_NODE)
+        for(arg = node->child[0]; arg; arg = arg->sibling)
+            compactExpr(compactor, arg);
+    // procedures run at their calls, their variables are pinned
+}
+
+void compactStmts(Compactor* compactor, TreeNode* node)
+{
+    for(; node; node = node->sibling)
+        compactStmt(compactor, node);
+}
+
+
+void pinVariables(Compactor* compactor, TreeNode* node)
+{
+    int i;
+    for(; node; node = node->sibling)
+    {
+        if(namesVariable(node))
+            compactor->pinned[compactor->symbol_table->Find(node->id)->memloc] = true;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            pinVariables(compactor, node->child[i]);
+    }
+}
+
+// marks the top-level statements of the regions with at least two loops, as planParallelBatches
+// finds them
+void markRegions(TreeNode* tree, SymbolTable* symbolTable, bool* inRegion)
+{
+    Accesses accesses;
+    int i = 0, j, start = 0, numLoops = 0;
+    TreeNode* node;
+    for(node = tree; ; node = node->sibling, i++)
+    {
+        bool hasLoop = false;
+        accesses.num_used = 0;
+        if(node && collectAccesses(node, symbolTable, &accesses, &hasLoop))
+        {
+            numLoops += hasLoop;
+            continue;
+        }
+        for(j = start; j < i; j++)
+            inRegion[j] = numLoops >= 2;
+        if(!node)
+            break;
+        inRegion[i] = false;
+        start = i+1;
+        numLoops = 0;
+    }
+}
+
+// misses of an LRU cache of CACHE_SETS sets of CACHE_WAYS lines over the accesses of the trace,
+// where memlocs gives the new location of each old one, or 0 to keep them
+long long estimateCacheMisses(Accesses* trace, int* memlocs)
+{
+    long long lines[CACHE_SETS][CACHE_WAYS]; // most recently used first
+    long long misses = 0;
+    int i, j;
+    for(i = 0; i < CACHE_SETS; i++)
+        for(j = 0; j < CACHE_WAYS; j++)
+            lines[i][j] = -1;
+    for(i = 0; i < trace->num_used; i++)
+    {
+        long long line = (memlocs ? memlocs[trace->used[i]] : trace->used[i]) / CACHE_LINE_SLOTS;
+        long long* set = lines[line % CACHE_SETS];
+        for(j = 0; j < CACHE_WAYS-1 && set[j] != line; j++);
+        if(set[j] != line)
+            misses++;
+        memmove(&set[1], &set[0], j*sizeof(long long));
+        set[0] = line;
+    }
+    return misses;
+}
+
+// orders the scalars by the start of their intervals, then by their old memloc
+struct EarlierStart
+{
+    int* first;
+
+    bool operator()(int a, int b) const
+    {
+        return first[a] != first[b] ? first[a] < first[b] : a < b;
+    }
+};
+
+// makes a min-heap of the intervals by their end
+struct LaterEnd
+{
+    int* last;
+
+    bool operator()(int a, int b) const
+    {
+        return last[a] > last[b];
+    }
+};
+
+// gives the scalars of the tree shared memory locations by their live intervals and sets
+// symbolTable->num_vars to the locations used, estimate also estimates the cache misses before and after
+void compactMemory(TreeNode* tree, SymbolTable* symbolTable, Compactor* compactor, bool estimate)
+{
+    int i, n = symbolTable->num_vars, numVars = 0;
+    compactor->symbol_table = symbolTable;
+    compactor->first = new int[n];
+    compactor->last = new int[n];
+    compactor->seen_in = new int[n];
+    compactor->pinned = new bool[n];
+    for(i = 0; i < n; i++)
+    {
+        compactor->first[i] = compactor->last[i] = compactor->seen_in[i] = -1;
+        compactor->pinned[i] = false;
+    }
+
+    VariableInfo** vars = new VariableInfo*[n];
+    for(i = 0; i < SYMBOL_HASH_SIZE; i++)
+    {
+        VariableInfo* curv;
+        for(curv = symbolTable->var_info[i]; curv; curv = curv->next_var)
+        {
+            vars[numVars++] = curv;
+            compactor->pinned[curv->memloc] = curv->is_array;
+        }
+    }
+    TreeNode* node;
+    for(node = tree; node; node = node->sibling)
+        if(node->node_kind == PROC_NODE)
+            for(i = 0; i < MAX_CHILDREN; i++)
+                pinVariables(compactor, node->child[i]);
+
+    compactor->trace = estimate ? new Accesses : 0;
+    compactor->scope_capacity = 16;
+    compactor->scopes = new LiveScope*[compactor->scope_capacity];
+    compactor->num_scopes = compactor->next_id = 0;
+    compactor->pos = compactor->if_depth = 0;
+    openScope(compactor); // the program, without a trip around it
+
+    int numStmts = 0, regionStart = 0;
+    for(node = tree; node; node = node->sibling)
+        numStmts++;
+    bool* inRegion = new bool[numStmts];
+    markRegions(tree, symbolTable, inRegion);
+    for(node = tree, i = 0; node; node = node->sibling, i++)
+    {
+        if(!inRegion[i])
+        {
+            compactStmt(compactor, node);
+            continue;
+        }
+        if(i == 0 || !inRegion[i-1])
+        {
+            regionStart = compactor->pos+1;
+            compactor->region_live.num_used = 0;
+        }
+        openScope(compactor);
+        compactStmt(compactor, node);
+        closeStmtScope(compactor);
+        if(!node->sibling || !inRegion[i+1])
+            widenIntervals(compactor, &compactor->region_live, regionStart);
+    }
+    delete[] inRegion;
+
+    LiveScope* program = compactor->scopes[0];
+    for(i = 0; i < program->live.num_used; i++)
+        compactor->first[program->live.used[i]] = 0;
+    delete program;
+    delete[] compactor->scopes;
+    int end = compactor->pos+1;
+
+    // linear scan: a scalar takes the location freed last by the intervals that ended before it,
+    // variables that are never accessed share one after the end
+    int m = 0, numArrays = 0;
+    int* order = new int[numVars];
+    VariableInfo** arrays = new VariableInfo*[numVars];
+    for(i = 0; i < numVars; i++)
+    {
+        int v = vars[i]->memloc;
+        if(vars[i]->is_array)
+        {
+            arrays[numArrays++] = vars[i];
+            continue;
+        }
+        if(compactor->pinned[v])
+        {
+            compactor->first[v] = 0;
+            compactor->last[v] = end;
+        }
+        else if(compactor->first[v] < 0)
+            compactor->first[v] = compactor->last[v] = end;
+        order[m++] = v;
+    }
+    EarlierStart earlier;
+    earlier.first = compactor->first;
+    sort(order, order+m, earlier);
+
+    LaterEnd later;
+    later.last = compactor->last;
+    int* memlocs = new int[n]; // the new location of each old one
+    int* active = new int[m];
+    int* freeLocations = new int[m];
+    int numActive = 0, numFree = 0, locations = 0;
+    for(i = 0; i < m; i++)
+    {
+        int v = order[i];
+        while(numActive && compactor->last[active[0]] < compactor->first[v])
+        {
+            pop_heap(active, active+numActive, later);
+            freeLocations[numFree++] = memlocs[active[--numActive]];
+        }
+        memlocs[v] = numFree ? freeLocations[--numFree] : locations++;
+        active[numActive++] = v;
+        push_heap(active, active+numActive, later);
+    }
+    sort(arrays, arrays+numArrays, LowerMemloc());
+    for(i = 0; i < numArrays; i++)
+    {
+        memlocs[arrays[i]->memloc] = locations;
+        locations += arrays[i]->size;
+    }
+
+    if(estimate)
+    {
+        compactor->misses_before = estimateCacheMisses(compactor->trace, 0);
+        compactor->misses_after = estimateCacheMisses(compactor->trace, memlocs);
+    }
+    for(i = 0; i < numVars; i++)
+        vars[i]->memloc = memlocs[vars[i]->memloc];
+    compactor->locations_before = n;
+    compactor->locations = locations;
+    symbolTable->num_vars = locations;
+
+    delete compactor->trace;
+    delete[] freeLocations;
+    delete[] active;
+    delete[] memlocs;
+    delete[] arrays;
+    delete[] order;
+    delete[] vars;
+    delete[] compactor->pinned;
+    delete[] compactor->seen_in;
+    delete[] compactor->last;
+    delete[] compactor->first;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+// Watch Mode //////////////////////////////////////////////////////////////////////
+
+// --watch checks the file again every time it is saved. The top-level statements are kept with
+// the byte offset and the line of their first token. After a change the common prefix and suffix
+// of the old and the new text give the changed bytes; the statements are parsed again from the
+// last one that starts before them, and the parser stops as soon as it is at the start of an old
+// statement on a line after the change. The old statements from there on are kept, their offsets
+// and lines are shifted, and the lines of their nodes are only shifted when they are printed.
+// Every statement keeps the buffer of its variables and procedure events (a SemanticChunk of
+// one statement), and every name keeps the statements that name it in order, which is the cross
+// reference of the symbol table. Only the names of the statements that were parsed again or
+// removed are checked again. A program with a semantic error is checked by buildSymbolTable,
+// which prints the errors, as buildSymbolTableParallel does.
+
+#define WATCH_ORDER_GAP (1ULL << 32)
+
+// a top-level statement of the watched file
+struct WatchStmt
+{
+    TreeNode* node;           // 0 if it could not be parsed
+    int parsed_line;          // of its first token when it was parsed, the lines of its nodes, buffer
+                              // and diagnostics are off by the line it is on now minus parsed_line
+    unsigned long long order; // grows with the position, statements added later fit in between
+    Diagnostic* head_diag;    // its syntax errors and those of what is skipped after it
+    int num_diags;
+    bool checked;             // it has no syntax error and chunk holds its names
+    SemanticChunk chunk;
+};
+
+// the statements that name a variable or a procedure
+struct WatchName
+{
+    char* name;
+    int hash;                 // SymbolTable::Hash(name)
+    WatchStmt** stmts;        // in order
+    int count, capacity;
+    int num_decls, plain_uses, indexed_uses; // of a variable, summed over its statements
+    bool bad;                 // buildSymbolTable prints an error for it
+    bool proc;                // a procedure, the names of variables are apart
+    bool dirty;               // its statements changed since bad was found
+    WatchName* next;          // in the same bucket
+    WatchName* next_dirty;
+};
+
+struct WatchState
+{
+    const char* path;
+    char* text;               // the file the statements were parsed from
+    long long size, text_capacity;
+    WatchStmt** stmts;        // the top-level statements in order, with the offset and the
+    long long* starts;        // line of their first token apart, so that shifting them after
+    int* lines;               // an edit is a pass over two arrays
+    int num_stmts, capacity;
+    WatchName** vars;         // SYMBOL_HASH_SIZE buckets each
+    WatchName** procs;
+    WatchName* dirty;
+    LocalVar** buckets;       // for checkChunk
+    SymbolTable hasher;       // only its Hash is used
+    int num_diags, type_errors, bad_names;
+};
+
+void DestroyWatchStmt(WatchStmt* stmt)
+{
+    DestroyTree(stmt->node);
+    while(stmt->head_diag)
+    {
+        Diagnostic* d = stmt->head_diag;
+        stmt->head_diag = d->next;
+        delete[] d->message;
+        delete d;
+    }
+    while(stmt->chunk.head_var)
+    {
+        LocalVar* var = stmt->chunk.head_var;
+        stmt->chunk.head_var = var->next_var;
+        while(var->head_line)
+        {
+            LineLocation* lineloc = var->head_line;
+            var->head_line = lineloc->next;
+            delete lineloc;
+        }
+        delete var;
+    }
+    while(stmt->chunk.head_event)
+    {
+        ProcEvent* event = stmt->chunk.head_event;
+        stmt->chunk.head_event = event->next;
+        delete event;
+    }
+    delete stmt;
+}
+
+WatchName* findWatchName(WatchState* watch, bool proc, const char* name, int hash)
+{
+    WatchName** table = proc ? watch->procs : watch->vars;
+    WatchName* cur;
+    for(cur = table[hash]; cur; cur = cur->next)
+        if(Equals(cur->name, name))
+            return cur;
+
+    cur = new WatchName;
+    AllocateAndCopy(&cur->name, name);
+    cur->hash = hash;
+    cur->stmts = 0;
+    cur->count = cur->capacity = 0;
+    cur->num_decls = cur->plain_uses = cur->indexed_uses = 0;
+    cur->bad = false;
+    cur->proc = proc;
+    cur->dirty = false;
+    cur->next = table[hash];
+    table[hash] = cur;
+    return cur;
+}
+
+// the first statement of name that is not before stmt
+int findWatchUse(WatchName* name, WatchStmt* stmt)
+{
+    int low = 0, high = name->count;
+    while(low < high)
+    {
+        int mid = (low+high)/2;
+        if(name->stmts[mid]->order < stmt->order)
+            low = mid+1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// adds or removes stmt from the statements of name, a statement is there once however often
+// it names it
+void updateWatchUse(WatchState* watch, WatchName* name, WatchStmt* stmt, bool add)
+{
+    int i = findWatchUse(name, stmt);
+    bool there = i < name->count && name->stmts[i] == stmt;
+    if(add && !there)
+    {
+        if(name->count == name->capacity)
+        {
+            name->capacity = max(2*name->capacity, 4);
+            WatchStmt** stmts = new WatchStmt*[name->capacity];
+            if(name->count)
+                memcpy(stmts, name->stmts, name->count*sizeof(WatchStmt*));
+            delete[] name->stmts;
+            name->stmts = stmts;
+        }
+        memmove(&name->stmts[i+1], &name->stmts[i], (name->count-i)*sizeof(WatchStmt*));
+        name->stmts[i] = stmt;
+        name->count++;
+    }
+    else if(!add && there)
+    {
+        memmove(&name->stmts[i], &name->stmts[i+1], (name->count-i-1)*sizeof(WatchStmt*));
+        name->count--;
+    }
+
+    if(!name->dirty)
+    {
+        name->dirty = true;
+        name->next_dirty = watch->dirty;
+        watch->dirty = name;
+    }
+}
+
+// adds the names of stmt to the cross reference, or removes them
+void noteWatchStmt(WatchState* watch, WatchStmt* stmt, bool add)
+{
+    int sign = add ? 1 : -1;
+    watch->num_diags += sign*stmt->num_diags;
+    if(!stmt->checked)
+        return;
+    if(stmt->chunk.type_error)
+        watch->type_errors += sign;
+
+    LocalVar* var;
+    for(var = stmt->chunk.head_var; var; var = var->next_var)
+    {
+        WatchName* name = findWatchName(watch, false, var->name, var->hash);
+        name->num_decls += sign*var->num_decls;
+        name->plain_uses += sign*var->plain_use;
+        name->indexed_uses += sign*var->indexed_use;
+        updateWatchUse(watch, name, stmt, add);
+    }
+    ProcEvent* event;
+    for(event = stmt->chunk.head_event; event; event = event->next)
+    {
+        const char* id = event->node->id;
+        updateWatchUse(watch, findWatchName(watch, true, id, watch->hasher.Hash(id)), stmt, add);
+    }
+}
+
+// whether buildSymbolTable prints an error for the variable name, mergeChunks finds it the same way
+bool isBadVariable(WatchName* name)
+{
+    LocalVar* first = name->stmts[0]->chunk.head_var;
+    while(!Equals(first->name, name->name))
+        first = first->next_var;
+    bool isArray = first->size > 0;
+    return name->num_decls-(isArray ? 1 : 0) > 0 || (isArray ? name->plain_uses : name->indexed_uses) > 0;
+}
+
+// whether buildSymbolTable prints an error for the procedure name: it is declared twice, or called
+// before it is declared or with a wrong number of arguments
+bool isBadProcedure(WatchName* name)
+{
+    bool declared = false;
+    int i, numParams = 0;
+    for(i = 0; i < name->count; i++)
+    {
+        ProcEvent* event;
+        for(event = name->stmts[i]->chunk.head_event; event; event = event->next)
+        {
+            TreeNode* node = event->node;
+            if(!Equals(node->id, name->name))
+                continue;
+            int n = 0;
+            TreeNode* child;
+            for(child = node->child[0]; child; child = child->sibling)
+                n++;
+            if(node->node_kind == PROC_NODE && declared)
+                return true;
+            if(node->node_kind == PROC_NODE)
+            {
+                declared = true;
+                numParams = n;
+            }
+            else if(!declared || n != numParams)
+                return true;
+        }
+    }
+    return false;
+}
+
+// checks the names whose statements changed again, the names no statement has anymore are removed
+void checkWatchNames(WatchState* watch)
+{
+    while(watch->dirty)
+    {
+        WatchName* name = watch->dirty;
+        watch->dirty = name->next_dirty;
+        name->dirty = false;
+
+        bool bad = name->count && (name->proc ? isBadProcedure(name) : isBadVariable(name));
+        watch->bad_names += (int)bad-(int)name->bad;
+        name->bad = bad;
+        if(name->count)
+            continue;
+
+        WatchName** link = &(name->proc ? watch->procs : watch->vars)[name->hash];
+        while(*link != name)
+            link = &(*link)->next;
+        *link = name->next;
+        delete[] name->name;
+        delete[] name->stmts;
+        delete name;
+    }
+}
+
+// the number of bytes both texts start with
+long long commonPrefix(const char* a, const char* b, long long size)
+{
+    long long i = 0;
+    while(i+4096 <= size && memcmp(&a[i], &b[i], 4096) == 0)
+        i += 4096;
+    while(i < size && a[i] == b[i])
+        i++;
+    return i;
+}
+
+// the number of bytes both texts end with, at most size
+long long commonSuffix(const char* a, long long sizeA, const char* b, long long sizeB, long long size)
+{
+    long long i = 0;
+    while(i+4096 <= size && memcmp(&a[sizeA-i-4096], &b[sizeB-i-4096], 4096) == 0)
+        i += 4096;
+    while(i < size && a[sizeA-i-1] == b[sizeB-i-1])
+        i++;
+    return i;
+}
+
+// reads the whole file into buffer, which is grown to hold it, returns false if it cannot be read
+bool readWholeFile(const char* path, char** buffer, long long* capacity, long long* size)
+{
+    FILE* file = fopen(path, "rb");
+    if(!file)
+        return false;
+    *size = 0;
+    while(true)
+    {
+        if(*size == *capacity)
+        {
+            *capacity = max(2*(*capacity), 1LL << 16);
+            char* grown = new char[*capacity];
+            memcpy(grown, *buffer, *size);
+            delete[] *buffer;
+            *buffer = grown;
+        }
+        size_t n = fread(&(*buffer)[*size], 1, *capacity-*size, file);
+        if(n == 0)
+            break;
+        *size += n;
+    }
+    fclose(file);
+    return true;
+}
+
+void growWatchStmts(WatchState* watch, int numStmts)
+{
+    if(numStmts <= watch->capacity)
+        return;
+    int capacity = max(numStmts, 2*watch->capacity);
+    WatchStmt** stmts = new WatchStmt*[capacity];
+    long long* starts = new long long[capacity];
+    int* lines = new int[capacity];
+    if(watch->num_stmts)
+    {
+        memcpy(stmts, watch->stmts, watch->num_stmts*sizeof(WatchStmt*));
+        memcpy(starts, watch->starts, watch->num_stmts*sizeof(long long));
+        memcpy(lines, watch->lines, watch->num_stmts*sizeof(int));
+    }
+    delete[] watch->stmts;
+    delete[] watch->starts;
+    delete[] watch->lines;
+    watch->stmts = stmts;
+    watch->starts = starts;
+    watch->lines = lines;
+    watch->capacity = capacity;
+}
+
+// the statement the parser continues with after stmt, as stmtSeq and syntaxAnalysis do,
+// returns false at the end of the file
+bool skipToNextStmt(CompilerInfo* compInfo, ParseInfo* parseInfo)
+{
+    while(true)
+    {
+        TokenType type = parseInfo->next_token.type;
+        if(type == ENDFILE)
+            return false;
+        if(type == ELSE || type == UNTIL || type == END)
+        {
+            skipStrayToken(compInfo, parseInfo);
+            return true;
+        }
+        if(type == SEMI_COLON)
+        {
+            parseInfo->panic = false;
+            GetNextToken(compInfo, &parseInfo->next_token);
+            return true;
+        }
+        syntaxError(parseInfo, "';'");
+        synchronize(compInfo, parseInfo);
+    }
+}
+
+// makes the statements match text, which replaces the text of watch, returns the number
+// of statements parsed again
+int updateWatch(WatchState* watch, char* text, long long size)
+{
+    // the bytes [first, oldEnd) of the old text are [first, newEnd) of the new one
+    long long first = commonPrefix(watch->text, text, min(size, watch->size));
+    long long suffix = commonSuffix(watch->text, watch->size, text, size, min(size, watch->size)-first);
+    long long oldEnd = watch->size-suffix, newEnd = size-suffix, delta = size-watch->size;
+
+    // the last statement that starts before the change, the part of its line before it is read
+    // again so that lines longer than MAX_LINE_LENGTH are split where they always are
+    int low = 0, high = watch->num_stmts;
+    while(high-low > 1)
+    {
+        int mid = (low+high)/2;
+        if(watch->starts[mid] <= first)
+            low = mid;
+        else
+            high = mid;
+    }
+    int k = low;
+    if(k && watch->starts[k] == watch->size) // at the end of the file, its line is the last one read
+        k--;
+    long long from = k ? watch->starts[k] : 0, lineStart = from;
+    while(lineStart > 0 && text[lineStart-1] != '\n')
+        lineStart--;
+    if(from-lineStart >= MAX_LINE_LENGTH-1)
+        k = 0, from = lineStart = 0;
+
+    // an old statement is the same again once the line it starts on is not changed
+    long long sameFrom = newEnd;
+    if(!((newEnd == 0 || text[newEnd-1] == '\n') && (oldEnd == 0 || watch->text[oldEnd-1] == '\n')))
+    {
+        const char* newLine = (const char*)memchr(&text[newEnd], '\n', size-newEnd);
+        sameFrom = newLine ? newLine-text+1 : size+1;
+    }
+
+    CompilerInfo compInfo(text, size);
+    compInfo.in_file.Seek(lineStart, k ? watch->lines[k] : 1, from);
+    Diagnostics diagnostics;
+    ParseInfo parseInfo(&diagnostics);
+    GetNextToken(&compInfo, &parseInfo.next_token);
+
+    int j = k+1, numNew = 0, capacity = 16, lineDelta = 0;
+    WatchStmt** newStmts = new WatchStmt*[capacity];
+    long long* newStarts = new long long[capacity];
+    while(true)
+    {
+        Token* token = &parseInfo.next_token;
+        while(j < watch->num_stmts && watch->starts[j]+delta < token->offset)
+            j++;
+        if(j < watch->num_stmts && watch->starts[j]+delta == token->offset && token->offset >= sameFrom &&
+           token->offset < size)
+        {
+            lineDelta = token->line_num-watch->lines[j]; // lines longer than MAX_LINE_LENGTH count twice
+            break;
+        }
+
+        WatchStmt* added = new WatchStmt;
+        added->parsed_line = token->line_num;
+        added->checked = false;
+        added->chunk.first = 0;
+        added->chunk.num_stmts = 1;
+        added->chunk.head_var = added->chunk.tail_var = 0;
+        added->chunk.head_event = added->chunk.tail_event = 0;
+        added->chunk.type_error = false;
+        if(numNew == capacity)
+        {
+            capacity *= 2;
+            WatchStmt** stmts = new WatchStmt*[capacity];
+            long long* starts = new long long[capacity];
+            memcpy(stmts, newStmts, numNew*sizeof(WatchStmt*));
+            memcpy(starts, newStarts, numNew*sizeof(long long));
+            delete[] newStmts;
+            delete[] newStarts;
+            newStmts = stmts;
+            newStarts = starts;
+        }
+        newStmts[numNew] = added;
+        newStarts[numNew++] = token->offset;
+
+        added->node = stmt(&compInfo, &parseInfo);
+        bool more = skipToNextStmt(&compInfo, &parseInfo);
+        added->head_diag = diagnostics.head;
+        added->num_diags = diagnostics.count;
+        diagnostics.head = diagnostics.tail = 0;
+        diagnostics.count = 0;
+        if(!more)
+        {
+            j = watch->num_stmts;
+            break;
+        }
+    }
+
+    // the statements [k, j) are replaced with the new ones
+    int i;
+    for(i = k; i < j; i++)
+    {
+        noteWatchStmt(watch, watch->stmts[i], false);
+        DestroyWatchStmt(watch->stmts[i]);
+    }
+    int numStmts = watch->num_stmts-(j-k)+numNew;
+    growWatchStmts(watch, numStmts);
+    int tail = watch->num_stmts-j;
+    memmove(&watch->stmts[k+numNew], &watch->stmts[j], tail*sizeof(WatchStmt*));
+    memmove(&watch->starts[k+numNew], &watch->starts[j], tail*sizeof(long long));
+    memmove(&watch->lines[k+numNew], &watch->lines[j], tail*sizeof(int));
+    watch->num_stmts = numStmts;
+    for(i = k+numNew; i < numStmts; i++)
+    {
+        watch->starts[i] += delta;
+        watch->lines[i] += lineDelta;
+    }
+
+    unsigned long long lowOrder = k ? watch->stmts[k-1]->order : 0;
+    unsigned long long highOrder = k+numNew < numStmts ? watch->stmts[k+numNew]->order
+                                                       : lowOrder+(numNew+1)*WATCH_ORDER_GAP;
+    unsigned long long step = (highOrder-lowOrder)/(numNew+1);
+    for(i = 0; i < numNew; i++)
+    {
+        watch->stmts[k+i] = newStmts[i];
+        watch->starts[k+i] = newStarts[i];
+        watch->lines[k+i] = newStmts[i]->parsed_line;
+        newStmts[i]->order = lowOrder+(i+1)*step;
+    }
+    if(step == 0) // no room left between the neighbours, the order is the same with more room
+        for(i = 0; i < numStmts; i++)
+            watch->stmts[i]->order = (i+1)*WATCH_ORDER_GAP;
+    delete[] newStmts;
+    delete[] newStarts;
+
+    for(i = k; i < k+numNew; i++)
+    {
+        WatchStmt* stmt = watch->stmts[i];
+        if(stmt->node && !stmt->num_diags)
+        {
+            stmt->chunk.first = stmt->node;
+            checkChunk(&watch->hasher, watch->buckets, &stmt->chunk);
+            stmt->checked = true;
+        }
+        noteWatchStmt(watch, stmt, true);
+    }
+    checkWatchNames(watch);
+
+    watch->text = text;
+    watch->size = size;
+    return numNew;
+}
+
+// adds shift to the lines of the nodes and the buffer of a statement
+void shiftLines(TreeNode* node, int shift)
+{
+    for(; node; node = node->sibling)
+    {
+        node->line_num += shift;
+        int i;
+        for(i = 0; i < MAX_CHILDREN; i++)
+            shiftLines(node->child[i], shift);
+    }
+}
+
+// prints the errors of the program as compileFile does, the syntax errors or else the semantic ones
+void printWatchErrors(WatchState* watch)
+{
+    int i;
+    if(watch->num_diags)
+    {
+        for(i = 0; i < watch->num_stmts; i++)
+        {
+            Diagnostic* d;
+            int shift = watch->lines[i]-watch->stmts[i]->parsed_line;
+            for(d = watch->stmts[i]->head_diag; d; d = d->next)
+                printf("%s:%d:%d: error: %s\n", watch->path, d->line_num+shift, d->col, d->message);
+        }
+        return;
+    }
+    if(!watch->type_errors && !watch->bad_names)
+        return;
+
+    TreeNode* tree = 0;
+    TreeNode** link = &tree;
+    for(i = 0; i < watch->num_stmts; i++)
+    {
+        WatchStmt* stmt = watch->stmts[i];
+        int shift = watch->lines[i]-stmt->parsed_line;
+        if(shift)
+        {
+            shiftLines(stmt->node, shift);
+            LocalVar* var;
+            LineLocation* lineloc;
+            for(var = stmt->chunk.head_var; var; var = var->next_var)
+                for(lineloc = var->head_line; lineloc; lineloc = lineloc->next)
+                    lineloc->line_num += shift;
+            stmt->parsed_line = watch->lines[i];
+        }
+        *link = stmt->node;
+        link = &stmt->node->sibling;
+    }
+    SymbolTable symbolTable;
+    buildSymbolTable(tree, &symbolTable);
+    symbolTable.Destroy();
+    for(i = 0; i < watch->num_stmts; i++)
+        watch->stmts[i]->node->sibling = 0;
+}
+
+// checks the file and again every time it is written, until the program is stopped
+bool watchFile(const char* filePath)
+{
+#if defined(__linux__)
+    WatchState watch;
+    watch.path = filePath;
+    watch.text = 0;
+    watch.size = watch.text_capacity = 0;
+    watch.stmts = 0;
+    watch.starts = 0;
+    watch.lines = 0;
+    watch.num_stmts = watch.capacity = 0;
+    watch.vars = new WatchName*[SYMBOL_HASH_SIZE];
+    watch.procs = new WatchName*[SYMBOL_HASH_SIZE];
+    watch.buckets = new LocalVar*[SYMBOL_HASH_SIZE];
+    int i;
+    for(i = 0; i < SYMBOL_HASH_SIZE; i++)
+        watch.vars[i] = watch.procs[i] = 0, watch.buckets[i] = 0;
+    watch.dirty = 0;
+    watch.num_diags = watch.type_errors = watch.bad_names = 0;
+
+    // the directory is watched, editors that save to a new file and rename it replace the file
+    string dir = filePath;
+    size_t slash = dir.rfind('/');
+    const char* base = slash == string::npos ? filePath : &filePath[slash+1];
+    dir = slash == string::npos ? "." : dir.substr(0, slash+1);
+    int fd = inotify_init();
+    if(fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        printf("%s: error: cannot watch the file\n", filePath);
+        return false;
+    }
+
+    // the file is read into spare, which is swapped with the text once the statements match it,
+    // so the buffers are not allocated again for every change
+    char* spare = 0;
+    long long size, spareCapacity = 0;
+    bool first = true;
+    while(true)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if(!readWholeFile(filePath, &spare, &spareCapacity, &size))
+            printf("%s: error: cannot open the file\n", filePath);
+        else if(first || size != watch.size || memcmp(spare, watch.text, size) != 0)
+        {
+            char* text = watch.text;
+            long long capacity = watch.text_capacity;
+            int parsed = updateWatch(&watch, spare, size);
+            watch.text_capacity = spareCapacity;
+            spare = text;
+            spareCapacity = capacity;
+            printWatchErrors(&watch);
+            if(first)
+                printf("Checked %s in %.3f ms: %d statements\n", filePath, ElapsedMs(start), watch.num_stmts);
+            else
+                printf("Checked %s again in %.3f ms: %d of %d statements parsed again\n", filePath,
+                       ElapsedMs(start), parsed, watch.num_stmts);
+            fflush(stdout);
+            first = false;
+        }
+
+        // waits for the file to be written, the events that came meanwhile are taken at once
+        alignas(struct inotify_event) char events[1 << 16];
+        bool changed = false;
+        while(!changed)
+        {
+            ssize_t n = read(fd, events, sizeof(events));
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+            {
+                printf("%s: error: cannot watch the file\n", filePath);
+                return false;
+            }
+            char* p;
+            for(p = events; p < events+n; p += sizeof(struct inotify_event)+((struct inotify_event*)p)->len)
+            {
+                struct inotify_event* event = (struct inotify_event*)p;
+                if(event->len && Equals(event->name, base))
+                    changed = true;
+            }
+        }
+    }
+#else
+    printf("--watch needs inotify, which only Linux has\n");
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Driver //////////////////////////////////////////////////////////////////////////
+
+// usage: TINY_compiler [options] [input files]   (one input file is read from stdin if none is given)
+struct Options
+{
+    int num_inputs;
+    char** input_paths;
+    bool fused;          // --fused: build the symbol table and type check while parsing
+    bool check_only;     // --check-only: fused front end only, no tree is kept, nothing is run
+    bool time_front_end; // --time: print the front end time
+    bool stream;         // --stream: check, run and release one top-level statement at a time
+    const char* gen;     // --gen=spec: write a generated program to stdout, see BenchSpec
+    const char* bench;   // --bench=spec: benchmark the phases on a generated program, JSON to stdout
+    const char* stats;   // --stats[=file]: write the phase timers and counters as JSON (needs -DTINY_STATS)
+    const char* profile; // --profile[=prefix]: profile the run per line, see writeProfile
+    const char* profile_gen; // --profile-gen=file: record branch, loop and variable counts of the run
+    const char* profile_use; // --profile-use=file: lay out the tree and the memory from a recorded profile
+    DumpFormat dump;     // --dump=none|text|jsonl|binary: format of the tree and symbol table dumps
+    const char* dump_path; // --dump-file=file: where the dumps go instead of stdout, without the headers
+    FILE* dump_file;       // opened by main, shared by all the input files
+    long long max_steps;      // --max-steps=n: stop after about n node evaluations in loops
+    long long max_iterations; // --max-iters=n: stop after n loop trips in total
+    long long timeout_ms;     // --timeout-ms=n: stop a run after n ms of wall-clock time
+    const char* checkpoint;   // --checkpoint=file: write checkpoints of the run to file
+    long long checkpoint_every; // --checkpoint-every=n: loop trips between two checkpoints
+    const char* resume;       // --resume=file: continue a run from a checkpoint
+    bool bounds_check;        // --no-bounds-check: array indexes are not checked
+    bool vectorize;           // --no-vectorize: array loops are run node by node
+    bool inline_calls;        // --no-inline: every call is run with a frame
+    bool compact;             // --compact: scalars that are never live together share memory locations
+    long long unroll;         // --unroll=n: trips of a counted loop run without its condition, --no-unroll: 0
+    IntModel int_model;       // --int=wrap64|checked64|bigint: what happens when a value overflows
+    long long threads;        // --threads=n: threads that run independent top-level loops, 1 runs all in order
+    bool watch;               // --watch: check the file again every time it is written, see watchFile
+    bool lazy;                // --lazy: if bodies are parsed when the run first reaches them, see skipBody
+    const char* specialize;   // --specialize=v1,v2,...: the values of the first reads, see specializeProgram
+    long long* bindings;      // the values, bound[i] is false for a ? left to the run
+    bool* bound;
+    int num_bindings;
+    const char* residual;     // --residual[=file]: write the residual program as TINY source (stdout if no file)
+
+    Options()
+    {
+        num_inputs = 0;
+        input_paths = 0;
+        fused = false;
+        check_only = false;
+        time_front_end = false;
+        stream = false;
+        gen = 0;
+        bench = 0;
+        stats = 0;
+        profile = 0;
+        profile_gen = 0;
+        profile_use = 0;
+        dump = DUMP_TEXT;
+        dump_path = 0;
+        dump_file = stdout;
+        max_steps = 0;
+        max_iterations = 0;
+        timeout_ms = 0;
+        checkpoint = 0;
+        checkpoint_every = 1000000;
+        resume = 0;
+        bounds_check = true;
+        vectorize = true;
+        inline_calls = true;
+        compact = false;
+        unroll = 8;
+        int_model = INT_WRAP64;
+        threads = 1; // no speedup of more threads has been measured yet
+        watch = false;
+        lazy = false;
+        specialize = 0;
+        bindings = 0;
+        bound = 0;
+        num_bindings = 0;
+        residual = 0;
+    }
+
+    // n >= 1 after prefix, ex: --max-iters=1000
+    // --name or --name=value, *value is "" without a value; false for every other option
+    static bool OptionalValue(const char* arg, const char* name, const char** value)
+    {
+        int len = strlen(name);
+        if(!StartsWith(arg, name) || (arg[len] && arg[len] != '='))
+            return false;
+        *value = arg[len] ? &arg[len+1] : "";
+        return true;
+    }
+
+    // false with a message for an option that needs =FILE and was given without it
+    static bool HasFile(const char* name, const char* value)
+    {
+        if(*value)
+            return true;
+        printf("%s needs a file: %s=FILE\n", name, name);
+        return false;
+    }
+
+    static bool ParseLimit(const char* arg, const char* prefix, long long* limit)
+    {
+        char* end;
+        *limit = strtoll(&arg[strlen(prefix)], &end, 10);
+        if(*end || *limit < 1)
+        {
+            printf("Invalid limit %s\n", arg);
+            return false;
+        }
+        return true;
+    }
+
+    // a comma separated list of numbers and ?, ex: --specialize=5,?,-3
+    bool ParseBindings(const char* list)
+    {
+        int n = 1;
+        const char* p;
+        for(p = list; *p; p++)
+            n += *p == ',';
+        delete[] bindings;
+        delete[] bound;
+        bindings = new long long[n];
+        bound = new bool[n];
+        num_bindings = 0;
+        for(p = list; *list; p++)
+        {
+            char* end = (char*)p+1;
+            bound[num_bindings] = *p != '?';
+            bindings[num_bindings] = 0;
+            errno = 0;
+            if(bound[num_bindings])
+                bindings[num_bindings] = strtoll(p, &end, 10);
+            num_bindings++;
+            if(end == p || errno == ERANGE || (*end && *end != ','))
+            {
+                printf("Invalid value list %s\n", list);
+                return false;
+            }
+            if(!*end)
+                break;
+            p = end;
+        }
+        return true;
+    }
+
+    bool HasBudget(){return max_steps || max_iterations || timeout_ms;}
+    ~Options(){delete[] input_paths; delete[] bindings; delete[] bound;}
+
+    bool Parse(int argc, char* argv[])
+    {
+        int i;
+        input_paths = new char*[argc];
+        for(i = 1; i < argc; i++)
+        {
+            if(Equals(argv[i], "--fused"))
+                fused = true;
+            else if(Equals(argv[i], "--check-only"))
+                check_only = true;
+            else if(Equals(argv[i], "--time"))
+                time_front_end = true;
+            else if(Equals(argv[i], "--stream"))
+                stream = true;
+            else if(Equals(argv[i], "--no-bounds-check"))
+                bounds_check = false;
+            else if(Equals(argv[i], "--no-vectorize"))
+                vectorize = false;
+            else if(Equals(argv[i], "--no-inline"))
+                inline_calls = false;
+            else if(Equals(argv[i], "--compact"))
+                compact = true;
+            else if(Equals(argv[i], "--no-unroll"))
+                unroll = 0;
+            else if(Equals(argv[i], "--watch"))
+                watch = true;
+            else if(Equals(argv[i], "--lazy"))
+                lazy = true;
+            else if(OptionalValue(argv[i], "--gen", &gen))
+                continue;
+            else if(OptionalValue(argv[i], "--bench", &bench))
+                continue;
+            else if(OptionalValue(argv[i], "--stats", &stats))
+                continue;
+            else if(StartsWith(argv[i], "--dump="))
+            {
+                const char* format = &argv[i][7];
+                if(Equals(format, "none")) dump = DUMP_NONE;
+                else if(Equals(format, "text")) dump = DUMP_TEXT;
+                else if(Equals(format, "jsonl")) dump = DUMP_JSONL;
+                else if(Equals(format, "binary")) dump = DUMP_BINARY;
+                else
+                {
+                    printf("Unknown dump format %s\n", format);
+                    return false;
+                }
+            }
+            else if(StartsWith(argv[i], "--int="))
+            {
+                const char* model = &argv[i][6];
+                if(Equals(model, "wrap64")) int_model = INT_WRAP64;
+                else if(Equals(model, "checked64")) int_model = INT_CHECKED64;
+                else if(Equals(model, "bigint")) int_model = INT_BIGINT;
+                else
+                {
+                    printf("Unknown integer model %s\n", model);
+                    return false;
+                }
+            }
+            else if(StartsWith(argv[i], "--max-steps="))
+            {
+                if(!ParseLimit(argv[i], "--max-steps=", &max_steps))
+                    return false;
+            }
+            else if(StartsWith(argv[i], "--max-iters="))
+            {
+                if(!ParseLimit(argv[i], "--max-iters=", &max_iterations))
+                    return false;
+            }
+            else if(StartsWith(argv[i], "--timeout-ms="))
+            {
+                if(!ParseLimit(argv[i], "--timeout-ms=", &timeout_ms))
+                    return false;
+            }
+            else if(StartsWith(argv[i], "--checkpoint-every="))
+            {
+                if(!ParseLimit(argv[i], "--checkpoint-every=", &checkpoint_every))
+                    return false;
+            }
+            else if(StartsWith(argv[i], "--threads="))
+            {
+                if(!ParseLimit(argv[i], "--threads=", &threads))
+                    return false;
+                threads = min(threads, (long long)MAX_THREADS);
+            }
+            else if(StartsWith(argv[i], "--unroll="))
+            {
+                if(!ParseLimit(argv[i], "--unroll=", &unroll))
+                    return false;
+                unroll = min(unroll, (long long)MAX_UNROLL);
+            }
+            else if(StartsWith(argv[i], "--specialize="))
+            {
+                specialize = &argv[i][13];
+                if(!ParseBindings(specialize))
+                    return false;
+            }
+            else if(OptionalValue(argv[i], "--residual", &residual))
+                continue;
+            else if(StartsWith(argv[i], "--checkpoint="))
+                checkpoint = &argv[i][13];
+            else if(StartsWith(argv[i], "--resume="))
+                resume = &argv[i][9];
+            else if(StartsWith(argv[i], "--dump-file="))
+                dump_path = &argv[i][12];
+            else if(OptionalValue(argv[i], "--profile-gen", &profile_gen))
+            {
+                if(!HasFile("--profile-gen", profile_gen))
+                    return false;
+            }
+            else if(OptionalValue(argv[i], "--profile-use", &profile_use))
+            {
+                if(!HasFile("--profile-use", profile_use))
+                    return false;
+            }
+            else if(OptionalValue(argv[i], "--profile", &profile))
+            {
+                if(!*profile)
+                    profile = "tiny_profile";
+            }
+            else if(StartsWith(argv[i], "--"))
+            {
+                printf("Unknown option %s\n", argv[i]);
+                return false;
+            }
+            else
+                input_paths[num_inputs++] = argv[i];
+        }
+        return true;
+    }
+};
+
+// state of the streaming executor: the memory grows as new variables are inserted
+struct StreamInfo
+{
+    long long* memory;
+    BigInt** big_memory; // grown with the memory when int_model is INT_BIGINT
+    int capacity;
+    IntModel int_model;
+    BigStack big_stack;
+    Budget* budget; // shared by all the statements, once it runs out nothing more is run
+    RunError error; // stops the run like the budget
+    bool bounds_check;
+    FramePool* frames; // allocated with the first procedure
+
+    StreamInfo()
+    {
+        memory = 0; big_memory = 0; capacity = 0; int_model = INT_WRAP64;
+        budget = 0; error.line_num = 0; bounds_check = true; frames = 0;
+    }
+    ~StreamInfo()
+    {
+        int i;
+        for(i = 0; big_memory && i < capacity; i++)
+            delete big_memory[i];
+        delete[] big_memory;
+        delete[] memory;
+        delete frames;
+    }
+};
+
+
+void runStatement(TreeNode* node, SymbolTable* symbolTable, void* data)
+{
+    StreamInfo* streamInfo = (StreamInfo*)data;
+    if(streamInfo->error.line_num || (streamInfo->budget && streamInfo->budget->exceeded.kind != BUDGET_NONE))
+        return;
+
+    if(symbolTable->num_vars > streamInfo->capacity)
+    {
+        int i, capacity = 2*symbolTable->num_vars;
+        long long* memory = new long long[capacity];
+        for(i = 0; i < capacity; i++)
+            memory[i] = (i < streamInfo->capacity) ? streamInfo->memory[i] : 0;
+        if(streamInfo->int_model == INT_BIGINT)
+        {
+            BigInt** bigMemory = new BigInt*[capacity];
+            for(i = 0; i < capacity; i++)
+                bigMemory[i] = (i < streamInfo->capacity) ? streamInfo->big_memory[i] : 0;
+            delete[] streamInfo->big_memory;
+            streamInfo->big_memory = bigMemory;
+        }
+
+        delete[] streamInfo->memory;
+        streamInfo->memory = memory;
+        streamInfo->capacity = capacity;
+    }
+
+    bool big = streamInfo->int_model == INT_BIGINT;
+    if(symbolTable->num_procs && !streamInfo->frames)
+        streamInfo->frames = new FramePool(FRAME_POOL_SIZE, big);
+
+    RunInfo runInfo(symbolTable, streamInfo->memory);
+    runInfo.int_model = streamInfo->int_model;
+    runInfo.big_memory = streamInfo->big_memory;
+    runInfo.big_stack = big ? &streamInfo->big_stack : 0;
+    runInfo.frames = streamInfo->frames;
+    if(runInfo.frames)
+        runInfo.frames->stack_base = (char*)&runInfo;
+    runInfo.budget = streamInfo->budget;
+    runInfo.bounds_check = streamInfo->bounds_check;
+    if(streamInfo->budget)
+        streamInfo->budget->Start();
+    try
+    {
+        runCode(node, &runInfo);
+    }
+    catch(BudgetExceeded e)
+    {
+        streamInfo->budget->exceeded = e;
+    }
+    catch(RunError e)
+    {
+        streamInfo->error = e;
+    }
+}
+
+
+// peak resident set size of the process in KB, 0 if it is not available
+long PeakRssKb()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (long)(counters.PeakWorkingSetSize/1024);
+    return 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss/1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// writes the --stats report to the given file, or to stdout if there is none
+void writeStats(const char* path)
+{
+#ifndef TINY_STATS
+    (void)path;
+#else
+    FILE* file = *path ? fopen(path, "w") : stdout;
+    if(!file)
+    {
+        printf("Cannot write %s\n", path);
+        return;
+    }
+    stats.Print(file);
+    if(file != stdout)
+        fclose(file);
+#endif
+}
+
+// the values of --specialize that the residual program still reads, for the run to take before
+// its input: its first reads are the ones left to the run among the first readsKnown, which read
+// the input, and the later ones take the values after the first readsKnown in order. readsKnown
+// is 0 when the program is run as it is. Returns the number of reads in *values and *given
+int residualReads(Options* options, int readsKnown, long long** values, bool** given)
+{
+    int i, n = 0;
+    for(i = 0; i < readsKnown && i < options->num_bindings; i++)
+        n += !options->bound[i];
+    if(readsKnown >= options->num_bindings)
+        return 0;
+    *values = new long long[n + options->num_bindings - readsKnown];
+    *given = new bool[n + options->num_bindings - readsKnown];
+    for(i = 0; i < n; i++)
+        (*given)[i] = false;
+    for(i = readsKnown; i < options->num_bindings; i++, n++)
+    {
+        (*values)[n] = options->bindings[i];
+        (*given)[n] = options->bound[i];
+    }
+    return n;
+}
+
+// --residual: the TINY source of the specialized program to the file, or to stdout if it is ""
+void writeResidual(TreeNode* tree, const char* path)
+{
+    if(!*path)
+    {
+        printf("Residual Program:\n");
+        printf("-----------------\n");
+        fflush(stdout);
+        OutBuffer out(stdout);
+        writeTinySource(tree, &out, 0);
+        out.Flush();
+        printf("_________________________________________________________________\n\n");
+        return;
+    }
+
+    FILE* file = fopen(path, "w");
+    if(!file)
+    {
+        printf("Cannot write the residual program %s\n", path);
+        return;
+    }
+    OutBuffer out(file);
+    writeTinySource(tree, &out, 0);
+    out.Flush();
+    fclose(file);
+    printf("Residual program written to %s\n", path);
+}
+
+// compiles and runs one program, returns false if the file cannot be read, has syntax errors
+// or runs out of an execution budget
+bool compileFile(const char* filePath, Options* options)
+{
+    FILE* file = fopen(filePath, "r");
+    if(!file)
+    {
+        printf("%s: error: cannot open the file\n", filePath);
+        return false;
+    }
+    fclose(file);
+#ifdef TINY_STATS
+    if(options->stats)
+        statsScan(filePath);
+#endif
+
+    Diagnostics diagnostics;
+    SymbolTable symbolTable;
+    Budget budget(options->max_steps, options->max_iterations, options->timeout_ms);
+    chrono::steady_clock::time_point frontEndStart = chrono::steady_clock::now();
+
+    if(options->check_only)
+    {
+        streamStatements(filePath, &diagnostics, &symbolTable);
+        if(options->time_front_end)
+            printf("Front end time: %.3f ms\n", ElapsedMs(frontEndStart));
+        diagnostics.Print(filePath);
+        symbolTable.Destroy();
+        return diagnostics.count == 0;
+    }
+
+    if(options->stream)
+    {
+        // neither the tree nor the full cross reference is kept, so memory is bounded
+        // by the largest top-level statement and the number of variables
+        symbolTable.record_lines = false;
+        StreamInfo streamInfo;
+        if(options->HasBudget())
+            streamInfo.budget = &budget;
+        streamInfo.bounds_check = options->bounds_check;
+        streamInfo.int_model = options->int_model;
+
+        printf("The run of the program:\n");
+        printf("------------------------\n");
+        streamStatements(filePath, &diagnostics, &symbolTable, runStatement, &streamInfo);
+        printf("__________________________________________________________________\n\n");
+        diagnostics.Print(filePath);
+        bool exceeded = budget.exceeded.kind != BUDGET_NONE || streamInfo.error.line_num;
+        if(streamInfo.error.line_num)
+            printf("%s:%d: error: %s\n", filePath, streamInfo.error.line_num, streamInfo.error.message);
+        else if(exceeded)
+            budget.Print(filePath);
+        printf("Peak RSS: %ld KB\n", PeakRssKb());
+
+        symbolTable.Destroy();
+        return diagnostics.count == 0 && !exceeded;
+    }
+
+    //parsing phase, --lazy leaves if bodies to the run, so nothing that needs all of the tree before
+    //the run is done with it: the budgets, profiles, checkpoints and the passes over the tree
+    bool lazy = options->lazy && !options->fused && !options->HasBudget() && !options->profile &&
+                !options->profile_gen && !options->profile_use && !options->checkpoint && !options->resume;
+    LazySource lazySource;
+    char* lazyText = 0;
+    long long lazyCapacity = 0;
+    TreeNode* parseTree;
+    if(lazy)
+    {
+        lazySource.skipped = lazySource.parsed = 0;
+        if(!readWholeFile(filePath, &lazyText, &lazyCapacity, &lazySource.size))
+        {
+            printf("%s: error: cannot read the file\n", filePath);
+            delete[] lazyText;
+            symbolTable.Destroy();
+            return false;
+        }
+        lazySource.text = lazyText;
+        parseTree = lazySyntaxAnalysis(&lazySource, &diagnostics);
+    }
+    else
+        parseTree = syntaxAnalysis(filePath, &diagnostics, options->fused ? &symbolTable : 0);
+    double frontEndMs = ElapsedMs(frontEndStart);
+    if(diagnostics.count)
+    {
+        diagnostics.Print(filePath);
+        DestroyTree(parseTree);
+        delete[] lazyText;
+        symbolTable.Destroy();
+        return false;
+    }
+
+    // the headers are only written around text dumps to stdout, so dump files and
+    // machine-readable dumps hold nothing but the dump itself
+    bool dumpHeaders = options->dump == DUMP_TEXT && options->dump_file == stdout;
+    if(options->dump != DUMP_NONE)
+    {
+        if(dumpHeaders)
+        {
+            printf("\nSyntax Tree:\n");
+            printf("-------------\n");
+        }
+        fflush(stdout);
+        OutBuffer out(options->dump_file);
+        dumpTree(parseTree, options->dump, &out);
+        out.Flush();
+        if(dumpHeaders)
+            printf("_________________________________________________________________\n\n");
+    }
+
+
+    //generating the symbol table
+    if(!options->fused)
+    {
+        chrono::steady_clock::time_point symbolTableStart = chrono::steady_clock::now();
+        int numChunks = 0, steals = 0;
+        if(options->stats)
+            buildSymbolTable(parseTree, &symbolTable);
+        else
+            numChunks = buildSymbolTableParallel(parseTree, &symbolTable, (int)options->threads, &steals);
+        frontEndMs += ElapsedMs(symbolTableStart);
+        if(options->time_front_end && numChunks)
+            printf("Symbol table: %d chunks on %d threads, %d stolen\n", numChunks, (int)options->threads, steals);
+    }
+    if(options->time_front_end)
+        printf("Front end time: %.3f ms\n", frontEndMs);
+
+    // the program specialized for the values of its first reads, not with the bodies that --lazy
+    // leaves to the run; the values it does not use are read by the run before its input
+    long long* givenValues = 0;
+    bool* given = 0;
+    int numGiven = 0;
+    if(options->specialize && lazy)
+        numGiven = residualReads(options, 0, &givenValues, &given);
+    if((options->specialize || options->residual) && !lazy)
+    {
+        Specializer specializer(&symbolTable, options->int_model, options->bindings, options->bound,
+                                options->num_bindings);
+        int nodesBefore = countNodes(parseTree);
+        TreeNode* residual;
+        if(specializeProgram(parseTree, &specializer, &residual))
+        {
+            DestroyTree(parseTree);
+            parseTree = residual;
+            if(options->residual)
+                writeResidual(parseTree, options->residual);
+            if(specializer.reads_known < options->num_bindings)
+            {
+                numGiven = residualReads(options, specializer.reads_known, &givenValues, &given);
+                printf("%s: the reads after the first %d depend on the run, it reads the later values of --specialize first\n",
+                       filePath, specializer.reads_known);
+            }
+        }
+        else
+        {
+            numGiven = residualReads(options, 0, &givenValues, &given);
+            printf("%s: the program cannot be specialized and is run as it is\n", filePath);
+        }
+        if(options->time_front_end)
+            printf("Specialized: %d reads bound, %d ifs resolved, %d loops unrolled, %d nodes before, %d after\n",
+                   specializer.reads_bound, specializer.ifs_resolved, specializer.loops_unrolled, nodesBefore,
+                   countNodes(parseTree));
+    }
+
+    // not with checkpoints, a checkpoint names statements of the tree that was run
+    if(options->inline_calls && symbolTable.num_procs && !options->checkpoint && !options->resume && !lazy)
+    {
+        Inliner inliner;
+        int nodesBefore = countNodes(parseTree);
+        parseTree = inlineProcedures(parseTree, &symbolTable, &inliner);
+        if(options->time_front_end)
+            printf("Inlined %d of %d calls, %d procedures removed, %d nodes before, %d after\n",
+                   inliner.inlined_calls, inliner.calls, inliner.removed_procs, nodesBefore, countNodes(parseTree));
+    }
+
+    // the profiles and checkpoints find the loops by their nodes, the budgets count their trips and
+    // --stats counts every node evaluated; a used profile only needs the statements of the recorded
+    // run, counted loops leave them as they are
+    bool countLoops = options->unroll && !options->HasBudget() && !options->profile && !options->profile_gen &&
+                      !options->checkpoint && !options->resume && !options->stats && !lazy;
+    bool unroll = countLoops && !options->profile_use;
+    LoopUnroller unroller;
+    memset(&unroller, 0, sizeof(LoopUnroller));
+    if(unroll)
+        parseTree = unrollConstantLoops(parseTree, &symbolTable, &unroller, (int)options->unroll);
+
+    TreeNode* treeBlock = 0;
+    int numNodes = numberNodes(parseTree);
+    PgoProfile pgoProfile;
+    if(options->profile_use)
+    {
+        if(pgoProfile.Read(options->profile_use))
+        {
+            pgoProfile.Match(parseTree, numNodes);
+            assignHotMemlocs(&symbolTable, &pgoProfile);
+            parseTree = layoutTree(parseTree, numNodes, &pgoProfile, &symbolTable, &treeBlock);
+            pgoProfile.Renumber(parseTree, treeBlock);
+            printf("Profile %s: %d branches matched, %d not matched\n\n",
+                   options->profile_use, pgoProfile.matched, pgoProfile.unmatched);
+        }
+        else
+            printf("Cannot read the profile %s\n\n", options->profile_use);
+    }
+
+    // top-level loops that share no variables run at the same time, unless something counts the run
+    bool parallel = options->threads > 1 && !options->profile && !options->profile_gen && !options->HasBudget() &&
+                    !options->checkpoint && !options->resume && !options->stats && !lazy;
+
+    // not with the profiles, which count and place the variables by memory location, nor with checkpoints
+    if(options->compact && !options->profile_gen && !options->profile_use && !options->checkpoint && !options->resume &&
+       !lazy)
+    {
+        Compactor compactor;
+        compactMemory(parseTree, &symbolTable, &compactor, options->time_front_end);
+        if(options->time_front_end)
+            printf("Memory: %d locations instead of %d, estimated L1 misses in one pass over the accesses: %lld instead of %lld\n",
+                   compactor.locations, compactor.locations_before, compactor.misses_after, compactor.misses_before);
+    }
+
+    if(options->dump != DUMP_NONE)
+    {
+        if(dumpHeaders)
+        {
+            printf("Symbol Table:\n");
+            printf("--------------\n");
+        }
+        fflush(stdout);
+        OutBuffer out(options->dump_file);
+        symbolTable.Print(options->dump, &out);
+        out.Flush();
+        if(dumpHeaders)
+            printf("_________________________________________________________________\n\n");
+    }
+
+
+    //resuming from a checkpoint
+    NodeIndex* nodeIndex = 0;
+    Checkpoint resume;
+    TreeNode** resumePath = 0;
+    if(options->checkpoint || options->resume)
+        nodeIndex = new NodeIndex(parseTree, numNodes);
+    if(options->resume)
+    {
+        resumePath = loadCheckpoint(options->resume, filePath, &resume, nodeIndex, symbolTable.num_vars);
+        if(!resumePath)
+        {
+            delete nodeIndex;
+            if(treeBlock)
+                DestroyTreeBlock(treeBlock, numNodes);
+            else
+                DestroyTree(parseTree);
+            symbolTable.Destroy();
+            return false;
+        }
+    }
+    Checkpointer* checkpointer = 0;
+    if(options->checkpoint)
+        checkpointer = new Checkpointer(options->checkpoint, options->checkpoint_every, fileHash(filePath),
+                                        nodeIndex, symbolTable.num_vars);
+
+
+    //code generation phase
+    Profiler* profiler = 0;
+    if(options->profile)
+        profiler = new Profiler(numNodes);
+    PgoCounters* pgo = 0;
+    if(options->profile_gen)
+        pgo = new PgoCounters(numNodes, symbolTable.num_vars);
+
+    RunInfo runInfo(&symbolTable, 0);
+    runInfo.profiler = profiler;
+    runInfo.pgo = pgo;
+    runInfo.budget = options->HasBudget() ? &budget : 0;
+    runInfo.checkpointer = checkpointer;
+    runInfo.bounds_check = options->bounds_check;
+    runInfo.int_model = options->int_model;
+    runInfo.lazy = lazy ? &lazySource : 0;
+    runInfo.given_values = givenValues;
+    runInfo.given = given;
+    runInfo.num_given = numGiven;
+
+    int i;
+    ParallelBatch** parallelBatches = 0;
+    ThreadPool* pool = 0;
+    int numBatches = 0, numTasks = 0;
+    if(parallel)
+    {
+        parallelBatches = new ParallelBatch*[numNodes];
+        for(i = 0; i < numNodes; i++)
+            parallelBatches[i] = 0;
+        numBatches = planParallelBatches(parseTree, &symbolTable, parallelBatches, &numTasks);
+        if(numBatches)
+        {
+            pool = new ThreadPool((int)options->threads - 1);
+            runInfo.parallel_batches = parallelBatches;
+            runInfo.pool = pool;
+        }
+    }
+
+    // array loops are run node by node while anything counts the nodes or the trips,
+    // and with the models that check every operation for overflow
+    VectorLoop** vectorLoops = 0;
+    if(options->vectorize && options->int_model == INT_WRAP64 && !profiler && !pgo && !runInfo.budget && !checkpointer &&
+       !options->stats && !lazy)
+    {
+        vectorLoops = new VectorLoop*[numNodes];
+        for(i = 0; i < numNodes; i++)
+            vectorLoops[i] = 0;
+        planVectorLoops(parseTree, &symbolTable, vectorLoops);
+        runInfo.vector_loops = vectorLoops;
+    }
+
+    // counted loops add to their counters without checking, closed forms only wrap
+    CountedLoop** countedLoops = 0;
+    int numCounted = 0, numClosed = 0;
+    if(countLoops && options->int_model != INT_BIGINT)
+    {
+        countedLoops = new CountedLoop*[numNodes];
+        for(i = 0; i < numNodes; i++)
+            countedLoops[i] = 0;
+        numCounted = planCountedLoops(parseTree, &symbolTable, countedLoops, (int)options->unroll,
+                                      options->int_model == INT_WRAP64, &numClosed,
+                                      pgoProfile.node_counters ? &pgoProfile : 0);
+        runInfo.counted_loops = countedLoops;
+    }
+
+    printf("The run of the program:\n");
+    printf("------------------------\n");
+    chrono::steady_clock::time_point runStart = chrono::steady_clock::now();
+    bool finished = codeGeneration(parseTree, &runInfo, options->resume ? &resume : 0, resumePath);
+    double runMs = ElapsedMs(runStart);
+    printf("__________________________________________________________________\n\n");
+    if(runInfo.error.line_num)
+        printf("%s:%d: error: %s\n", filePath, runInfo.error.line_num, runInfo.error.message);
+    else if(!finished)
+        budget.Print(filePath);
+    if(options->time_front_end)
+        printf("Run time: %.3f ms with %s integers\n", runMs, IntModelStr[options->int_model]);
+    if(options->time_front_end && vectorLoops)
+        printf("Vectorized array loops: %d\n", countVectorLoops(vectorLoops, numNodes));
+    if(options->time_front_end && countLoops)
+        printf("Loops: %d of %d with a constant trip count unrolled, %d counted, %d of them in closed form\n",
+               unroller.unrolled, unroller.constant, numCounted, numClosed);
+    if(options->time_front_end && lazy)
+        printf("Lazy if bodies: %d skipped by the parser, %d parsed during the run, peak RSS %ld KB\n",
+               lazySource.skipped, lazySource.parsed, PeakRssKb());
+    if(options->time_front_end && numBatches)
+        printf("Parallel batches: %d with %d tasks on %d threads\n", numBatches, numTasks, (int)options->threads);
+    if(vectorLoops)
+    {
+        for(i = 0; i < numNodes; i++)
+            if(vectorLoops[i])
+                DestroyVectorLoop(vectorLoops[i]);
+        delete[] vectorLoops;
+    }
+    if(countedLoops)
+    {
+        for(i = 0; i < numNodes; i++)
+            if(countedLoops[i])
+                DestroyCountedLoop(countedLoops[i]);
+        delete[] countedLoops;
+    }
+    delete[] givenValues;
+    delete[] given;
+    delete pool;
+    if(parallelBatches)
+    {
+        for(i = 0; i < numNodes; i++)
+            if(parallelBatches[i])
+                DestroyParallelBatch(parallelBatches[i]);
+        delete[] parallelBatches;
+    }
+
+    if(checkpointer)
+    {
+        // a finished run has nothing left to resume
+        if(finished)
+            remove(options->checkpoint);
+        printf("Checkpoints: %d written to %s in %.3f ms%s\n", checkpointer->written, options->checkpoint,
+               checkpointer->write_ms, finished && checkpointer->written ? ", removed at the end of the run" : "");
+        delete checkpointer;
+    }
+    delete nodeIndex;
+    delete[] resumePath;
+
+    if(pgo)
+    {
+        if(writePgoProfile(options->profile_gen, parseTree, &symbolTable, pgo))
+            printf("Branch profile written to %s\n", options->profile_gen);
+        else
+            printf("Cannot write the branch profile %s\n", options->profile_gen);
+        delete pgo;
+    }
+
+    if(profiler)
+    {
+        if(writeProfile(parseTree, profiler, filePath, options->profile))
+            printf("Profile written to %s.lines.txt and %s.folded\n", options->profile, options->profile);
+        else
+            printf("Cannot write the profile %s\n", options->profile);
+        delete profiler;
+    }
+
+    if(treeBlock)
+        DestroyTreeBlock(treeBlock, numNodes);
+    else
+        DestroyTree(parseTree);
+    delete[] lazyText;
+    symbolTable.Destroy();
+
+    return finished;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if(!options.Parse(argc, argv))
+        return 1;
+
+#ifndef TINY_STATS
+    if(options.stats)
+    {
+        printf("--stats needs a compiler built with -DTINY_STATS\n");
+        return 1;
+    }
+#endif
+
+    if(options.gen || options.bench)
+    {
+        BenchSpec spec;
+        if(!spec.Parse(options.gen ? options.gen : options.bench))
+        {
+            printf("Invalid benchmark spec\n");
+            return 1;
+        }
+        if(options.bench)
+        {
+            if(options.num_inputs)
+            {
+                printf("--bench writes its program to a temporary file and takes no input files\n");
+                return 1;
+            }
+            return runBenchmark(&spec) ? 0 : 1;
+        }
+
+        BenchGenerator generator(&spec);
+        generator.Generate();
+        fwrite(generator.program.c_str(), 1, generator.program.size(), stdout);
+        return 0;
+    }
+
+    if(options.watch)
+    {
+        if(options.num_inputs > 1)
+        {
+            printf("--watch takes one input file\n");
+            return 1;
+        }
+        string watchPath = options.num_inputs ? options.input_paths[0] : "";
+        if(!options.num_inputs)
+            cin >> watchPath;
+        return watchFile(watchPath.c_str()) ? 0 : 1;
+    }
+
+    if(options.stream && (options.checkpoint || options.resume))
+    {
+        printf("--checkpoint and --resume cannot be used with --stream\n");
+        return 1;
+    }
+    if((options.specialize || options.residual) && (options.stream || options.checkpoint || options.resume))
+    {
+        // the values of --specialize stand for the first reads of a whole run of the tree
+        printf("--specialize and --residual cannot be used with --stream, --checkpoint or --resume\n");
+        return 1;
+    }
+    if((options.checkpoint || options.resume) && options.int_model == INT_BIGINT)
+    {
+        // a checkpoint holds one 64-bit value per variable
+        printf("--checkpoint and --resume cannot be used with --int=bigint\n");
+        return 1;
+    }
+
+    if(options.dump_path)
+    {
+        options.dump_file = fopen(options.dump_path, options.dump == DUMP_BINARY ? "wb" : "w");
+        if(!options.dump_file)
+        {
+            printf("Cannot open the dump file %s\n", options.dump_path);
+            return 1;
+        }
+    }
+
+    int i, failed = 0;
+    if(options.num_inputs == 0)
+    {
+        string tempFilePath;
+        cin >> tempFilePath;
+        failed += !compileFile(tempFilePath.c_str(), &options);
+    }
+    for(i = 0; i < options.num_inputs; i++)
+    {
+        if(options.num_inputs > 1)
+            printf("\n=== %s ===\n", options.input_paths[i]);
+        failed += !compileFile(options.input_paths[i], &options);
+    }
+    if(options.num_inputs > 1)
+        printf("\n%d of %d files failed\n", failed, options.num_inputs);
+
+    if(options.dump_path)
+        fclose(options.dump_file);
+    if(options.stats)
+        writeStats(options.stats);
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+# Differential fuzzer of --specialize: generates random programs with arrays, procedures, nested
+# loops and reads, binds a random prefix of their reads (some left as ?), and checks that
+#   - the specialized run prints what the plain run prints, given only the values left to it
+#   - the residual program written by --residual prints the same when run alone
+#
+#   python3 regress/fuzz.py path/to/TINY_compiler FIRST_SEED LAST_SEED [OPTION...]
+# the options are given to every run, like --int=checked64 or --threads=4.
+# python3 regress/fuzz.py --print SEED writes the program of a seed.
+import os, random, re, subprocess, sys, tempfile
+
+def al(i):
+    s = ''
+    i += 1
+    while i:
+        i -= 1
+        s = chr(97 + i % 26) + s
+        i //= 26
+    return s
+def gen(seed):
+    r = random.Random(seed)
+    glob = ['g' + al(i) for i in range(r.randint(2, 7))]
+    ncnt = [0]
+    procs = []
+    def expr(pool, d=0):
+        k = r.random()
+        if d > 2 or k < 0.3:
+            return str(r.randint(0, 9))
+        if k < 0.55:
+            return r.choice(pool)
+        if k < 0.62:
+            return 'a[%s]' % r.choice([str(r.randint(0, 9))] + [v for v in pool if v.startswith('c')] + [r.choice(pool)])
+        op = r.choice('+-*+-*/^') if r.random() < 0.2 else r.choice('+-*')
+        if op == '^':
+            return '(%s ^ %d)' % (expr(pool, d+1), r.randint(0, 3))
+        return '(%s %s %s)' % (expr(pool, d+1), op, expr(pool, d+1))
+    def cond(pool):
+        return '%s %s %s' % (expr(pool, 1), r.choice(['<', '=']), expr(pool, 1))
+    def scal(pool):
+        return r.choice([v for v in pool if not v.startswith('c')] or glob)
+    def stmts(pool, depth, n):
+        res = []
+        local = list(pool)
+        for _ in range(n):
+            k = r.random()
+            if k < 0.15 and depth < 3:
+                c = 'c' + al(ncnt[0]); ncnt[0] += 1
+                bound = r.choice([str(r.randint(0, 6)), r.choice(glob)])
+                body = stmts(local + [c], depth+1, r.randint(1, 4))
+                res.append('%s := 0; repeat %s; %s := %s + 1 until %s < %s' % (c, '; '.join(body), c, c, bound, c))
+                local.append(c)
+            elif k < 0.3 and depth < 3:
+                t = stmts(local, depth+1, r.randint(1, 3))
+                if r.random() < 0.5:
+                    res.append('if %s then %s end' % (cond(local), '; '.join(t)))
+                else:
+                    e = stmts(local, depth+1, r.randint(1, 3))
+                    res.append('if %s then %s else %s end' % (cond(local), '; '.join(t), '; '.join(e)))
+            elif k < 0.38:
+                res.append('write %s' % expr(local))
+            elif k < 0.43:
+                res.append('read %s' % scal(local))
+            elif k < 0.45:
+                res.append('read a[%s]' % expr(local, 2))
+            elif k < 0.5 and procs:
+                p, np = r.choice(procs)
+                res.append('call %s(%s)' % (p, ', '.join(expr(local) for _ in range(np))))
+            elif k < 0.58:
+                idx = r.choice([str(r.randint(0, 9))] + [v for v in local if v.startswith('c')] + [r.choice(local)])
+                res.append('a[%s] := %s' % (idx, expr(local)))
+            elif k < 0.75:
+                ncnt[0] += 1
+                t = 'w' + al(ncnt[0])
+                res.append('%s := %s' % (t, expr(local)))
+                local.append(t)
+            else:
+                tgt = scal(local)
+                res.append('%s := %s' % (tgt, expr(local)))
+                if tgt not in local: local.append(tgt)
+        return res
+    prog = ['array a[10]']
+    for i in range(r.randint(0, 2)):
+        name = 'p' + al(i)
+        params = ['q' + al(i) + 'x' + al(j) for j in range(r.randint(0, 2))]
+        body = stmts(glob + params, 2, r.randint(1, 3))
+        prog.append('proc %s(%s) %s end' % (name, ', '.join(params), '; '.join(body)))
+        procs.append((name, len(params)))
+    prog += ['read %s' % g for g in glob if r.random() < 0.7]
+    temps = ['u' + al(i) for i in range(r.randint(0, 6))]
+    prog += stmts(glob + temps, 0, r.randint(3, 20))
+    prog += ['write %s' % v for v in glob + temps]
+    return ';\n'.join(prog) + '\n'
+
+
+VALUES = [((i*7919) % 23) - 11 for i in range(400)]
+
+def run(binary, extra, args, inp, path):
+    try:
+        p = subprocess.run([binary, '--dump=none'] + extra + args + [path], input=inp, capture_output=True, text=True, timeout=20)
+    except subprocess.TimeoutExpired:
+        return None, ''
+    out = p.stdout
+    m = out.find('The run of the program:')
+    res = out[m:] if m >= 0 else out
+    res = re.sub(r'Enter the value of [^:]*: ', '', res)
+    res = re.sub(r'Run time.*', '', res)
+    return res, out
+
+def lines(values):
+    return ''.join('%d\n' % v for v in values)
+
+def check(binary, extra, seed, path, res):
+    open(path, 'w').write(gen(seed))
+    r = random.Random(seed)
+    K = r.randint(0, 10)
+    binds = [('?' if r.random() < 0.3 else str(VALUES[i])) for i in range(K)]
+    ref, _ = run(binary, extra, [], lines(VALUES), path)
+    if ref is None:
+        return 'skipped'
+    spec = '--specialize=' + ','.join(binds)
+    # the run reads the values left to it: the ? ones, then the ones after the bindings
+    _, full = run(binary, extra, [spec, '--residual=' + res], lines(VALUES), path)
+    m = re.search(r'the reads after the first (\d+) depend', full)
+    N = min(K, int(m.group(1))) if m else K
+    jobInput = lines([VALUES[i] for i in range(K) if binds[i] == '?'] + VALUES[K:])
+    got, full = run(binary, extra, [spec, '--residual=' + res], jobInput, path)
+    if 'cannot be specialized' in full:
+        return 'NOSPEC %s' % spec
+    if got != ref:
+        return 'MISMATCH %s' % spec
+    # the residual program reads the ? values and the ones after the first N reads bound ahead of the run,
+    # its errors are compared without their location
+    got2, _ = run(binary, extra, [], lines([VALUES[i] for i in range(N) if binds[i] == '?'] + VALUES[N:]), res)
+    strip = lambda t: re.sub(r'^\S+:\d+: error', 'error', t, flags=re.M)
+    if got2 is None or strip(got2) != strip(ref):
+        return 'SOURCE MISMATCH %s' % spec
+    return None
+
+def main():
+    if len(sys.argv) == 3 and sys.argv[1] == '--print':
+        sys.stdout.write(gen(int(sys.argv[2])))
+        return 0
+    if len(sys.argv) < 4:
+        print('usage: fuzz.py BINARY FIRST_SEED LAST_SEED [OPTION...] | fuzz.py --print SEED')
+        return 2
+    binary = os.path.abspath(sys.argv[1])
+    first, last, extra = int(sys.argv[2]), int(sys.argv[3]), sys.argv[4:]
+    bad = skipped = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        path, res = os.path.join(tmp, 'prog.tny'), os.path.join(tmp, 'residual.tny')
+        for seed in range(first, last+1):
+            result = check(binary, extra, seed, path, res)
+            if result == 'skipped':
+                skipped += 1
+            elif result:
+                print('%s seed %d' % (result, seed))
+                bad += 1
+    print('bad=%d skipped=%d' % (bad, skipped))
+    return 1 if bad else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# Runs every regress/NAME.txt and compares its output with NAME.out, then runs it again with each
+# of the options below and compares the run with the same expected output.
+#   NAME.in    the values read, one per line (optional)
+#   NAME.opts  options given to every run of NAME, like a budget (optional)
+#
+#   python3 regress/run.py path/to/TINY_compiler [--update]
+# --update writes NAME.out from the plain run instead of comparing.
+import os, re, subprocess, sys
+
+VARIANTS = [['--fused'], ['--no-unroll'], ['--compact'], ['--threads=4'], ['--specialize']]
+TIMEOUT = 60
+
+def run(binary, args, inp):
+    try:
+        p = subprocess.run([binary, '--dump=none'] + args, input=inp, capture_output=True, text=True, timeout=TIMEOUT)
+    except subprocess.TimeoutExpired:
+        return 'timed out after %d s\n' % TIMEOUT
+    out = p.stdout + p.stderr
+    out = re.sub(r'^Run time.*\n', '', out, flags=re.M)
+    # the steps, iterations and time a budget stopped at depend on how the loops were run
+    return re.sub(r'(budget exceeded: .*?), after .*', r'\1', out)
+
+def runSection(out):
+    # the run without the prompts, which bound reads do not print, and without the warnings before it
+    m = out.find('The run of the program:')
+    return re.sub(r'Enter the value of [^:]*: ', '', out[m:] if m >= 0 else out)
+
+def main():
+    if len(sys.argv) < 2:
+        print('usage: run.py BINARY [--update]')
+        return 2
+    binary = os.path.abspath(sys.argv[1])
+    update = '--update' in sys.argv[2:]
+    os.chdir(os.path.dirname(os.path.abspath(__file__)))
+    failed = 0
+    for name in sorted(f[:-4] for f in os.listdir('.') if f.endswith('.txt')):
+        values = open(name + '.in').read().split() if os.path.exists(name + '.in') else []
+        opts = open(name + '.opts').read().split() if os.path.exists(name + '.opts') else []
+        inp = ''.join(v + '\n' for v in values)
+        out = run(binary, opts + [name + '.txt'], inp)
+        if update:
+            open(name + '.out', 'w', newline='\n').write(out)
+            print('wrote %s.out' % name)
+            continue
+        expected = open(name + '.out').read()
+        bad = []
+        if out != expected:
+            bad.append(('', out, expected))
+        for variant in VARIANTS:
+            args, vinp = list(variant), inp
+            if variant == ['--specialize']:
+                if not values:
+                    continue
+                # all values but the last are bound, the run reads the rest
+                bound = max(len(values) - 1, 1)
+                args = ['--specialize=' + ','.join(values[:bound])]
+                vinp = ''.join(v + '\n' for v in values[bound:])
+            got = run(binary, opts + args + [name + '.txt'], vinp)
+            if runSection(got) != runSection(expected):
+                bad.append((' '.join(args), runSection(got), runSection(expected)))
+        for args, got, want in bad:
+            print('FAIL %s %s\n--- expected\n%s--- got\n%s' % (name, args or '(plain run)', want, got))
+        print('%s %s' % ('FAIL' if bad else 'ok', name))
+        failed += bool(bad)
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,811 @@
+// tiny_constexpr.h: the TINY scanner and parser of main.cpp as constexpr functions (C++17),
+// for TINY kernels embedded in C++ code. The program is parsed and type checked while the C++
+// code is compiled, and run by templates instantiated per tree node, so it compiles into
+// straight-line native code with no parsing, tree or dispatch left at run time.
+//
+//     TINY_PROGRAM(factorial, R"(
+//         read x;
+//         fact := 1;
+//         repeat fact := fact * x; x := x - 1 until x = 0;
+//         write fact
+//     )");
+//
+//     tiny::Run<factorial>();      // reads and writes like the interpreter
+//     tiny::Run<factorial>(io);    // io.Read(name, len) returns a value, io.Write(value)
+//
+// Run returns 0, or the line of a division by zero (also a negative power of 0), which stops the
+// run there as it stops the interpreter.
+//
+// A syntax or type error fails the C++ build at the TINY_PROGRAM line, with a diagnostic like
+//     in instantiation of 'struct tiny::Check<tiny::EXPECTED_SEMI_COLON, 4, 9>'
+// giving the error, the line and the column within the string literal (the line after R"( is 2).
+// Unlike main.cpp the parser stops at the first error, there is no recovery.
+// Values are 64-bit and wrap around like --int=wrap64. Each statement list is expanded in one
+// template instance, so the template depth only grows with the nesting of statements and
+// expressions, not with the length of the program.
+
+#ifndef TINY_CONSTEXPR_H
+#define TINY_CONSTEXPR_H
+
+#include <cstdio>
+#include <climits>
+#include <utility>
+
+namespace tiny
+{
+
+////////////////////////////////////////////////////////////////////////////////////
+// Scanner /////////////////////////////////////////////////////////////////////////
+
+const int MAX_TOKEN_LEN = 40;
+
+enum TokenType{
+                IF, THEN, ELSE, END, REPEAT, UNTIL, READ, WRITE,
+                ASSIGN, EQUAL, LESS_THAN,
+                PLUS, MINUS, TIMES, DIVIDE, POWER,
+                SEMI_COLON,
+                LEFT_PAREN, RIGHT_PAREN,
+                LEFT_BRACE, RIGHT_BRACE,
+                ID, NUM,
+                ENDFILE, ERROR
+              };
+
+// why a program does not compile, shows up by name in the C++ diagnostic
+enum CompileError{
+                NO_ERROR,
+                INVALID_CHARACTER, TOKEN_TOO_LONG, UNTERMINATED_COMMENT, NUMBER_TOO_LARGE,
+                EXPECTED_STATEMENT, EXPECTED_SEMI_COLON, EXPECTED_THEN, EXPECTED_END, EXPECTED_UNTIL,
+                EXPECTED_ASSIGN, EXPECTED_IDENTIFIER, EXPECTED_RIGHT_PAREN, EXPECTED_EXPRESSION,
+                CONDITION_NOT_BOOLEAN, VALUE_NOT_INTEGER, OPERAND_NOT_INTEGER
+               };
+
+struct Token
+{
+    TokenType type = ERROR;
+    int start = 0, len = 0;    // where the token is in the source
+    int line_num = 0, col = 0;
+};
+
+struct ReservedWord
+{
+    TokenType type;
+    const char* str;
+};
+
+constexpr ReservedWord reserved_words[]=
+{
+    {IF, "if"}, {THEN, "then"}, {ELSE, "else"}, {END, "end"},
+    {REPEAT, "repeat"}, {UNTIL, "until"}, {READ, "read"}, {WRITE, "write"}
+};
+
+// sub-tokens come last, as in main.cpp
+constexpr ReservedWord symbolic_tokens[]=
+{
+    {ASSIGN, ":="}, {EQUAL, "="}, {LESS_THAN, "<"},
+    {PLUS, "+"}, {MINUS, "-"}, {TIMES, "*"}, {DIVIDE, "/"}, {POWER, "^"},
+    {SEMI_COLON, ";"}, {LEFT_PAREN, "("}, {RIGHT_PAREN, ")"},
+    {LEFT_BRACE, "{"}, {RIGHT_BRACE, "}"}
+};
+
+constexpr bool IsDigit(char ch){return (ch>='0' && ch<='9');}
+constexpr bool IsLetter(char ch){return ((ch>='a' && ch<='z') || (ch>='A' && ch<='Z'));}
+constexpr bool IsLetterOrUnderscore(char ch){return (IsLetter(ch) || ch=='_');}
+constexpr bool IsSpace(char ch){return ch==' ' || ch=='\t' || ch=='\r' || ch=='\n' || ch=='\v' || ch=='\f';}
+
+constexpr bool StartsWith(const char* a, const char* b)
+{
+    for(; *b; a++, b++)
+        if(*a != *b)
+            return false;
+    return true;
+}
+
+constexpr bool Equals(const char* a, int len, const char* b)
+{
+    int i = 0;
+    for(; i < len; i++)
+        if(a[i] != b[i])
+            return false;
+    return b[len] == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Parser //////////////////////////////////////////////////////////////////////////
+
+// program -> stmtseq
+// stmtseq -> stmt { ; stmt }
+// stmt -> ifstmt | repeatstmt | assignstmt | readstmt | writestmt
+// ifstmt -> if exp then stmtseq [ else stmtseq ] end
+// repeatstmt -> repeat stmtseq until expr
+// assignstmt -> identifier := expr
+// readstmt -> read identifier
+// writestmt -> write expr
+// expr -> mathexpr [ (<|=) mathexpr ]
+// mathexpr -> term { (+|-) term }    left associative
+// term -> factor { (*|/) factor }    left associative
+// factor -> newexpr { ^ newexpr }    right associative
+// newexpr -> ( mathexpr ) | number | identifier
+
+const int MAX_CHILDREN = 3;
+
+enum NodeKind{
+                IF_NODE, REPEAT_NODE, ASSIGN_NODE, READ_NODE, WRITE_NODE,
+                OPER_NODE, NUM_NODE, ID_NODE
+             };
+
+enum ExprDataType {VOID, INTEGER, BOOLEAN};
+
+// children and siblings are indexes into Program::nodes, -1 for none
+struct TreeNode
+{
+    int child[MAX_CHILDREN] = {-1, -1, -1};
+    int sibling = -1;
+    int seq_start = 0, seq_len = 0; // the list in Program::seq, on the first statement of a list
+
+    NodeKind node_kind = NUM_NODE;
+    TokenType oper = ERROR; // OPER_NODE
+    long long num = 0;      // NUM_NODE
+    int var = 0;            // memory location of ID_NODE, READ_NODE, ASSIGN_NODE
+    ExprDataType expr_data_type = VOID;
+    int line_num = 0;
+};
+
+struct Variable
+{
+    int start = 0, len = 0; // the name in the source
+};
+
+// a parsed and checked program, MaxNodes is the source length, which no program can exceed
+template<int MaxNodes>
+struct Program
+{
+    const char* source = 0;
+    TreeNode nodes[MaxNodes] = {};
+    int num_nodes = 0;
+    int root = -1;
+    Variable vars[MaxNodes] = {};
+    int num_vars = 0;
+    int seq[MaxNodes] = {}; // the statements of each list, one list after the other
+    int num_seq = 0;
+    bool can_fail = false;  // has a / or ^, which may divide by zero
+
+    CompileError error = NO_ERROR;
+    int error_line = 0, error_col = 0;
+};
+
+template<int MaxNodes>
+struct ParseInfo
+{
+    Program<MaxNodes> program;
+    const char* src = 0;
+    int pos = 0, line_num = 1, line_start = 0;
+    Token next_token;
+
+    constexpr bool Failed(){return program.error != NO_ERROR;}
+
+    // only the first error is kept, the parse functions return as soon as one is set
+    constexpr int Error(CompileError error, int line_num, int col)
+    {
+        if(!Failed())
+        {
+            program.error = error;
+            program.error_line = line_num;
+            program.error_col = col;
+        }
+        return -1;
+    }
+    constexpr int Error(CompileError error)
+    {
+        return Error(error, next_token.line_num, next_token.col);
+    }
+
+    constexpr int NewNode(NodeKind kind, int line_num)
+    {
+        int i = program.num_nodes++;
+        program.nodes[i].node_kind = kind;
+        program.nodes[i].line_num = line_num;
+        return i;
+    }
+
+    constexpr TreeNode& Node(int i){return program.nodes[i];}
+
+    // memory location of the name of the next token, variables get locations in order of appearance
+    constexpr int VarLocation()
+    {
+        int i = 0, j = 0;
+        for(; i < program.num_vars; i++)
+        {
+            if(program.vars[i].len != next_token.len)
+                continue;
+            for(j = 0; j < next_token.len && src[program.vars[i].start+j] == src[next_token.start+j]; j++);
+            if(j == next_token.len)
+                return i;
+        }
+        program.vars[i].start = next_token.start;
+        program.vars[i].len = next_token.len;
+        return program.num_vars++;
+    }
+};
+
+template<int N>
+constexpr void SkipSpaces(ParseInfo<N>& parseInfo)
+{
+    while(IsSpace(parseInfo.src[parseInfo.pos]))
+    {
+        if(parseInfo.src[parseInfo.pos] == '\n')
+        {
+            parseInfo.line_num++;
+            parseInfo.line_start = parseInfo.pos+1;
+        }
+        parseInfo.pos++;
+    }
+}
+
+//The Scanner
+template<int N>
+constexpr void GetNextToken(ParseInfo<N>& parseInfo)
+{
+    Token& token = parseInfo.next_token;
+    const char* src = parseInfo.src;
+    SkipSpaces(parseInfo);
+
+    token.type = ERROR;
+    token.start = parseInfo.pos;
+    token.line_num = parseInfo.line_num;
+    token.col = parseInfo.pos - parseInfo.line_start + 1;
+    const char* s = &src[parseInfo.pos];
+    if(!*s)
+    {
+        token.type = ENDFILE;
+        token.len = 0;
+        return;
+    }
+
+    int i = 0, len = 0;
+    for(i = 0; i < (int)(sizeof(symbolic_tokens)/sizeof(symbolic_tokens[0])); i++)
+        if(StartsWith(s, symbolic_tokens[i].str))
+            break;
+
+    if(i < (int)(sizeof(symbolic_tokens)/sizeof(symbolic_tokens[0])))
+    {
+        if(symbolic_tokens[i].type == LEFT_BRACE)  //{handling the comment}
+        {
+            int line_num = token.line_num, col = token.col;
+            for(parseInfo.pos++; src[parseInfo.pos] && src[parseInfo.pos] != '}'; parseInfo.pos++)
+            {
+                if(src[parseInfo.pos] == '\n')
+                {
+                    parseInfo.line_num++;
+                    parseInfo.line_start = parseInfo.pos+1;
+                }
+            }
+            if(!src[parseInfo.pos])
+            {
+                parseInfo.Error(UNTERMINATED_COMMENT, line_num, col);
+                return;
+            }
+            parseInfo.pos++;
+            return GetNextToken(parseInfo);
+        }
+        token.type = symbolic_tokens[i].type;
+        for(; symbolic_tokens[i].str[len]; len++);
+    }
+    else if(IsDigit(s[0]))
+    {
+        for(len = 1; IsDigit(s[len]); len++);
+        token.type = NUM;
+    }
+    else if(IsLetterOrUnderscore(s[0]))
+    {
+        for(len = 1; IsLetterOrUnderscore(s[len]); len++);
+        token.type = ID;
+        for(i = 0; i < (int)(sizeof(reserved_words)/sizeof(reserved_words[0])); i++)
+        {
+            if(Equals(s, len, reserved_words[i].str))
+            {
+                token.type = reserved_words[i].type;
+                break;
+            }
+        }
+    }
+    else
+    {
+        parseInfo.Error(INVALID_CHARACTER, token.line_num, token.col);
+        return;
+    }
+
+    if(len > MAX_TOKEN_LEN)
+    {
+        parseInfo.Error(TOKEN_TOO_LONG, token.line_num, token.col);
+        return;
+    }
+    token.len = len;
+    parseInfo.pos += len;
+}
+
+template<int N>
+constexpr bool match(ParseInfo<N>& parseInfo, TokenType expected, CompileError error)
+{
+    if(parseInfo.Failed())
+        return false;
+    if(parseInfo.next_token.type != expected)
+    {
+        parseInfo.Error(error);
+        return false;
+    }
+    GetNextToken(parseInfo);
+    return !parseInfo.Failed();
+}
+
+// the type rules of typeChecking in main.cpp, an error fails the build instead of being printed
+template<int N>
+constexpr int checkNode(ParseInfo<N>& parseInfo, int i)
+{
+    if(parseInfo.Failed())
+        return -1;
+    TreeNode& node = parseInfo.Node(i);
+    if(node.node_kind == IF_NODE && parseInfo.Node(node.child[0]).expr_data_type != BOOLEAN)
+        return parseInfo.Error(CONDITION_NOT_BOOLEAN, node.line_num, 1);
+    if(node.node_kind == REPEAT_NODE && parseInfo.Node(node.child[1]).expr_data_type != BOOLEAN)
+        return parseInfo.Error(CONDITION_NOT_BOOLEAN, node.line_num, 1);
+    if((node.node_kind == ASSIGN_NODE || node.node_kind == WRITE_NODE) &&
+       parseInfo.Node(node.child[0]).expr_data_type != INTEGER)
+        return parseInfo.Error(VALUE_NOT_INTEGER, node.line_num, 1);
+    if(node.node_kind == OPER_NODE && (parseInfo.Node(node.child[0]).expr_data_type != INTEGER ||
+                                       parseInfo.Node(node.child[1]).expr_data_type != INTEGER))
+        return parseInfo.Error(OPERAND_NOT_INTEGER, node.line_num, 1);
+    return i;
+}
+
+template<int N> constexpr int stmtSeq(ParseInfo<N>&);
+template<int N> constexpr int mathExpr(ParseInfo<N>&);
+template<int N> constexpr int factor(ParseInfo<N>&);
+
+// newexpr -> ( mathexpr ) | number | identifier   ex: (5+3) | 5 | x
+template<int N>
+constexpr int newExpr(ParseInfo<N>& parseInfo)
+{
+    Token token = parseInfo.next_token;
+    if(token.type == LEFT_PAREN)
+    {
+        GetNextToken(parseInfo);
+        int subTree = mathExpr(parseInfo);
+        match(parseInfo, RIGHT_PAREN, EXPECTED_RIGHT_PAREN);
+        return subTree;
+    }
+    else if(token.type == NUM)
+    {
+        long long value = 0;
+        int i = 0, digit = 0;
+        for(; i < token.len; i++)
+        {
+            digit = parseInfo.src[token.start+i]-'0';
+            if(value > (LLONG_MAX - digit) / 10)
+                return parseInfo.Error(NUMBER_TOO_LARGE);
+            value = 10*value + digit;
+        }
+
+        int subTree = parseInfo.NewNode(NUM_NODE, token.line_num);
+        parseInfo.Node(subTree).num = value;
+        parseInfo.Node(subTree).expr_data_type = INTEGER;
+        GetNextToken(parseInfo);
+        return subTree;
+    }
+    else if(token.type == ID)
+    {
+        int subTree = parseInfo.NewNode(ID_NODE, token.line_num);
+        parseInfo.Node(subTree).var = parseInfo.VarLocation();
+        parseInfo.Node(subTree).expr_data_type = INTEGER;
+        GetNextToken(parseInfo);
+        return subTree;
+    }
+    return parseInfo.Error(EXPECTED_EXPRESSION);
+}
+
+// adds an operator node for the next token over left, the right operand comes from rightSide
+template<int N>
+constexpr int operNode(ParseInfo<N>& parseInfo, int left, ExprDataType type, int (*rightSide)(ParseInfo<N>&))
+{
+    int subTree = parseInfo.NewNode(OPER_NODE, parseInfo.next_token.line_num);
+    parseInfo.Node(subTree).oper = parseInfo.next_token.type;
+    parseInfo.Node(subTree).expr_data_type = type;
+    parseInfo.Node(subTree).child[0] = left;
+    if(parseInfo.next_token.type == DIVIDE || parseInfo.next_token.type == POWER)
+        parseInfo.program.can_fail = true;
+    GetNextToken(parseInfo);
+    if(parseInfo.Failed())
+        return -1;
+    int right = rightSide(parseInfo);
+    parseInfo.Node(subTree).child[1] = right;
+    return checkNode(parseInfo, subTree);
+}
+
+// factor -> newexpr { ^ newexpr } 2^3^1^5   right associative
+template<int N>
+constexpr int factor(ParseInfo<N>& parseInfo)
+{
+    int subTree = newExpr(parseInfo);
+    if(parseInfo.Failed() || parseInfo.next_token.type != POWER)
+        return subTree;
+    return operNode(parseInfo, subTree, INTEGER, factor<N>);
+}
+
+// term -> factor { (*|/) factor }    left associative
+template<int N>
+constexpr int term(ParseInfo<N>& parseInfo)
+{
+    int subTree = factor(parseInfo);
+    while(!parseInfo.Failed() && (parseInfo.next_token.type == TIMES || parseInfo.next_token.type == DIVIDE))
+        subTree = operNode(parseInfo, subTree, INTEGER, factor<N>);
+    return subTree;
+}
+
+// mathexpr -> term { (+|-) term }    left associative
+template<int N>
+constexpr int mathExpr(ParseInfo<N>& parseInfo)
+{
+    int subTree = term(parseInfo);
+    while(!parseInfo.Failed() && (parseInfo.next_token.type == PLUS || parseInfo.next_token.type == MINUS))
+        subTree = operNode(parseInfo, subTree, INTEGER, term<N>);
+    return subTree;
+}
+
+// expr -> mathexpr [ (<|=) mathexpr ]
+template<int N>
+constexpr int expr(ParseInfo<N>& parseInfo)
+{
+    int subTree = mathExpr(parseInfo);
+    if(parseInfo.Failed() || (parseInfo.next_token.type != LESS_THAN && parseInfo.next_token.type != EQUAL))
+        return subTree;
+    return operNode(parseInfo, subTree, BOOLEAN, mathExpr<N>);
+}
+
+// ifstmt -> if exp then stmtseq [ else stmtseq ] end
+template<int N>
+constexpr int ifStmt(ParseInfo<N>& parseInfo)
+{
+    int subTree = parseInfo.NewNode(IF_NODE, parseInfo.next_token.line_num);
+    GetNextToken(parseInfo);
+    if(parseInfo.Failed())
+        return -1;
+    int condition = expr(parseInfo);
+    parseInfo.Node(subTree).child[0] = condition;
+    if(!match(parseInfo, THEN, EXPECTED_THEN))
+        return -1;
+    int body = stmtSeq(parseInfo);
+    parseInfo.Node(subTree).child[1] = body;
+    if(!parseInfo.Failed() && parseInfo.next_token.type == ELSE)
+    {
+        GetNextToken(parseInfo);
+        int elseBody = stmtSeq(parseInfo);
+        parseInfo.Node(subTree).child[2] = elseBody;
+    }
+    match(parseInfo, END, EXPECTED_END);
+    return checkNode(parseInfo, subTree);
+}
+
+// repeatstmt -> repeat stmtseq until expr
+template<int N>
+constexpr int repeatStmt(ParseInfo<N>& parseInfo)
+{
+    int subTree = parseInfo.NewNode(REPEAT_NODE, parseInfo.next_token.line_num);
+    GetNextToken(parseInfo);
+    if(parseInfo.Failed())
+        return -1;
+    int body = stmtSeq(parseInfo);
+    parseInfo.Node(subTree).child[0] = body;
+    if(!match(parseInfo, UNTIL, EXPECTED_UNTIL))
+        return -1;
+    int condition = expr(parseInfo);
+    parseInfo.Node(subTree).child[1] = condition;
+    return checkNode(parseInfo, subTree);
+}
+
+// assignstmt -> identifier := expr
+template<int N>
+constexpr int assignStmt(ParseInfo<N>& parseInfo)
+{
+    int subTree = parseInfo.NewNode(ASSIGN_NODE, parseInfo.next_token.line_num);
+    parseInfo.Node(subTree).var = parseInfo.VarLocation();
+    GetNextToken(parseInfo);
+    if(!match(parseInfo, ASSIGN, EXPECTED_ASSIGN))
+        return -1;
+    int value = expr(parseInfo);
+    parseInfo.Node(subTree).child[0] = value;
+    return checkNode(parseInfo, subTree);
+}
+
+// readstmt -> read identifier
+template<int N>
+constexpr int readStmt(ParseInfo<N>& parseInfo)
+{
+    GetNextToken(parseInfo);
+    if(parseInfo.Failed())
+        return -1;
+    if(parseInfo.next_token.type != ID)
+        return parseInfo.Error(EXPECTED_IDENTIFIER);
+
+    int subTree = parseInfo.NewNode(READ_NODE, parseInfo.next_token.line_num);
+    parseInfo.Node(subTree).var = parseInfo.VarLocation();
+    GetNextToken(parseInfo);
+    return subTree;
+}
+
+// writestmt -> write expr
+template<int N>
+constexpr int writeStmt(ParseInfo<N>& parseInfo)
+{
+    int subTree = parseInfo.NewNode(WRITE_NODE, parseInfo.next_token.line_num);
+    GetNextToken(parseInfo);
+    if(parseInfo.Failed())
+        return -1;
+    int value = expr(parseInfo);
+    parseInfo.Node(subTree).child[0] = value;
+    return checkNode(parseInfo, subTree);
+}
+
+// stmt -> ifstmt | repeatstmt | assignstmt | readstmt | writestmt
+template<int N>
+constexpr int stmt(ParseInfo<N>& parseInfo)
+{
+    switch(parseInfo.next_token.type)
+    {
+        case IF: return ifStmt(parseInfo);
+        case REPEAT: return repeatStmt(parseInfo);
+        case ID: return assignStmt(parseInfo);
+        case READ: return readStmt(parseInfo);
+        case WRITE: return writeStmt(parseInfo);
+        default: return parseInfo.Error(EXPECTED_STATEMENT);
+    }
+}
+
+// stmtseq -> stmt {; stmt}
+template<int N>
+constexpr int stmtSeq(ParseInfo<N>& parseInfo)
+{
+    int first = stmt(parseInfo), last = first;
+    while(!parseInfo.Failed())
+    {
+        TokenType type = parseInfo.next_token.type;
+        if(type == ELSE || type == UNTIL || type == END || type == ENDFILE)
+            break;
+        if(!match(parseInfo, SEMI_COLON, EXPECTED_SEMI_COLON))
+            break;
+
+        int next = stmt(parseInfo);
+        if(parseInfo.Failed())
+            break;
+        parseInfo.Node(last).sibling = next;
+        last = next;
+    }
+    return first;
+}
+
+// copies the statement list first and the lists nested in it into Program::seq
+template<int N>
+constexpr void layoutSeq(Program<N>& program, int first)
+{
+    if(first < 0)
+        return;
+    int i = first;
+    program.nodes[first].seq_start = program.num_seq;
+    for(; i >= 0; i = program.nodes[i].sibling)
+        program.seq[program.num_seq++] = i;
+    program.nodes[first].seq_len = program.num_seq - program.nodes[first].seq_start;
+
+    for(i = first; i >= 0; i = program.nodes[i].sibling)
+    {
+        if(program.nodes[i].node_kind == IF_NODE)
+        {
+            layoutSeq(program, program.nodes[i].child[1]);
+            layoutSeq(program, program.nodes[i].child[2]);
+        }
+        else if(program.nodes[i].node_kind == REPEAT_NODE)
+            layoutSeq(program, program.nodes[i].child[0]);
+    }
+}
+
+// program -> stmtseq
+template<int N>
+constexpr Program<N> syntaxAnalysis(const char* source)
+{
+    ParseInfo<N> parseInfo;
+    parseInfo.src = source;
+    parseInfo.program.source = source;
+    GetNextToken(parseInfo);
+    if(!parseInfo.Failed())
+    {
+        parseInfo.program.root = stmtSeq(parseInfo);
+        if(!parseInfo.Failed() && parseInfo.next_token.type != ENDFILE)
+            parseInfo.Error(EXPECTED_SEMI_COLON);
+    }
+    if(!parseInfo.Failed())
+        layoutSeq(parseInfo.program, parseInfo.program.root);
+    return parseInfo.program;
+}
+
+// instantiated by TINY_PROGRAM, the arguments in the diagnostic tell what is wrong and where
+template<CompileError Error, int Line, int Col>
+struct Check
+{
+    static_assert(Error == NO_ERROR, "TINY program does not compile: the error, line and column "
+                                     "are the template arguments of tiny::Check");
+    static const bool ok = true;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// Code Generation /////////////////////////////////////////////////////////////////
+
+// One function template instance per tree node: the node kind, operator, children and memory
+// locations are template constants, so each instance is a few instructions with no dispatch.
+
+// reads and writes like the interpreter of main.cpp
+struct StdIo
+{
+    long long Read(const char* name, int len)
+    {
+        long long value = 0;
+        printf("Enter the value of %.*s: ", len, name);
+        if(scanf("%lld", &value) != 1)
+            value = 0;
+        return value;
+    }
+    void Write(long long value)
+    {
+        printf("the value is: %lld\n", value);
+    }
+};
+
+// base^exponent wrapping around, the integer part of 1/base^-exponent for exponent < 0 and base != 0,
+// as the interpreter with --int=wrap64
+inline long long power(long long base, long long exponent)
+{
+    if(exponent < 0)
+        return base == 1 || base == -1 ? (base == -1 && exponent % 2 ? -1 : 1) : 0;
+    unsigned long long result = 1, b = (unsigned long long)base;
+    while(exponent > 0)
+    {
+        if(exponent & 1)
+            result *= b;
+        b *= b;
+        exponent >>= 1;
+    }
+    return (long long)result;
+}
+
+// true once a division by zero has stopped the run, always false for a program without / or ^
+template<const auto& P>
+inline bool stopped(int errorLine){return P.can_fail && errorLine;}
+
+//evaluates the expression I, + - * on unsigned integers so they wrap around like --int=wrap64,
+//a division by zero sets errorLine (if it is still 0) and gives 0
+template<const auto& P, int I>
+inline long long run(const long long* memory, int& errorLine)
+{
+    constexpr TreeNode node = P.nodes[I];
+    if constexpr(node.node_kind == NUM_NODE)
+        return node.num;
+    else if constexpr(node.node_kind == ID_NODE)
+        return memory[node.var];
+    else
+    {
+        long long leftChild = run<P, node.child[0]>(memory, errorLine);
+        long long rightChild = run<P, node.child[1]>(memory, errorLine);
+        unsigned long long left = (unsigned long long)leftChild, right = (unsigned long long)rightChild;
+        if constexpr(node.oper == EQUAL) return leftChild == rightChild;
+        else if constexpr(node.oper == LESS_THAN) return leftChild < rightChild;
+        else if constexpr(node.oper == PLUS) return (long long)(left + right);
+        else if constexpr(node.oper == MINUS) return (long long)(left - right);
+        else if constexpr(node.oper == TIMES) return (long long)(left * right);
+        else if constexpr(node.oper == DIVIDE || node.oper == POWER)
+        {
+            if(node.oper == DIVIDE ? rightChild == 0 : rightChild < 0 && leftChild == 0)
+            {
+                if(!errorLine)
+                    errorLine = node.line_num;
+                return 0;
+            }
+            if constexpr(node.oper == DIVIDE)
+                return leftChild == LLONG_MIN && rightChild == -1 ? LLONG_MIN : leftChild / rightChild;
+            else
+                return power(leftChild, rightChild);
+        }
+    }
+}
+
+template<const auto& P, int First, class Io> void runCode(long long* memory, Io& io, int& errorLine);
+
+//runs the statement I, nothing once errorLine is set
+template<const auto& P, int I, class Io>
+inline void runStmt(long long* memory, Io& io, int& errorLine)
+{
+    constexpr TreeNode node = P.nodes[I];
+    if(stopped<P>(errorLine))
+        return;
+    if constexpr(node.node_kind == IF_NODE)
+    {
+        bool condition = run<P, node.child[0]>(memory, errorLine);
+        if(stopped<P>(errorLine))
+            return;
+        if(condition)
+            runCode<P, node.child[1]>(memory, io, errorLine);
+        else
+            runCode<P, node.child[2]>(memory, io, errorLine);
+    }
+    else if constexpr(node.node_kind == REPEAT_NODE)
+    {
+        do
+            runCode<P, node.child[0]>(memory, io, errorLine);
+        while(!stopped<P>(errorLine) && !run<P, node.child[1]>(memory, errorLine) && !stopped<P>(errorLine));
+    }
+    else if constexpr(node.node_kind == ASSIGN_NODE)
+    {
+        long long value = run<P, node.child[0]>(memory, errorLine);
+        if(!stopped<P>(errorLine))
+            memory[node.var] = value;
+    }
+    else if constexpr(node.node_kind == READ_NODE)
+        memory[node.var] = io.Read(P.source + P.vars[node.var].start, P.vars[node.var].len);
+    else if constexpr(node.node_kind == WRITE_NODE)
+    {
+        long long value = run<P, node.child[0]>(memory, errorLine);
+        if(!stopped<P>(errorLine))
+            io.Write(value);
+    }
+}
+
+// the statements of a list in order, expanded in a braced list rather than a fold expression,
+// which compilers limit to a few hundred operands
+template<const auto& P, int First, class Io, int... K>
+inline void runSeq(long long* memory, Io& io, int& errorLine, std::integer_sequence<int, K...>)
+{
+    int done[] = {(runStmt<P, P.seq[P.nodes[First].seq_start + K]>(memory, io, errorLine), 0)...};
+    (void)done;
+}
+
+//runs the statement list starting at First
+template<const auto& P, int First, class Io>
+inline void runCode(long long* memory, Io& io, int& errorLine)
+{
+    if constexpr(First >= 0)
+        runSeq<P, First>(memory, io, errorLine, std::make_integer_sequence<int, P.nodes[First].seq_len>());
+}
+
+// runs the program with all variables starting at 0, memory (if given, P.num_vars long longs)
+// holds the variables in order of first appearance in the source and keeps their final values.
+// Returns 0, or the line (counted as in the compile errors) of the division by zero that stopped it.
+template<const auto& P, class Io>
+int Run(Io& io, long long* memory = 0)
+{
+    long long local[P.num_vars > 0 ? P.num_vars : 1] = {};
+    int i, errorLine = 0;
+    if(memory)
+        for(i = 0; i < P.num_vars; i++)
+            memory[i] = 0;
+    runCode<P, P.root>(memory ? memory : local, io, errorLine);
+    return errorLine;
+}
+
+// prints a division by zero as the interpreter does, with the line in the string literal
+template<const auto& P>
+int Run()
+{
+    StdIo io;
+    int errorLine = Run<P>(io);
+    if(errorLine)
+        printf("line %d: error: division by zero\n", errorLine);
+    return errorLine;
+}
+
+template<int N>
+constexpr int Length(const char (&)[N]){return N;}
+
+} // namespace tiny
+
+// declares name, the program parsed from the string literal source at compile time
+#define TINY_PROGRAM(name, source) \
+    static constexpr char name##_source[] = source; \
+    static constexpr auto name = tiny::syntaxAnalysis<tiny::Length(name##_source)>(name##_source); \
+    static_assert(tiny::Check<name.error, name.error_line, name.error_col>::ok, "TINY program " #name)
+
+#endif // TINY_CONSTEXPR_H